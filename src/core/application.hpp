@@ -7,6 +7,8 @@
 #include "config.hpp"
 #include "logger.hpp"
 #include "battery_monitor.hpp"
+#include "retry_policy.hpp"
+#include "idle_gate.hpp"
 #include "ui/icon_loader.hpp"
 #include "ui/tray_icon.hpp"
 #include "ui/notification_manager.hpp"
@@ -21,13 +23,23 @@ public:
     struct Constants
     {
         static constexpr UINT WM_TRAYICON = WM_USER + 1;
+        static constexpr UINT WM_HID_COMPLETION = WM_USER + 2;
+        static constexpr UINT WM_STATUS_CHANGED = WM_USER + 3;
         static constexpr UINT ID_TRAY_ICON = 1;
         static constexpr UINT ID_TIMER_UPDATE = 1;
         static constexpr UINT ID_TIMER_DEVICE_CHANGE = 2;
         static constexpr UINT ID_TIMER_ARRIVAL_RETRY = 3;
+        static constexpr UINT ID_TIMER_IDLE_WAIT = 4;
+        static constexpr UINT ID_TIMER_WAKE_WAIT = 5;
         static constexpr int ARRIVAL_DEBOUNCE_MS = 1500;
-        static constexpr int ARRIVAL_RETRY_MS = 3000;
-        static constexpr int MAX_ARRIVAL_RETRIES = 3;
+        // Reads after an arrival whose first read found no valid status (the device is often
+        // still enumerating or waking); only that class applies here. A fixed 3 s apart, so the
+        // last one still comes about 9 s after the arrival.
+        static constexpr RetryPolicy ARRIVAL_RETRY{"arrival", 4, {}, {}, {}, {3, 3000, false}, {}};
+        // Oldest status each trigger accepts before it reads the device. Scheduled reads accept
+        // half the update interval, arrival retries none.
+        static constexpr std::chrono::seconds MANUAL_UPDATE_MAX_AGE{2};
+        static constexpr std::chrono::seconds TEST_NOTIFICATION_MAX_AGE{300};
         static constexpr UINT ID_MENU_UPDATE = 1001;
         static constexpr UINT ID_MENU_TRIGGER_LOW_BATTERY = 1002;
         static constexpr UINT ID_MENU_ABOUT = 1003;
@@ -73,10 +85,11 @@ public:
         switch (commandId)
         {
         case Constants::ID_MENU_UPDATE:
-            batteryMonitor.update();
+            batteryMonitor.update(Constants::MANUAL_UPDATE_MAX_AGE);
             break;
         case Constants::ID_MENU_TRIGGER_LOW_BATTERY:
-            batteryMonitor.triggerTestNotification(config.GetLowBatteryThreshold());
+            batteryMonitor.triggerTestNotification(config.GetLowBatteryThreshold(),
+                                                   Constants::TEST_NOTIFICATION_MAX_AGE);
             break;
         case Constants::ID_MENU_ABOUT:
             window.showAboutDialog();
@@ -91,63 +104,94 @@ public:
     {
         if (timerId == Constants::ID_TIMER_UPDATE)
         {
-            batteryMonitor.update();
+            scheduledUpdate();
+        }
+        else if (timerId == Constants::ID_TIMER_IDLE_WAIT)
+        {
+            // One-shot: re-armed by scheduledUpdate while the input has not gone idle
+            window.killTimer(Constants::ID_TIMER_IDLE_WAIT);
+            scheduledUpdate();
+        }
+        else if (timerId == Constants::ID_TIMER_WAKE_WAIT)
+        {
+            // One-shot: re-armed by wakeUpdate while the mouse keeps moving
+            window.killTimer(Constants::ID_TIMER_WAKE_WAIT);
+            wakeUpdate();
         }
         else if (timerId == Constants::ID_TIMER_DEVICE_CHANGE)
         {
             window.killTimer(Constants::ID_TIMER_DEVICE_CHANGE);
 
-            if (pendingDeviceEvent == DBT_DEVICEREMOVECOMPLETE)
+            vector<wstring> removals = std::move(pendingRemovals);
+            vector<wstring> arrivals = std::move(pendingArrivals);
+            pendingRemovals.clear();
+            pendingArrivals.clear();
+
+            if (!removals.empty())
             {
                 LOG_DEBUG("Device change timer fired - USB REMOVAL event");
-                arrivalRetryCount = 0;
+                arrivalRetry.reset();
                 window.killTimer(Constants::ID_TIMER_ARRIVAL_RETRY);
-                batteryMonitor.onDeviceRemoved();
+                batteryMonitor.onDeviceRemoved(std::move(removals));
             }
-            else if (pendingDeviceEvent == DBT_DEVICEARRIVAL)
+
+            if (!arrivals.empty())
             {
                 LOG_DEBUG("Device change timer fired - USB ARRIVAL event");
-                arrivalRetryCount = 0;
-                batteryMonitor.onDeviceArrived();
-
-                if (!batteryMonitor.hasValidStatus())
-                {
-                    LOG_DEBUG("First arrival read failed - scheduling retry in " +
-                              std::to_string(Constants::ARRIVAL_RETRY_MS) + "ms");
-                    window.setDeviceChangeTimer(Constants::ID_TIMER_ARRIVAL_RETRY,
-                                                Constants::ARRIVAL_RETRY_MS);
-                }
+                arrivalRetry.emplace(Constants::ARRIVAL_RETRY);
+                batteryMonitor.onDeviceArrived(std::move(arrivals), [this]
+                                               { onArrivalReadComplete(); });
             }
-            else
+        }
+        else if (timerId == Constants::ID_TIMER_ARRIVAL_RETRY)
+        {
+            // One-shot: re-armed from the completion if another attempt is needed
+            window.killTimer(Constants::ID_TIMER_ARRIVAL_RETRY);
+            if (!arrivalRetry)
             {
-                LOG_DEBUG("Device change timer fired - generic update");
-                batteryMonitor.update();
+                return;
             }
+            LOG_DEBUG("Arrival read " + std::to_string(arrivalRetry->Attempt()) +
+                      "/" + std::to_string(Constants::ARRIVAL_RETRY.maxAttempts));
 
-            pendingDeviceEvent = 0;
+            batteryMonitor.update(std::chrono::milliseconds(0), [this]
+                                                                { onArrivalReadComplete(); });
         }
-        else if (timerId == Constants::ID_TIMER_ARRIVAL_RETRY)
+    }
+
+    void onRawInput(LPARAM lParam)
+    {
+        if (!batteryMonitor.isWakeInput(lParam))
+        {
+            return;
+        }
+        if (!wakeGate)
+        {
+            batteryMonitor.wakeRead();
+            return;
+        }
+        lastWakeInput = IdleGate::Clock::now();
+        if (!wakePending)
         {
-            arrivalRetryCount++;
-            LOG_DEBUG("Arrival retry " + std::to_string(arrivalRetryCount) +
-                      "/" + std::to_string(Constants::MAX_ARRIVAL_RETRIES));
+            wakePending = true;
+            wakeUpdate();
+        }
+    }
 
-            batteryMonitor.update();
+    void onHidCompletion()
+    {
+        batteryMonitor.onEngineCompletion();
+    }
 
-            if (batteryMonitor.hasValidStatus() ||
-                arrivalRetryCount >= Constants::MAX_ARRIVAL_RETRIES)
-            {
-                window.killTimer(Constants::ID_TIMER_ARRIVAL_RETRY);
-                if (batteryMonitor.hasValidStatus())
-                {
-                    LOG_DEBUG("Arrival retry succeeded - battery status acquired");
-                }
-                else
-                {
-                    LOG_DEBUG("Arrival retries exhausted - giving up");
-                }
-                arrivalRetryCount = 0;
-            }
+    void onStatusChanged()
+    {
+        batteryMonitor.onStatusChanged();
+
+        const auto next = batteryMonitor.nextPollInterval();
+        if (next && *next != pollInterval)
+        {
+            pollInterval = *next;
+            window.setUpdateTimer(Constants::ID_TIMER_UPDATE, static_cast<int>(pollInterval.count()));
         }
     }
 
@@ -158,7 +202,10 @@ public:
             PDEV_BROADCAST_HDR hdr = reinterpret_cast<PDEV_BROADCAST_HDR>(lParam);
             if (hdr && hdr->dbch_devicetype == DBT_DEVTYP_DEVICEINTERFACE)
             {
-                pendingDeviceEvent = wParam;
+                // The interface path lets the device index update without a full rescan
+                auto iface = reinterpret_cast<PDEV_BROADCAST_DEVICEINTERFACE_W>(hdr);
+                auto &pending = (wParam == DBT_DEVICEARRIVAL) ? pendingArrivals : pendingRemovals;
+                pending.emplace_back(iface->dbcc_name);
                 LOG_DEBUG(string("USB event received: ") +
                           (wParam == DBT_DEVICEARRIVAL ? "DEVICE_ARRIVAL" : "DEVICE_REMOVE_COMPLETE"));
 
@@ -197,8 +244,101 @@ private:
     AppWindow window;
     BatteryMonitor batteryMonitor;
     UINT taskbarCreatedMsg = 0;
-    WPARAM pendingDeviceEvent = 0;
-    int arrivalRetryCount = 0;
+    // Interface paths collected while the device-change debounce timer runs
+    vector<wstring> pendingArrivals;
+    vector<wstring> pendingRemovals;
+    // Interval of the update timer
+    std::chrono::seconds pollInterval{0};
+    // Set from an arrival until its reads succeed, run out of attempts or a removal cancels them
+    std::optional<RetrySession> arrivalRetry;
+    // Defers scheduled reads out of active input; unset when idle_read_window_ms is 0
+    std::optional<IdleGate> idleGate;
+    // Defers wake reads until the woken mouse stops moving, with the same settings. It goes by the
+    // mouse's own WM_INPUT, so keyboard input does not hold it back.
+    std::optional<IdleGate> wakeGate;
+    // Set from the first input of a sleeping mouse until its wake read is released
+    bool wakePending = false;
+    IdleGate::Clock::time_point lastWakeInput;
+
+    void scheduledUpdate()
+    {
+        if (idleGate)
+        {
+            const auto wait = idleGate->Check(idleFor(), IdleGate::Clock::now());
+            if (wait.count() > 0)
+            {
+                window.setDeviceChangeTimer(Constants::ID_TIMER_IDLE_WAIT, static_cast<int>(wait.count()));
+                return;
+            }
+            if (idleGate->LastForced())
+            {
+                LOG_DEBUG("Scheduled read forced at the deferral limit - keyboard or mouse input never went idle");
+            }
+        }
+        batteryMonitor.scheduledUpdate(pollInterval / 2);
+    }
+
+    void wakeUpdate()
+    {
+        const auto now = IdleGate::Clock::now();
+        const auto wait = wakeGate->Check(std::chrono::duration_cast<std::chrono::milliseconds>(now - lastWakeInput), now);
+        if (wait.count() > 0)
+        {
+            window.setDeviceChangeTimer(Constants::ID_TIMER_WAKE_WAIT, static_cast<int>(wait.count()));
+            return;
+        }
+        wakePending = false;
+        if (wakeGate->LastForced())
+        {
+            LOG_DEBUG("Wake read forced at the deferral limit - the mouse kept moving");
+        }
+        batteryMonitor.wakeRead();
+    }
+
+    // Time since the last keyboard or mouse input of the session. Keyboard input counts too, so
+    // typing (or gaming on the keyboard) defers scheduled reads up to the deferral limit.
+    static std::chrono::milliseconds idleFor()
+    {
+        LASTINPUTINFO info = {};
+        info.cbSize = sizeof(info);
+        if (!GetLastInputInfo(&info))
+        {
+            return std::chrono::milliseconds::max();
+        }
+        // Both are 32-bit tick counts, so the difference survives the wrap after 49.7 days
+        return std::chrono::milliseconds(static_cast<DWORD>(GetTickCount() - info.dwTime));
+    }
+
+    void onArrivalReadComplete()
+    {
+        if (!arrivalRetry)
+        {
+            // A removal event cancelled the retry sequence while this read was in flight
+            return;
+        }
+
+        if (batteryMonitor.hasValidStatus())
+        {
+            if (arrivalRetry->Attempt() > 1)
+            {
+                LOG_DEBUG("Arrival retry succeeded - battery status acquired");
+            }
+            arrivalRetry->OnSuccess();
+            arrivalRetry.reset();
+            return;
+        }
+
+        const auto delay = arrivalRetry->OnFailure(FailureClass::InvalidStatus);
+        if (!delay)
+        {
+            LOG_DEBUG("Arrival retries exhausted - giving up");
+            arrivalRetry.reset();
+            return;
+        }
+
+        LOG_DEBUG("Arrival read failed - scheduling retry in " + std::to_string(*delay) + "ms");
+        window.setDeviceChangeTimer(Constants::ID_TIMER_ARRIVAL_RETRY, static_cast<int>(*delay));
+    }
 
     bool initialize(WNDPROC wndProc)
     {
@@ -240,6 +380,26 @@ private:
         Logger::Instance().SetLogFile("battery_monitor.log");
         LOG_DEBUG("Logger configured");
 
+#ifndef MBM_NO_ENDGAME_GEAR
+        EndgameGearDevice::SetAdaptiveRead(config.GetEndgameAdaptiveRead());
+        TimingStore::Instance().Load("device_timing.ini");
+#endif
+#ifndef MBM_NO_VAXEE
+        VaxeeDevice::SetCommandQueue(config.GetVaxeeCommandQueue());
+        VaxeeDevice::SetChargingRefresh(std::chrono::seconds((std::max)(0, config.GetVaxeeChargingRefreshSeconds())));
+        VaxeeDevice::SetTelemetryAttributes(VaxeeDevice::ParseTelemetrySpecs(config.GetVaxeeTelemetry()));
+        if (!config.GetVaxeeTelemetry().empty() && !config.GetVaxeeCommandQueue())
+        {
+            LOG_ERROR("vaxee_telemetry is ignored without vaxee_command_queue = true");
+        }
+#endif
+
+        if (!config.GetHidTraceDir().empty())
+        {
+            HIDTraceWriter::SetDirectory(config.GetHidTraceDir());
+            LOG_INFO("Recording HID traces to " + config.GetHidTraceDir());
+        }
+
         return true;
     }
 
@@ -295,13 +455,49 @@ private:
         notificationManager.setThreshold(config.GetLowBatteryThreshold());
         notificationManager.setEnabled(config.GetShowNotifications());
 
-        batteryMonitor.init(&trayIcon, &iconLoader, &notificationManager);
+        if (config.GetMonitorAllDevices())
+        {
+            batteryMonitor.enableMultiDevice(config.GetTrayDeviceBreakdown());
+            if (config.GetInputReports())
+            {
+                LOG_INFO("input_reports is not used while monitor_all_devices is on");
+            }
+        }
+        else if (config.GetInputReports())
+        {
+            batteryMonitor.enableInputReports(config.GetInputFallbackIntervalSeconds());
+        }
+        if (config.GetAdaptivePolling())
+        {
+            PollScheduler::Settings settings;
+            settings.base = std::chrono::seconds(config.GetUpdateIntervalSeconds());
+            settings.min = std::chrono::seconds(config.GetPollMinIntervalSeconds());
+            settings.max = std::chrono::seconds(config.GetPollMaxIntervalSeconds());
+            settings.lowThreshold = config.GetLowBatteryThreshold();
+            batteryMonitor.enableAdaptivePolling(settings);
+        }
+        if (config.GetWakeOnInput())
+        {
+            batteryMonitor.enableWakeOnInput();
+        }
+        if (config.GetIdleReadWindowMs() > 0)
+        {
+            IdleGate::Settings settings;
+            settings.idleWindow = std::chrono::milliseconds(config.GetIdleReadWindowMs());
+            settings.maxDeferral = std::chrono::seconds((std::max)(0, config.GetIdleReadMaxDeferralSeconds()));
+            idleGate.emplace(settings);
+            wakeGate.emplace(settings);
+        }
+        batteryMonitor.init(&trayIcon, &iconLoader, &notificationManager,
+                            window.handle(), Constants::WM_HID_COMPLETION,
+                            Constants::WM_STATUS_CHANGED);
 
         taskbarCreatedMsg = window.registerTaskbarCreatedMessage();
         window.registerDeviceNotifications();
-        window.setUpdateTimer(Constants::ID_TIMER_UPDATE, config.GetUpdateIntervalSeconds());
+        pollInterval = std::chrono::seconds(config.GetUpdateIntervalSeconds());
+        window.setUpdateTimer(Constants::ID_TIMER_UPDATE, static_cast<int>(pollInterval.count()));
 
-        batteryMonitor.update();
+        batteryMonitor.update(std::chrono::milliseconds(0));
     }
 
     void showContextMenu()
@@ -326,10 +522,44 @@ private:
         return static_cast<int>(msg.wParam);
     }
 
+    // "<what>: n run after <idle>, n forced at the deferral limit, n deferred, longest wait n ms"
+    static void logIdleGate(const string &what, const IdleGate::Stats &stats, const string &idle)
+    {
+        LOG_INFO(what + ": " + std::to_string(stats.reads - stats.forced) + " run after " + idle + ", " +
+                 std::to_string(stats.forced) + " forced at the deferral limit, " +
+                 std::to_string(stats.deferred) + " deferred, longest wait " +
+                 std::to_string(stats.longestWait.count()) + " ms");
+    }
+
     void shutdown()
     {
         trayIcon.remove();
-        batteryMonitor.devices().Disconnect();
+        batteryMonitor.shutdown();
+        const auto queries = batteryMonitor.getQueryStats();
+        LOG_INFO("Battery queries: " + std::to_string(queries.reads) + " reads, " +
+                 std::to_string(queries.joined) + " joined a read in flight, " +
+                 std::to_string(queries.cacheHits) + " served from cache");
+        const auto sleep = batteryMonitor.getSleepStats();
+        if (sleep.slept.count() > 0)
+        {
+            const double hours = std::chrono::duration<double, std::ratio<3600>>(sleep.slept).count();
+            LOG_INFO("Mouse asleep " + std::to_string(sleep.slept.count() / 60000) + " min: " +
+                     std::to_string(sleep.skippedReads) + " reads skipped (" +
+                     std::to_string(static_cast<int>(sleep.skippedReads / hours + 0.5)) + " per hour), " +
+                     std::to_string(sleep.wakeReads) + " woken by input");
+        }
+        if (idleGate)
+        {
+            logIdleGate("Scheduled reads", idleGate->GetStats(), "input went idle");
+            logIdleGate("Wake reads", wakeGate->GetStats(), "the mouse stopped");
+        }
+        for (const auto &entry : RetryStats::Instance().Snapshot())
+        {
+            LOG_INFO("Retries " + RetryStats::Format(entry));
+        }
+#ifndef MBM_NO_ENDGAME_GEAR
+        TimingStore::Instance().Flush();
+#endif
         LOG_INFO("Shutting down");
     }
 };
@@ -2,196 +2,243 @@
 
 #include <string>
 #include <sstream>
-#include "device_manager.hpp"
+#include <functional>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <optional>
+#include "device_worker.hpp"
+#include "poll_scheduler.hpp"
 #include "logger.hpp"
 #include "ui/icon_loader.hpp"
 #include "ui/tray_icon.hpp"
 #include "ui/notification_manager.hpp"
+#include "ui/raw_input_monitor.hpp"
 
 using std::string;
 using std::wstring;
 using std::wstringstream;
+using std::vector;
 
+// UI side of the device worker: renders published status snapshots into the tray icon and
+// notifications. Nothing here waits on HID; every read runs on the worker's engine thread.
 class BatteryMonitor
 {
 public:
     BatteryMonitor() = default;
 
-    void init(TrayIcon *tray, IconLoader *icons, NotificationManager *notifications)
+    void init(TrayIcon *tray, IconLoader *icons, NotificationManager *notifications,
+              HWND window, UINT completionMessage, UINT statusMessage)
     {
         trayIcon = tray;
         iconLoader = icons;
         notificationMgr = notifications;
+        hwnd = window;
+
+        // Device-interface notifications keep the device index current from here on
+        worker.EnableNotificationTracking();
+        worker.Start([window, completionMessage]
+                     { PostMessage(window, completionMessage, 0, 0); },
+                     [this, window, statusMessage](const StatusSnapshot &)
+                     {
+                         // One message covers any number of changes until the UI has loaded
+                         // the latest snapshot
+                         if (!statusPosted.exchange(true))
+                         {
+                             PostMessage(window, statusMessage, 0, 0);
+                         }
+                     });
     }
 
-    void update()
+    // Listens for unsolicited status reports from the active device. Once a device has delivered
+    // one, scheduled feature-report reads drop to the fallback interval. Call before init().
+    void enableInputReports(int fallbackSeconds)
     {
-        LOG_DEBUG("Updating battery status");
+        worker.EnableInputReports(std::chrono::seconds(fallbackSeconds));
+    }
 
-        ensureConnected();
+    // Monitors every attached supported device instead of only the best one. The tray icon shows
+    // the lowest battery; the tooltip lists every device when breakdown is set, otherwise only
+    // the lowest. Call before init().
+    void enableMultiDevice(bool breakdown)
+    {
+        multiDevice = true;
+        trayBreakdown = breakdown;
+        worker.EnableMultiDevice();
+    }
 
-        try
-        {
-            auto status = deviceManager.ReadBattery();
+    // Spaces scheduled reads by the last readings instead of a fixed interval; see PollScheduler
+    void enableAdaptivePolling(const PollScheduler::Settings &settings)
+    {
+        scheduler.emplace(settings);
+    }
 
-            if (status.percentage < 0)
-            {
-                handleReadFailure();
-            }
-            else
-            {
-                consecutiveFailures = 0;
-                handleConnected(status);
-            }
-        }
-        catch (const std::exception &ex)
-        {
-            LOG_ERROR("Exception in BatteryMonitor::update: " + string(ex.what()));
-            handleReadFailure();
-        }
-        catch (...)
+    // Reads a sleeping mouse as soon as it is used again, from Raw Input activity of a supported
+    // device. Mouse input is only received while the shown status is asleep.
+    void enableWakeOnInput()
+    {
+        wakeOnInput = true;
+    }
+
+    // Delay before the next scheduled read; nullopt with a fixed interval
+    std::optional<std::chrono::seconds> nextPollInterval() const
+    {
+        if (!scheduler)
         {
-            LOG_ERROR("Unknown exception in BatteryMonitor::update");
-            handleReadFailure();
+            return std::nullopt;
         }
+        return scheduler->NextInterval();
     }
 
-    // Called from Application when a real USB DBT_DEVICEREMOVECOMPLETE event fires
-    void onDeviceRemoved()
+    // Stops the device worker and releases the device; called once the message loop has exited
+    void shutdown()
     {
-        LOG_INFO("USB device removal event - forcing disconnect");
-        consecutiveFailures = 0;
-        lastKnownStatus = {};
-        lastKnownDeviceName.clear();
-        lastKnownConnectionMode.clear();
-        deviceManager.Disconnect();
+        rawInput.stop();
+        worker.Stop();
+    }
 
-        if (trayIcon && iconLoader)
-        {
-            trayIcon->update(iconLoader->GetDisconnectedIcon(),
-                             L"Mouse Battery Monitor\nNo device connected");
-        }
+    // Asks the device worker for a status at most maxAge old, from its cache or by reading (or
+    // joining the read in flight); onComplete (if any) runs on the UI thread once it is published
+    void update(std::chrono::milliseconds maxAge, std::function<void()> onComplete = nullptr)
+    {
+        LOG_DEBUG("Updating battery status (max age " + std::to_string(maxAge.count()) + " ms)");
+        worker.Query(maxAge, std::move(onComplete));
     }
 
-    bool hasValidStatus() const
+    // Periodic timer tick; skipped while input reports keep the status current
+    void scheduledUpdate(std::chrono::milliseconds maxAge)
     {
-        return lastKnownStatus.percentage >= 0;
+        worker.ScheduledQuery(maxAge);
     }
 
-    // Called from Application when a real USB DBT_DEVICEARRIVAL event fires
-    void onDeviceArrived()
+    DeviceWorker::QueryStats getQueryStats() const
     {
-        LOG_INFO("USB device arrival event - attempting connection");
-        consecutiveFailures = 0;
-        update();
+        return worker.GetQueryStats();
     }
 
-    void triggerTestNotification(int fallbackPercentage)
+    DeviceWorker::SleepStats getSleepStats() const
     {
-        auto status = deviceManager.ReadBattery();
-        int percentage = status.percentage >= 0 ? status.percentage : fallbackPercentage;
-        wstring name = deviceManager.IsConnected() ? deviceManager.GetDeviceName() : L"";
-        notificationMgr->triggerTestNotification(percentage, name);
+        return worker.GetSleepStats();
     }
 
-    DeviceManager &devices() { return deviceManager; }
-    const DeviceManager &devices() const { return deviceManager; }
+    // WM_INPUT from the window procedure; true if it came from a supported mouse while its
+    // status is asleep, i.e. it may call for a wake read
+    bool isWakeInput(LPARAM lParam)
+    {
+        return rawInput.isRunning() && rawInput.isSupportedDevice(lParam);
+    }
 
-private:
-    DeviceManager deviceManager;
-    TrayIcon *trayIcon = nullptr;
-    IconLoader *iconLoader = nullptr;
-    NotificationManager *notificationMgr = nullptr;
+    // Reads the sleeping mouse now, unless it has woken up meanwhile
+    void wakeRead()
+    {
+        worker.OnInputActivity();
+    }
 
-    // Cached last good state for sleep tolerance
-    DeviceManager::BatteryStatus lastKnownStatus{};
-    wstring lastKnownDeviceName;
-    wstring lastKnownConnectionMode;
-    int consecutiveFailures = 0;
+    // Runs completions posted by the device worker; called from the window procedure
+    void onEngineCompletion()
+    {
+        worker.DrainCompletions();
+    }
 
-    void ensureConnected()
+    // The worker published a different snapshot; called from the window procedure
+    void onStatusChanged()
     {
-        if (!deviceManager.IsConnected())
+        statusPosted = false;
+        const StatusSnapshot snapshot = worker.Snapshot();
+        if (snapshot == displayed)
         {
-            LOG_DEBUG("Device not connected, attempting to find and connect");
-            if (deviceManager.FindAndConnect())
-            {
-                LOG_INFO("Device connected successfully");
-            }
+            return;
         }
-        else
+        displayed = snapshot;
+        updateTray();
+        updateWakeWatch();
+        if (scheduler)
         {
-            deviceManager.ShouldSwitchDevice();
+            scheduler->OnStatus(displayed.shown.percentage, displayed.shown.isCharging, displayed.shown.asleep,
+                                PollScheduler::Clock::now());
         }
-    }
 
-    void handleReadFailure()
-    {
-        consecutiveFailures++;
-        LOG_DEBUG("Battery read failed (consecutive failures: " +
-                  std::to_string(consecutiveFailures) + ")");
-
-        // Check if the dongle/device handle is still open
-        bool donglePresent = deviceManager.IsConnected();
-        bool hasLastKnown = lastKnownStatus.percentage >= 0;
-
-        LOG_DEBUG("Dongle still present: " + string(donglePresent ? "Yes" : "No") +
-                  ", Has cached battery: " + string(hasLastKnown ? "Yes" : "No") +
-                  (hasLastKnown ? " (" + std::to_string(lastKnownStatus.percentage) + "%)" : ""));
-
-        if (donglePresent && hasLastKnown)
+        if (!notificationMgr || !displayed.HasStatus())
         {
-            // Dongle handle is still valid but mouse isn't responding - likely sleeping
-            LOG_DEBUG("Mouse appears to be sleeping - keeping last known battery: " +
-                      std::to_string(lastKnownStatus.percentage) + "%");
+            return;
         }
-        else
+        if (multiDevice)
         {
-            // No dongle or never had a good read - try reconnection
-            LOG_DEBUG("No dongle handle or no cached status - attempting reconnection");
-            deviceManager.Disconnect();
-
-            if (deviceManager.FindAndConnect())
+            for (size_t i = 0; i < displayed.deviceCount; ++i)
             {
-                LOG_INFO("Device reconnected after mode switch");
-            }
-            else
-            {
-                handleDisconnected();
+                const auto &device = displayed.devices[i];
+                notificationMgr->checkLowBattery(device.percentage, device.isCharging, wstring(device.name));
             }
+            return;
         }
+        notificationMgr->checkLowBattery(displayed.shown.percentage, displayed.shown.isCharging, wstring(displayed.shown.name));
     }
 
-    void handleDisconnected()
+    // Called from Application with the interface paths of debounced DBT_DEVICEREMOVECOMPLETE events
+    void onDeviceRemoved(vector<wstring> paths)
     {
-        LOG_DEBUG("Device fully disconnected - showing disconnected icon");
-        lastKnownStatus = {};
-        lastKnownDeviceName.clear();
-        lastKnownConnectionMode.clear();
+        LOG_INFO("USB device removal event (" + std::to_string(paths.size()) + " interfaces)");
+        worker.OnDevicesRemoved(std::move(paths));
+    }
 
-        if (trayIcon && iconLoader)
-        {
-            trayIcon->update(iconLoader->GetDisconnectedIcon(),
-                             L"Mouse Battery Monitor\nNo device connected");
-        }
+    // Lock-free; reflects the latest published snapshot even before the UI has rendered it
+    bool hasValidStatus() const
+    {
+        return worker.HasStatus();
+    }
+
+    // Called from Application with the interface paths of debounced DBT_DEVICEARRIVAL events
+    void onDeviceArrived(vector<wstring> paths, std::function<void()> onComplete = nullptr)
+    {
+        LOG_INFO("USB device arrival event (" + std::to_string(paths.size()) + " interfaces)");
+        worker.OnDevicesArrived(std::move(paths), std::move(onComplete));
     }
 
-    void handleConnected(const DeviceManager::BatteryStatus &status)
+    // Shows a low-battery notification for the current device, from a status at most maxAge old
+    void triggerTestNotification(int fallbackPercentage, std::chrono::milliseconds maxAge)
     {
-        LOG_DEBUG("Battery: " + std::to_string(status.percentage) + "%, Charging: " +
-                  (status.isCharging ? "Yes" : "No"));
+        worker.Query(maxAge, [this, fallbackPercentage]
+                     {
+                         const StatusSnapshot snapshot = worker.Snapshot();
+                         const int percentage = snapshot.HasStatus() ? snapshot.shown.percentage : fallbackPercentage;
+                         notificationMgr->triggerTestNotification(percentage, wstring(snapshot.shown.name)); });
+    }
+
+private:
+    DeviceWorker worker;
+    TrayIcon *trayIcon = nullptr;
+    IconLoader *iconLoader = nullptr;
+    NotificationManager *notificationMgr = nullptr;
 
-        // Cache the good reading
-        lastKnownStatus = status;
-        lastKnownDeviceName = deviceManager.GetDeviceName();
-        lastKnownConnectionMode = deviceManager.GetConnectionMode();
+    bool multiDevice = false;
+    bool trayBreakdown = true;
+    std::optional<PollScheduler> scheduler;
+    HWND hwnd = nullptr;
+    bool wakeOnInput = false;
+    RawInputMonitor rawInput;
 
-        updateTray();
+    // szTip of NOTIFYICONDATAW holds 128 characters including the terminator
+    static constexpr size_t TOOLTIP_MAX_CHARS = 127;
+
+    // Snapshot the tray currently shows (UI thread)
+    StatusSnapshot displayed;
+    // Set by the engine thread when it posts a status message, cleared once the UI handles it
+    std::atomic<bool> statusPosted{false};
 
-        if (notificationMgr)
+    // Mouse input is only worth receiving while it can wake a sleeping device
+    void updateWakeWatch()
+    {
+        if (!wakeOnInput)
+        {
+            return;
+        }
+        if (DeviceWorker::IsAsleep(displayed))
+        {
+            rawInput.start(hwnd);
+        }
+        else
         {
-            notificationMgr->checkLowBattery(status.percentage, status.isCharging,
-                                             deviceManager.GetDeviceName());
+            rawInput.stop();
         }
     }
 
@@ -200,7 +247,7 @@ private:
         if (!trayIcon || !iconLoader)
             return;
 
-        if (lastKnownStatus.percentage < 0)
+        if (!displayed.HasStatus())
         {
             trayIcon->update(iconLoader->GetDisconnectedIcon(),
                              L"Mouse Battery Monitor\nNo device connected");
@@ -208,16 +255,32 @@ private:
         }
 
         trayIcon->update(
-            iconLoader->GetBatteryIcon(lastKnownStatus.percentage, lastKnownStatus.isCharging),
+            iconLoader->GetBatteryIcon(displayed.shown.percentage, displayed.shown.isCharging),
             buildTooltip());
     }
 
     wstring buildTooltip()
     {
+        if (multiDevice && trayBreakdown && displayed.deviceCount > 1)
+        {
+            wstringstream ss;
+            for (size_t i = 0; i < displayed.deviceCount; ++i)
+            {
+                const auto &device = displayed.devices[i];
+                if (ss.tellp() > 0)
+                {
+                    ss << L"\n";
+                }
+                ss << device.name << L": " << device.percentage << L"%"
+                   << (device.isCharging ? L" (charging)" : L"");
+            }
+            return ss.str().substr(0, TOOLTIP_MAX_CHARS);
+        }
+
         wstringstream ss;
-        ss << lastKnownDeviceName << L"\n"
-           << lastKnownConnectionMode << L"\n"
-           << L"Battery: " << lastKnownStatus.percentage << L"%";
+        ss << displayed.shown.name << L"\n"
+           << displayed.shown.connectionMode << L"\n"
+           << L"Battery: " << displayed.shown.percentage << L"%";
         return ss.str();
     }
 };
@@ -14,7 +14,20 @@ public:
     Config() : updateIntervalSeconds(300),
                showNotifications(true),
                lowBatteryThreshold(20),
-               debugMode(false) {}
+               debugMode(false),
+               inputReports(false),
+               inputFallbackIntervalSeconds(1800),
+               endgameAdaptiveRead(false),
+               vaxeeCommandQueue(false),
+               vaxeeChargingRefreshSeconds(1800),
+               monitorAllDevices(false),
+               trayDeviceBreakdown(true),
+               adaptivePolling(true),
+               pollMinIntervalSeconds(60),
+               pollMaxIntervalSeconds(3600),
+               wakeOnInput(true),
+               idleReadWindowMs(500),
+               idleReadMaxDeferralSeconds(60) {}
 
     bool Load(const string &filename)
     {
@@ -35,7 +48,52 @@ public:
              { lowBatteryThreshold = std::stoi(v); }},
 
             {"debug_mode", [this](const string &v)
-             { debugMode = ParseBool(v); }}};
+             { debugMode = ParseBool(v); }},
+
+            {"hid_trace_dir", [this](const string &v)
+             { hidTraceDir = v; }},
+
+            {"input_reports", [this](const string &v)
+             { inputReports = ParseBool(v); }},
+
+            {"input_fallback_interval_seconds", [this](const string &v)
+             { inputFallbackIntervalSeconds = std::stoi(v); }},
+
+            {"endgame_adaptive_read", [this](const string &v)
+             { endgameAdaptiveRead = ParseBool(v); }},
+
+            {"vaxee_command_queue", [this](const string &v)
+             { vaxeeCommandQueue = ParseBool(v); }},
+
+            {"vaxee_telemetry", [this](const string &v)
+             { vaxeeTelemetry = v; }},
+
+            {"vaxee_charging_refresh_seconds", [this](const string &v)
+             { vaxeeChargingRefreshSeconds = std::stoi(v); }},
+
+            {"monitor_all_devices", [this](const string &v)
+             { monitorAllDevices = ParseBool(v); }},
+
+            {"tray_device_breakdown", [this](const string &v)
+             { trayDeviceBreakdown = ParseBool(v); }},
+
+            {"adaptive_polling", [this](const string &v)
+             { adaptivePolling = ParseBool(v); }},
+
+            {"poll_min_interval_seconds", [this](const string &v)
+             { pollMinIntervalSeconds = std::stoi(v); }},
+
+            {"poll_max_interval_seconds", [this](const string &v)
+             { pollMaxIntervalSeconds = std::stoi(v); }},
+
+            {"wake_on_input", [this](const string &v)
+             { wakeOnInput = ParseBool(v); }},
+
+            {"idle_read_window_ms", [this](const string &v)
+             { idleReadWindowMs = std::stoi(v); }},
+
+            {"idle_read_max_deferral_seconds", [this](const string &v)
+             { idleReadMaxDeferralSeconds = std::stoi(v); }}};
 
         string line;
         while (std::getline(file, line))
@@ -57,12 +115,42 @@ public:
     bool GetShowNotifications() const { return showNotifications; }
     int GetLowBatteryThreshold() const { return lowBatteryThreshold; }
     bool GetDebugMode() const { return debugMode; }
+    const string &GetHidTraceDir() const { return hidTraceDir; }
+    bool GetInputReports() const { return inputReports; }
+    int GetInputFallbackIntervalSeconds() const { return inputFallbackIntervalSeconds; }
+    bool GetEndgameAdaptiveRead() const { return endgameAdaptiveRead; }
+    bool GetVaxeeCommandQueue() const { return vaxeeCommandQueue; }
+    const string &GetVaxeeTelemetry() const { return vaxeeTelemetry; }
+    int GetVaxeeChargingRefreshSeconds() const { return vaxeeChargingRefreshSeconds; }
+    bool GetMonitorAllDevices() const { return monitorAllDevices; }
+    bool GetTrayDeviceBreakdown() const { return trayDeviceBreakdown; }
+    bool GetAdaptivePolling() const { return adaptivePolling; }
+    int GetPollMinIntervalSeconds() const { return pollMinIntervalSeconds; }
+    int GetPollMaxIntervalSeconds() const { return pollMaxIntervalSeconds; }
+    bool GetWakeOnInput() const { return wakeOnInput; }
+    int GetIdleReadWindowMs() const { return idleReadWindowMs; }
+    int GetIdleReadMaxDeferralSeconds() const { return idleReadMaxDeferralSeconds; }
 
 private:
     int updateIntervalSeconds;
     bool showNotifications;
     int lowBatteryThreshold;
     bool debugMode;
+    string hidTraceDir;
+    bool inputReports;
+    int inputFallbackIntervalSeconds;
+    bool endgameAdaptiveRead;
+    bool vaxeeCommandQueue;
+    string vaxeeTelemetry;
+    int vaxeeChargingRefreshSeconds;
+    bool monitorAllDevices;
+    bool trayDeviceBreakdown;
+    bool adaptivePolling;
+    int pollMinIntervalSeconds;
+    int pollMaxIntervalSeconds;
+    bool wakeOnInput;
+    int idleReadWindowMs;
+    int idleReadMaxDeferralSeconds;
 
     struct KeyValue
     {
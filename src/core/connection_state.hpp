@@ -0,0 +1,392 @@
+#pragma once
+
+#include "core/device_manager.hpp"
+#include "core/hid_transport.hpp"
+#include "core/logger.hpp"
+#include <string>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+
+using std::string;
+using std::wstring;
+
+// Connection lifecycle of the monitored device:
+//   Disconnected -> Probing       a poll looks for a device
+//   Probing      -> Connected     one was found;  -> Backoff when nothing was found
+//   Connected    -> Sleeping      no answer while an earlier status is cached; a read ok returns
+//   Connected    -> Disconnected  no answer and nothing cached: reconnect through the index, or
+//                -> Backoff       once BREAKER_THRESHOLD reads failed on that path (circuit open)
+// Backoff waits a jittered, exponentially growing delay before the next probe or, with an open
+// circuit, a half-open read on the kept handle, so neither reopens nor rescans happen meanwhile.
+// Sleeping likewise spaces the reads of the kept handle, from SLEEP_BACKOFF_BASE up to
+// SLEEP_BACKOFF_MAX, since a sleeping mouse answers only once it is used again; input activity
+// from the mouse (OnActivity) ends that wait. A presence change ends any backoff at once. Circuit
+// breakers are kept per interface path.
+class ConnectionStateMachine
+{
+public:
+    using Clock = HIDTransport::Clock;
+
+    enum class State
+    {
+        Disconnected,
+        Probing,
+        Connected,
+        Sleeping,
+        Backoff
+    };
+
+    // What the next poll should do
+    enum class Action
+    {
+        Skip,  // backing off; no HID work at all
+        Probe, // look for a device and connect
+        Read   // read the connected device
+    };
+
+    // How to go on after a failed read
+    enum class Recovery
+    {
+        Keep,     // keep the handle (sleeping mouse or open circuit)
+        Reconnect // reopen through the device index
+    };
+
+    struct Transition
+    {
+        State from;
+        State to;
+        const char *reason;
+    };
+
+    using TransitionHandler = std::function<void(const Transition &)>;
+
+    static constexpr std::chrono::seconds BACKOFF_BASE{30};
+    // A mouse switched on behind its dongle raises no device notification, so the longest wait
+    // matches the default poll interval
+    static constexpr std::chrono::seconds BACKOFF_MAX{300};
+    // Each delay is scaled by a random factor within +/- this share
+    static constexpr double BACKOFF_JITTER = 0.2;
+    // Consecutive failed reads without a cached status on one path before its circuit opens
+    static constexpr int BREAKER_THRESHOLD = 3;
+    // Wait before reading a sleeping mouse again, doubling with every read it does not answer
+    static constexpr std::chrono::seconds SLEEP_BACKOFF_BASE{120};
+    static constexpr std::chrono::seconds SLEEP_BACKOFF_MAX{3600};
+
+    ConnectionStateMachine() : random(std::random_device{}()) {}
+
+    void Seed(uint32_t seed) { random.seed(seed); }
+
+    // false reads a sleeping mouse on every poll, as before the sleep backoff (for comparison)
+    void SetSleepBackoff(bool enabled) { sleepBackoff = enabled; }
+
+    // Called on every state change, on the thread driving the machine
+    void SetTransitionHandler(TransitionHandler handler) { transitionHandler = std::move(handler); }
+
+    State GetState() const { return state; }
+    Clock::time_point GetRetryAt() const { return retryAt; }
+    size_t GetTransitionCount(State to) const { return transitionCounts[static_cast<size_t>(to)]; }
+
+    Action NextAction(Clock::time_point now) const
+    {
+        switch (state)
+        {
+        case State::Backoff:
+            if (now < retryAt)
+            {
+                return Action::Skip;
+            }
+            return halfOpenPath.empty() ? Action::Probe : Action::Read;
+        case State::Sleeping:
+            return now < retryAt ? Action::Skip : Action::Read;
+        case State::Connected:
+            return Action::Read;
+        default:
+            return Action::Probe;
+        }
+    }
+
+    void OnProbeStarted()
+    {
+        MoveTo(State::Probing, "probing");
+    }
+
+    void OnProbeResult(bool connected, Clock::time_point now)
+    {
+        halfOpenPath.clear();
+        if (connected)
+        {
+            probeFailures = 0;
+            MoveTo(State::Connected, "device found");
+            return;
+        }
+        EnterBackoff(now, ++probeFailures, "nothing found");
+    }
+
+    void OnReadSucceeded(const wstring &path)
+    {
+        breakers.erase(path);
+        halfOpenPath.clear();
+        probeFailures = 0;
+        sleepProbes = 0;
+        MoveTo(State::Connected, "read ok");
+    }
+
+    // handleOpen: the handle survived the read; hasStatus: an earlier read succeeded
+    Recovery OnReadFailed(const wstring &path, bool handleOpen, bool hasStatus, Clock::time_point now)
+    {
+        if (handleOpen && hasStatus)
+        {
+            retryAt = {};
+            if (sleepBackoff)
+            {
+                retryAt = now + Jittered(++sleepProbes, SLEEP_BACKOFF_BASE, SLEEP_BACKOFF_MAX);
+                LOG_DEBUG("Connection: no answer, status cached - next read in " + SecondsUntil(now) + " s");
+            }
+            MoveTo(State::Sleeping, "no answer, status cached");
+            return Recovery::Keep;
+        }
+
+        Breaker &breaker = breakers[path];
+        ++breaker.failures;
+        if (handleOpen && breaker.failures >= BREAKER_THRESHOLD)
+        {
+            halfOpenPath = path;
+            EnterBackoff(now, ++breaker.trips, "circuit open");
+            return Recovery::Keep;
+        }
+        MoveTo(State::Disconnected, handleOpen ? "no answer, reconnecting" : "handle lost");
+        return Recovery::Reconnect;
+    }
+
+    // A supported device arrived or left: whatever the backoff waited for may have changed
+    void OnPresenceChanged(bool connected)
+    {
+        breakers.clear();
+        halfOpenPath.clear();
+        probeFailures = 0;
+        sleepProbes = 0;
+        retryAt = {};
+        if (state == State::Backoff || !connected)
+        {
+            MoveTo(connected ? State::Connected : State::Disconnected, "device change");
+        }
+    }
+
+    // Input from the mouse: if it was sleeping, the next poll reads it. Returns whether it was.
+    bool OnActivity()
+    {
+        if (state != State::Sleeping)
+        {
+            return false;
+        }
+        retryAt = {};
+        sleepProbes = 0;
+        return true;
+    }
+
+    static const char *ToString(State state)
+    {
+        switch (state)
+        {
+        case State::Disconnected:
+            return "Disconnected";
+        case State::Probing:
+            return "Probing";
+        case State::Connected:
+            return "Connected";
+        case State::Sleeping:
+            return "Sleeping";
+        case State::Backoff:
+            return "Backoff";
+        }
+        return "Unknown";
+    }
+
+private:
+    struct Breaker
+    {
+        int failures = 0;
+        int trips = 0;
+    };
+
+    State state = State::Disconnected;
+    Clock::time_point retryAt{};
+    // Path whose open circuit the backoff is for; empty when backing off from failed probes
+    wstring halfOpenPath;
+    std::unordered_map<wstring, Breaker> breakers;
+    int probeFailures = 0;
+    int sleepProbes = 0;
+    bool sleepBackoff = true;
+    std::mt19937 random;
+    TransitionHandler transitionHandler;
+    size_t transitionCounts[5] = {};
+
+    // base * 2^(attempt - 1), capped at max and scaled by the jitter
+    Clock::duration Jittered(int attempt, std::chrono::seconds base, std::chrono::seconds max)
+    {
+        const int doublings = (std::min)(attempt - 1, 16);
+        const auto delay = (std::min)(std::chrono::duration<double>(base) * (1 << doublings),
+                                      std::chrono::duration<double>(max));
+        std::uniform_real_distribution<double> jitter(1.0 - BACKOFF_JITTER, 1.0 + BACKOFF_JITTER);
+        return std::chrono::duration_cast<Clock::duration>(delay * jitter(random));
+    }
+
+    string SecondsUntil(Clock::time_point now) const
+    {
+        return std::to_string(static_cast<int>(std::chrono::duration<double>(retryAt - now).count()));
+    }
+
+    void EnterBackoff(Clock::time_point now, int attempt, const char *reason)
+    {
+        retryAt = now + Jittered(attempt, BACKOFF_BASE, BACKOFF_MAX);
+        LOG_DEBUG(string("Connection: ") + reason + " - next attempt in " + SecondsUntil(now) + " s");
+        MoveTo(State::Backoff, reason);
+    }
+
+    void MoveTo(State to, const char *reason)
+    {
+        if (to == state)
+        {
+            return;
+        }
+        const Transition transition{state, to, reason};
+        state = to;
+        ++transitionCounts[static_cast<size_t>(to)];
+        if (transitionHandler)
+        {
+            transitionHandler(transition);
+        }
+    }
+};
+
+// Runs one poll of DeviceManager in single-device mode as the state machine directs. Engine
+// thread (or the tool's main thread).
+class ConnectionSupervisor
+{
+public:
+    using State = ConnectionStateMachine::State;
+
+    enum class Outcome
+    {
+        Success,
+        Sleeping,
+        Reconnected,
+        TimedOut,
+        BackingOff,
+        Disconnected
+    };
+
+    struct Result
+    {
+        Outcome outcome = Outcome::Disconnected;
+        DeviceManager::BatteryStatus status{};
+        // The state machine held the read back; nothing was sent
+        bool skipped = false;
+    };
+
+    explicit ConnectionSupervisor(DeviceManager &manager) : manager(manager) {}
+
+    ConnectionStateMachine &Machine() { return machine; }
+    const ConnectionStateMachine &Machine() const { return machine; }
+
+    // hasCachedStatus: the caller still shows an earlier reading
+    Result Poll(bool hasCachedStatus)
+    {
+        Result result;
+        const auto now = ConnectionStateMachine::Clock::now();
+        const auto action = machine.NextAction(now);
+        if (action == ConnectionStateMachine::Action::Skip)
+        {
+            result.skipped = true;
+            if (machine.GetState() == State::Sleeping)
+            {
+                ++skippedSleepReads;
+                result.outcome = Outcome::Sleeping;
+                return result;
+            }
+            result.outcome = Outcome::BackingOff;
+            return result;
+        }
+
+        if (action == ConnectionStateMachine::Action::Probe || !manager.IsConnected())
+        {
+            if (!Probe(now))
+            {
+                return result;
+            }
+        }
+        else
+        {
+            manager.ShouldSwitchDevice();
+        }
+
+        result.status = manager.ReadBattery();
+        if (result.status.percentage >= 0)
+        {
+            machine.OnReadSucceeded(manager.GetDevicePath());
+            result.outcome = Outcome::Success;
+            return result;
+        }
+        if (manager.LastReadTimedOut())
+        {
+            // The handle has already been recycled; the next read uses the fresh one
+            result.outcome = Outcome::TimedOut;
+            return result;
+        }
+
+        const bool handleOpen = manager.IsConnected();
+        LOG_DEBUG("Dongle still present: " + string(handleOpen ? "Yes" : "No") +
+                  ", Has cached battery: " + string(hasCachedStatus ? "Yes" : "No"));
+        const auto recovery = machine.OnReadFailed(manager.GetDevicePath(), handleOpen, hasCachedStatus, now);
+        if (recovery == ConnectionStateMachine::Recovery::Keep)
+        {
+            result.outcome = machine.GetState() == State::Sleeping ? Outcome::Sleeping : Outcome::BackingOff;
+            return result;
+        }
+
+        manager.Disconnect();
+        if (Probe(now))
+        {
+            LOG_INFO("Device reconnected after mode switch");
+            result.outcome = Outcome::Reconnected;
+        }
+        return result;
+    }
+
+    // A supported device arrived or was removed
+    void OnPresenceChanged()
+    {
+        machine.OnPresenceChanged(manager.IsConnected());
+    }
+
+    // Input from the mouse; true if it was sleeping, so the next poll reads it
+    bool OnActivity()
+    {
+        return machine.OnActivity();
+    }
+
+    // Polls that skipped the read of a sleeping mouse; readable from any thread
+    size_t GetSkippedSleepReads() const { return skippedSleepReads; }
+
+private:
+    DeviceManager &manager;
+    ConnectionStateMachine machine;
+    std::atomic<size_t> skippedSleepReads{0};
+
+    bool Probe(ConnectionStateMachine::Clock::time_point now)
+    {
+        machine.OnProbeStarted();
+        const bool connected = manager.FindAndConnect();
+        machine.OnProbeResult(connected, now);
+        if (connected)
+        {
+            LOG_INFO("Device connected successfully");
+        }
+        return connected;
+    }
+};
@@ -1,130 +1,561 @@
 #pragma once
 
 #include "devices/mouse_device.hpp"
-#include "devices/endgame_gear_device.hpp"
-#include "devices/endgame_gear_mouse.hpp"
-#include "devices/endgame_gear_dongle.hpp"
-#include "devices/vaxee_device.hpp"
-#include "devices/vaxee_mouse.hpp"
-#include "devices/vaxee_dongle.hpp"
+#include "devices/device_registry.hpp"
+#include "core/hid_device_index.hpp"
+#include "core/hid_handle_pool.hpp"
 #include "core/logger.hpp"
-#include <memory>
 #include <vector>
-#include <algorithm>
 #include <string>
+#include <future>
+#include <deque>
+#include <chrono>
+#include <system_error>
+#include <cstdint>
 
 using std::string;
-using std::unique_ptr;
 using std::vector;
 using std::wstring;
 
+// Owns one instance of every registered device class (see devices/device_registry.hpp) and
+// forwards to the active one. Calls are dispatched statically by registry slot. In multi-device
+// mode every class that finds a device stays connected; the active device is then the connected
+// one with the best priority. Handles come from a pool that keeps them open after a switch, so
+// switching back to a device that stayed present only repoints the device class.
 class DeviceManager
 {
 public:
     using BatteryStatus = MouseDevice::BatteryStatus;
+    using Registry = RegisteredDeviceSet;
 
-    DeviceManager()
+    using Clock = HIDTransport::Clock;
+
+    // Hysteresis for priority switches: once FLAP_LIMIT switches (up or failover) happened
+    // within FLAP_WINDOW, e.g. a cable plugged in and out or a mouse flipping between wired and
+    // wireless, a switch to a better device waits until the set of present devices has been
+    // unchanged for SWITCH_HOLD
+    static constexpr size_t FLAP_LIMIT = 3;
+    static constexpr std::chrono::seconds FLAP_WINDOW{60};
+    static constexpr std::chrono::seconds SWITCH_HOLD{10};
+
+    // What ShouldSwitchDevice did since the manager was created
+    struct SwitchStats
     {
-        // Endgame Gear devices
-        devices.push_back(std::make_unique<EndgameGearMouse>());
-        devices.push_back(std::make_unique<EndgameGearDongle>());
+        size_t checks = 0;      // calls while a better device class exists
+        size_t rescans = 0;     // full enumerations the checks ran
+        size_t probes = 0;      // FindAndConnect attempts on better devices
+        size_t switches = 0;
+        size_t deferred = 0;    // switches held back by the hysteresis
+    };
 
-        // VAXEE devices
-        devices.push_back(std::make_unique<VaxeeMouse>());
-        devices.push_back(std::make_unique<VaxeeDongle>());
+    // One device's result from ReadAll
+    struct DeviceReading
+    {
+        size_t slot = Registry::NONE;
+        BatteryStatus status{};
+        std::wstring_view name;
+        std::wstring_view connectionMode;
+        // Still connected after the read, possibly on a recycled handle
+        bool connected = false;
+    };
 
-        std::sort(devices.begin(), devices.end(),
-                  [](const auto &a, const auto &b)
-                  {
-                      return a->GetPriority() < b->GetPriority();
-                  });
-    }
+    DeviceManager() = default;
 
     bool FindAndConnect()
     {
-        for (auto &device : devices)
+        const bool refreshed = index.IsStale();
+        if (refreshed)
+        {
+            RefreshIndex();
+        }
+        if (ConnectFromIndex())
         {
-            if (device->FindAndConnect())
+            return true;
+        }
+
+        // Without arrival notifications the index cannot know about newly attached devices
+        if (!notificationTracking && !refreshed)
+        {
+            RefreshIndex();
+            return ConnectFromIndex();
+        }
+        return false;
+    }
+
+    // Enables the input-report listener on every device that becomes active. The handler runs on
+    // the listener thread.
+    void SetStatusHandler(MouseDevice::StatusHandler handler)
+    {
+        statusHandler = std::move(handler);
+    }
+
+    bool IsStatusListenerRunning() const
+    {
+        return HasActiveDevice() && devices.Visit(active, [](const auto &device)
+                                                  { return device.IsStatusListenerRunning(); });
+    }
+
+    // Keeps every device that can be found connected instead of only the best one; see ConnectAll
+    void EnableMultiDevice()
+    {
+        multiDevice = true;
+    }
+
+    bool IsMultiDevice() const { return multiDevice; }
+
+    // Connects every registered device class that finds a device in the index, best priority
+    // first. Returns the number of connected devices.
+    size_t ConnectAll()
+    {
+        if (index.IsStale() || !notificationTracking)
+        {
+            RefreshIndex();
+        }
+
+        size_t connected = 0;
+        size_t best = Registry::NONE;
+        for (size_t slot : Registry::ORDER)
+        {
+            const bool isConnected = devices.Visit(slot, [this](auto &device)
+                                                   { return device.IsConnected() || device.FindAndConnect(index, pool); });
+            if (isConnected && ++connected == 1)
             {
-                activeDevice = device.get();
-                LOG_INFO(string("Active device: ") + device->GetDeviceType());
-                return true;
+                best = slot;
             }
         }
+
+        if (best != Registry::NONE && best != active)
+        {
+            active = best;
+            LOG_INFO(string("Active device: ") + DeviceType(active));
+            StartStatusListener();
+        }
+        return connected;
+    }
+
+    // Reads every connected device. Where the transport allows it the reads run in parallel, one
+    // thread per extra device, so the call takes as long as the slowest device rather than the
+    // sum of all of them. Handles that timed out are recycled afterwards.
+    vector<DeviceReading> ReadAll()
+    {
+        lastReadTimedOut = false;
+        vector<size_t> slots;
+        for (size_t slot : Registry::ORDER)
+        {
+            if (devices.Visit(slot, [](const auto &device)
+                              { return device.IsConnected(); }))
+            {
+                slots.push_back(slot);
+            }
+        }
+
+        vector<DeviceReading> readings(slots.size());
+        vector<size_t> timeouts(slots.size(), 0);
+        auto readSlot = [this, &slots, &readings, &timeouts](size_t i)
+        {
+            readings[i] = devices.Visit(slots[i], [&](auto &device)
+                                        {
+                                            DeviceReading reading;
+                                            reading.slot = slots[i];
+                                            reading.status = device.ReadBattery();
+                                            reading.name = device.GetDeviceName();
+                                            reading.connectionMode = device.GetConnectionMode();
+                                            timeouts[i] = device.GetTimeoutCount();
+                                            return reading; });
+        };
+
+        vector<std::future<void>> workers;
+        for (size_t i = 1; i < slots.size(); ++i)
+        {
+            if (!HID_PARALLEL_HANDLES)
+            {
+                break;
+            }
+            try
+            {
+                workers.push_back(std::async(std::launch::async, readSlot, i));
+            }
+            catch (const std::system_error &)
+            {
+                // No thread available: this and the remaining devices are read below
+                break;
+            }
+        }
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            if (i == 0 || i > workers.size())
+            {
+                readSlot(i);
+            }
+        }
+        for (auto &worker : workers)
+        {
+            worker.get();
+        }
+
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            if (timeouts[i] > 0)
+            {
+                RecycleDevice(slots[i]);
+            }
+            readings[i].connected = devices.Visit(slots[i], [](const auto &device)
+                                                  { return device.IsConnected(); });
+        }
+        return readings;
+    }
+
+    // Switches the index to notification-driven upkeep: after the initial scan it is only
+    // rescanned when OnDeviceArrival/OnDeviceRemoval cannot keep it current
+    void EnableNotificationTracking()
+    {
+        notificationTracking = true;
+    }
+
+    // Applies a device-interface arrival; returns true if it added a supported interface
+    bool OnDeviceArrival(const wstring &path)
+    {
+        if (!notificationTracking || index.IsStale())
+        {
+            index.MarkStale();
+            InvalidateDevices(MouseDevice::InvalidationTrigger::DeviceArrival);
+            return true;
+        }
+
+        const bool relevant = index.OnArrival(path);
+        if (relevant)
+        {
+            presenceChangedAt = Clock::now();
+            LOG_DEBUG("Device index: supported interface arrived (" + std::to_string(index.Size()) +
+                      " indexed)");
+        }
+        if (relevant || index.IsStale())
+        {
+            InvalidateDevices(MouseDevice::InvalidationTrigger::DeviceArrival);
+            return true;
+        }
         return false;
     }
 
-    void Disconnect()
+    // Applies a device-interface removal; returns true if it was the interface of a connected
+    // device (in single-device mode, the active one), in which case that device has been
+    // disconnected
+    bool OnDeviceRemoval(const wstring &path)
     {
-        if (activeDevice)
+        if (!index.OnRemoval(path))
         {
-            activeDevice->Disconnect();
-            activeDevice = nullptr;
+            return false;
+        }
+        presenceChangedAt = Clock::now();
+        pool.Evict(path);
+        LOG_DEBUG("Device index: supported interface removed (" + std::to_string(index.Size()) +
+                  " indexed)");
+
+        const wstring removed = HIDDeviceIndex::NormalizePath(path);
+        for (size_t slot = 0; slot < Registry::COUNT; ++slot)
+        {
+            const bool matches = devices.Visit(slot, [&removed](const auto &device)
+                                               { return device.IsConnected() &&
+                                                        HIDDeviceIndex::NormalizePath(device.GetDevicePath()) == removed; });
+            if (matches)
+            {
+                if (slot == active)
+                {
+                    // Losing the active device forces a failover; it counts towards flapping
+                    RecordSwitch(presenceChangedAt);
+                }
+                DisconnectSlot(slot);
+                // The devices still connected may share the mouse (a dongle left after the cable)
+                InvalidateDevices(MouseDevice::InvalidationTrigger::DeviceRemoval);
+                return true;
+            }
         }
+        InvalidateDevices(MouseDevice::InvalidationTrigger::DeviceRemoval);
+        return false;
+    }
+
+    // Disconnects every connected device and closes its handle, so the next connection reopens
+    // it. Pooled handles no device was using stay open.
+    void Disconnect()
+    {
+        devices.ForEach([this](auto &device)
+                        {
+                            if (device.IsConnected())
+                            {
+                                pool.Evict(device.GetDevicePath());
+                            }
+                            device.Disconnect(); });
+        active = Registry::NONE;
+    }
+
+    // false closes a handle as soon as its device disconnects, as before the pool existed
+    void SetKeepIdleHandles(bool keep)
+    {
+        pool.SetKeepIdle(keep);
+    }
+
+    const HIDHandlePool::Stats &GetHandlePoolStats() const { return pool.GetStats(); }
+
+    // May be called from any thread; the owning thread sees its pending HID work fail fast
+    void CancelPendingIO()
+    {
+        devices.ForEach([](auto &device)
+                        { device.Cancel(); });
     }
 
     bool IsConnected() const
     {
-        return activeDevice && activeDevice->IsConnected();
+        return HasActiveDevice() && devices.Visit(active, [](const auto &device)
+                                                  { return device.IsConnected(); });
     }
 
     bool HasActiveDevice() const
     {
-        return activeDevice != nullptr;
+        return active != Registry::NONE;
     }
 
     BatteryStatus ReadBattery()
     {
-        if (!activeDevice)
+        lastReadTimedOut = false;
+        if (!HasActiveDevice())
         {
             return {};
         }
-        return activeDevice->ReadBattery();
+
+        size_t timeouts = 0;
+        const BatteryStatus status = devices.Visit(active, [&timeouts](auto &device)
+                                                   {
+                                                       const BatteryStatus read = device.ReadBattery();
+                                                       timeouts = device.GetTimeoutCount();
+                                                       return read; });
+        if (timeouts > 0)
+        {
+            lastReadTimedOut = status.percentage < 0;
+            RecycleDevice(active);
+        }
+        return status;
+    }
+
+    // True if the last ReadBattery failed because a HID call exceeded its deadline
+    bool LastReadTimedOut() const { return lastReadTimedOut; }
+
+    // Handles reopened after a timed-out call
+    size_t GetRecycleCount() const { return recycleCount; }
+
+    const SwitchStats &GetSwitchStats() const { return switchStats; }
+    // Full enumeration passes of the device index, for any reason
+    size_t GetEnumerationCount() const { return index.FullScanCount(); }
+
+    std::wstring_view GetDeviceName() const
+    {
+        return HasActiveDevice() ? devices.Visit(active, [](const auto &device)
+                                                 { return device.GetDeviceName(); })
+                                 : L"Unknown";
+    }
+
+    std::wstring_view GetConnectionMode() const
+    {
+        return HasActiveDevice() ? devices.Visit(active, [](const auto &device)
+                                                 { return device.GetConnectionMode(); })
+                                 : L"Unknown";
     }
 
-    wstring GetDeviceName() const
+    // Interface path of the active device; empty without one
+    wstring GetDevicePath() const
     {
-        return activeDevice ? activeDevice->GetDeviceName() : L"Unknown";
+        return HasActiveDevice() ? *devices.Visit(active, [](const auto &device)
+                                                  { return &device.GetDevicePath(); })
+                                 : wstring();
     }
 
-    wstring GetConnectionMode() const
+    vector<MouseDevice::Attribute> GetTelemetry() const
     {
-        return activeDevice ? activeDevice->GetConnectionMode() : L"Unknown";
+        return HasActiveDevice() ? devices.Visit(active, [](const auto &device)
+                                                 { return device.GetTelemetry(); })
+                                 : vector<MouseDevice::Attribute>{};
     }
 
+    // Switches to a better-priority device if one became present. With notification tracking
+    // this only looks at the index when its generation moved, so a steady-state poll neither
+    // enumerates nor opens anything.
     bool ShouldSwitchDevice()
     {
-        if (!activeDevice)
+        if (!HasActiveDevice())
         {
             return false;
         }
 
-        int currentPriority = activeDevice->GetPriority();
+        const int currentPriority = Registry::Priority(active);
+        if (Registry::BEST_PRIORITY >= currentPriority)
+        {
+            return false;
+        }
+        ++switchStats.checks;
 
-        for (auto &device : devices)
+        // Nothing was attached or removed since the last look; no lower-priority device can have appeared
+        if (notificationTracking && !index.IsStale() && index.Generation() == switchCheckedGeneration)
         {
-            if (device.get() == activeDevice)
-            {
-                continue;
-            }
+            return false;
+        }
+        if (index.IsStale() || !notificationTracking)
+        {
+            RefreshIndex();
+            ++switchStats.rescans;
+        }
+
+        const auto now = Clock::now();
+        if (IsFlapping(now) && now - presenceChangedAt < SWITCH_HOLD)
+        {
+            // The generation stays unchecked so the next poll looks again
+            ++switchStats.deferred;
+            LOG_DEBUG("Devices keep appearing and disappearing - holding off the priority switch");
+            return false;
+        }
+        switchCheckedGeneration = index.Generation();
+
+        const size_t better = devices.FindFirst([this, currentPriority](auto &device, size_t slot)
+                                                {
+                                                    if (slot == active || Registry::Priority(slot) >= currentPriority)
+                                                    {
+                                                        return false;
+                                                    }
+                                                    ++switchStats.probes;
+                                                    return device.FindAndConnect(index, pool); });
+        if (better == Registry::NONE)
+        {
+            return false;
+        }
+
+        LOG_INFO(string("Switching to higher priority device: ") + DeviceType(better));
+        devices.Visit(active, [](auto &device)
+                      { device.Disconnect(); });
+        active = better;
+        ++switchStats.switches;
+        RecordSwitch(now);
+        StartStatusListener();
+        return true;
+    }
 
-            if (device->GetPriority() < currentPriority)
+private:
+    // Declared first so it outlives the devices sharing its handles
+    HIDHandlePool pool;
+    Registry devices;
+    // Registry slot of the active device, Registry::NONE if there is none
+    size_t active = Registry::NONE;
+    // Only vendors with a registered device family are probed by the enumeration pass
+    HIDDeviceIndex index{Registry::VendorIds()};
+    bool notificationTracking = false;
+    bool multiDevice = false;
+    uint64_t switchCheckedGeneration = UINT64_MAX;
+    MouseDevice::StatusHandler statusHandler;
+    bool lastReadTimedOut = false;
+    size_t recycleCount = 0;
+    SwitchStats switchStats;
+    // Times of recent switches and failovers, oldest first, at most FLAP_LIMIT
+    std::deque<Clock::time_point> recentSwitches;
+    Clock::time_point presenceChangedAt{};
+
+    // A timed-out request can leave the handle's report pipe wedged; reopening through the index
+    // gets a fresh handle without a rescan
+    void RecycleDevice(size_t slot)
+    {
+        LOG_ERROR(string(DeviceType(slot)) + ": HID call exceeded its deadline - recycling handle");
+        ++recycleCount;
+        pool.Evict(devices.Visit(slot, [](const auto &device)
+                                 { return device.GetDevicePath(); }));
+        DisconnectSlot(slot);
+        const bool reconnected = multiDevice ? ConnectAll() > 0 : FindAndConnect();
+        if (!reconnected)
+        {
+            LOG_ERROR("No device available after recycling the handle");
+        }
+    }
+
+    // Disconnects one device; if it was the active one, the best remaining connected device
+    // (if any) takes over
+    void DisconnectSlot(size_t slot)
+    {
+        devices.Visit(slot, [](auto &device)
+                      { device.Disconnect(); });
+        if (slot != active)
+        {
+            return;
+        }
+
+        active = Registry::NONE;
+        for (size_t next : Registry::ORDER)
+        {
+            if (devices.Visit(next, [](const auto &device)
+                              { return device.IsConnected(); }))
             {
-                if (device->FindAndConnect())
-                {
-                    LOG_INFO(string("Switching to higher priority device: ") +
-                             device->GetDeviceType());
-                    activeDevice->Disconnect();
-                    activeDevice = device.get();
-                    return true;
-                }
+                active = next;
+                LOG_INFO(string("Active device: ") + DeviceType(active));
+                StartStatusListener();
+                return;
             }
         }
+    }
 
-        return false;
+    void StartStatusListener()
+    {
+        if (statusHandler)
+        {
+            devices.Visit(active, [this](auto &device)
+                          { device.StartStatusListener(statusHandler); });
+        }
     }
 
-private:
-    vector<unique_ptr<MouseDevice>> devices;
-    MouseDevice *activeDevice = nullptr;
+    bool ConnectFromIndex()
+    {
+        active = devices.FindFirst([this](auto &device, size_t)
+                                   { return device.FindAndConnect(index, pool); });
+        if (active == Registry::NONE)
+        {
+            return false;
+        }
+        LOG_INFO(string("Active device: ") + DeviceType(active));
+        StartStatusListener();
+        return true;
+    }
+
+    void RecordSwitch(Clock::time_point now)
+    {
+        recentSwitches.push_back(now);
+        if (recentSwitches.size() > FLAP_LIMIT)
+        {
+            recentSwitches.pop_front();
+        }
+    }
+
+    bool IsFlapping(Clock::time_point now) const
+    {
+        return recentSwitches.size() >= FLAP_LIMIT && now - recentSwitches.front() < FLAP_WINDOW;
+    }
+
+    // A plugged or unplugged supported device (e.g. a charging cable) can change cached state of
+    // the connected ones
+    void InvalidateDevices(MouseDevice::InvalidationTrigger trigger)
+    {
+        devices.ForEach([trigger](auto &device)
+                        { device.Invalidate(trigger); });
+    }
+
+    const char *DeviceType(size_t slot) const
+    {
+        return devices.Visit(slot, [](const auto &device)
+                             { return device.GetDeviceType(); });
+    }
+
+    void RefreshIndex()
+    {
+        index.Refresh();
+        pool.Retain(index);
+        const HIDScanStats &stats = index.Stats();
+        const string opens = stats.opened + stats.skippedByPath == 0
+                                 ? string()
+                                 : ", " + std::to_string(stats.opened) + " opened, " +
+                                       std::to_string(stats.skippedByPath) + " opens avoided by path";
+        LOG_DEBUG("HID device index rebuilt: " + std::to_string(index.Size()) + " candidate interfaces (" +
+                  std::to_string(stats.interfaces) + " scanned" + opens + ")");
+    }
 };
@@ -0,0 +1,708 @@
+#pragma once
+
+#include "core/device_manager.hpp"
+#include "core/connection_state.hpp"
+#include "core/hid_engine.hpp"
+#include "core/seqlock.hpp"
+#include "core/logger.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <type_traits>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+// What the tray shows, as published by DeviceWorker. Names point into static storage (see
+// MouseDevice::GetDeviceName), which keeps the snapshot trivially copyable.
+struct StatusSnapshot
+{
+    static constexpr size_t MAX_DEVICES = RegisteredDeviceSet::COUNT > 0 ? RegisteredDeviceSet::COUNT : 1;
+
+    struct Device
+    {
+        int percentage = -1;
+        bool isCharging = false;
+        std::wstring_view name;
+        std::wstring_view connectionMode;
+        // No answer while the handle is open; the status is the last one read
+        bool asleep = false;
+
+        bool operator==(const Device &other) const
+        {
+            return percentage == other.percentage && isCharging == other.isCharging &&
+                   name == other.name && connectionMode == other.connectionMode && asleep == other.asleep;
+        }
+        bool operator!=(const Device &other) const { return !(*this == other); }
+    };
+
+    // The monitored device; in multi-device mode the one with the lowest battery. A negative
+    // percentage means no device with a known status.
+    Device shown;
+    // Multi-device mode: every device with a known status, in registry order
+    Device devices[MAX_DEVICES];
+    size_t deviceCount = 0;
+
+    bool HasStatus() const { return shown.percentage >= 0; }
+
+    bool operator==(const StatusSnapshot &other) const
+    {
+        return shown == other.shown && deviceCount == other.deviceCount &&
+               std::equal(devices, devices + deviceCount, other.devices);
+    }
+    bool operator!=(const StatusSnapshot &other) const { return !(*this == other); }
+};
+
+static_assert(std::is_trivially_copyable_v<StatusSnapshot>, "StatusSnapshot is published through a seqlock");
+
+// Owns DeviceManager and runs every HID call on the engine thread. Read results, input reports
+// and device changes update the cached status there (sleep tolerance, per-device entries); the
+// result is published as a StatusSnapshot that any thread loads without a lock and without ever
+// waiting on HID. The change handler runs only when a publish differs from the previous one.
+//
+// Reads are single-flight: a query is answered from the snapshot if the last read is recent
+// enough for it, joins the read that is queued or running otherwise, and only starts a read when
+// there is none. Explicit queries only join reads that cannot skip: scheduled, wake and
+// device-change tasks may return without reading, so an explicit query queues its own read
+// behind them.
+class DeviceWorker
+{
+public:
+    using ReadOutcome = ConnectionSupervisor::Outcome;
+    using ChangeHandler = std::function<void(const StatusSnapshot &)>;
+
+    // How queries were answered since the worker was created
+    struct QueryStats
+    {
+        size_t cacheHits = 0; // answered from the snapshot without HID traffic
+        size_t joined = 0;    // answered by a read another caller had started
+        size_t reads = 0;     // read tasks that talked to the device
+    };
+
+    // Time the mouse slept (no answer while its receiver stayed present) and what it cost
+    struct SleepStats
+    {
+        std::chrono::milliseconds slept{0};
+        size_t skippedReads = 0; // polls the sleep backoff answered without HID traffic
+        size_t wakeReads = 0;    // reads started by input from the sleeping mouse
+    };
+
+    // Longest a single engine task is expected to run: a full read on a fresh handle including
+    // settle time and every feature call at its deadline
+    static constexpr std::chrono::milliseconds HUNG_TASK_THRESHOLD{15000};
+    // Shortest gap between two reads started by input activity; one wake needs one read
+    static constexpr std::chrono::milliseconds WAKE_READ_GAP{5000};
+
+    DeviceWorker()
+    {
+        connection.Machine().SetTransitionHandler([](const ConnectionStateMachine::Transition &transition)
+                                                  { LOG_DEBUG(string("Connection: ") +
+                                                              ConnectionStateMachine::ToString(transition.from) + " -> " +
+                                                              ConnectionStateMachine::ToString(transition.to) + " (" +
+                                                              transition.reason + ")"); });
+    }
+
+    ~DeviceWorker()
+    {
+        Stop();
+    }
+
+    DeviceWorker(const DeviceWorker &) = delete;
+    DeviceWorker &operator=(const DeviceWorker &) = delete;
+
+    // Configuration; call before Start()
+    void EnableNotificationTracking() { deviceManager.EnableNotificationTracking(); }
+
+    void EnableMultiDevice()
+    {
+        multiDevice = true;
+        deviceManager.EnableMultiDevice();
+    }
+
+    // Listens for unsolicited status reports from the active device. Once a device has delivered
+    // one, scheduled reads drop to the fallback interval.
+    void EnableInputReports(std::chrono::seconds fallback)
+    {
+        inputFallbackInterval = fallback;
+        deviceManager.SetStatusHandler([this](const MouseDevice::StatusUpdate &update)
+                                       { engine.Submit([this, update]
+                                                       { applyStatusUpdate(update); }); });
+    }
+
+    // notifyCompletion wakes the owner thread for DrainCompletions; onChange gets every snapshot
+    // that differs from the one before. Both are called on the engine thread.
+    void Start(std::function<void()> notifyCompletion, ChangeHandler onChange)
+    {
+        changeHandler = std::move(onChange);
+        engine.Start(std::move(notifyCompletion), [this]
+                     { deviceManager.CancelPendingIO(); });
+    }
+
+    // Stops the engine thread and releases the device
+    void Stop()
+    {
+        engine.Stop();
+        deviceManager.Disconnect();
+    }
+
+    // Any thread; never blocks on HID
+    StatusSnapshot Snapshot() const { return published.Load(); }
+    bool HasStatus() const { return Snapshot().HasStatus(); }
+    size_t Publishes() const { return published.Stores(); }
+
+    // Owner thread. Asks for a status at most maxAge old; onComplete (if any) runs on the owner
+    // thread once there is one: right away on a cache hit, otherwise after the read it joined or
+    // started has been published. Zero maxAge never uses the cache but still joins a read that
+    // cannot skip.
+    void Query(std::chrono::milliseconds maxAge, std::function<void()> onComplete = nullptr)
+    {
+        query(maxAge, std::move(onComplete), false);
+    }
+
+    // Periodic query; a read it starts is skipped on the engine thread while input reports keep
+    // the status current
+    void ScheduledQuery(std::chrono::milliseconds maxAge)
+    {
+        query(maxAge, nullptr, true);
+    }
+
+    QueryStats GetQueryStats() const
+    {
+        std::lock_guard<std::mutex> lock(queryMutex);
+        QueryStats stats = queryStats;
+        stats.reads = reads.load();
+        return stats;
+    }
+
+    // Any thread: input arrived from a supported mouse (in the tray app, once it stopped moving).
+    // If it was sleeping, it is read now instead of at the end of its sleep backoff.
+    void OnInputActivity()
+    {
+        if (!IsAsleep(Snapshot()))
+        {
+            return;
+        }
+        const int64_t now = NowMs();
+        int64_t last = lastWakeMs.load();
+        if ((last != 0 && now - last < WAKE_READ_GAP.count()) || !lastWakeMs.compare_exchange_strong(last, now))
+        {
+            return;
+        }
+
+        auto work = [this]
+        {
+            // The machine only spaces single-device reads; multi-device polls read every device
+            const bool asleep = multiDevice ? IsAsleep(current) : connection.OnActivity();
+            if (!asleep)
+            {
+                return;
+            }
+            LOG_DEBUG("Input from the sleeping mouse - reading it now");
+            ++wakeReads;
+            readAndPublish();
+        };
+
+        std::lock_guard<std::mutex> lock(queryMutex);
+        startFlight(nullptr, true, std::move(work));
+    }
+
+    // Any thread
+    SleepStats GetSleepStats() const
+    {
+        SleepStats stats;
+        int64_t slept = sleptMs.load();
+        const int64_t since = sleepingSinceMs.load();
+        if (since != 0)
+        {
+            slept += NowMs() - since;
+        }
+        stats.slept = std::chrono::milliseconds(slept);
+        stats.skippedReads = connection.GetSkippedSleepReads();
+        stats.wakeReads = wakeReads;
+        return stats;
+    }
+
+    // Whether the shown device, or in multi-device mode any device, kept its status without
+    // answering
+    static bool IsAsleep(const StatusSnapshot &snapshot)
+    {
+        return snapshot.shown.asleep ||
+               std::any_of(snapshot.devices, snapshot.devices + snapshot.deviceCount,
+                           [](const StatusSnapshot::Device &device)
+                           { return device.asleep; });
+    }
+
+    // Interface paths of removed devices. Removals of unrelated HID interfaces only update the
+    // device index; losing the active device clears its status and fails over to any other
+    // supported device still present.
+    void OnDevicesRemoved(vector<wstring> paths)
+    {
+        auto work = [this, paths = std::move(paths)]
+        {
+            bool activeRemoved = false;
+            for (const auto &path : paths)
+            {
+                activeRemoved = deviceManager.OnDeviceRemoval(path) || activeRemoved;
+            }
+            if (!activeRemoved)
+            {
+                return;
+            }
+            connection.OnPresenceChanged();
+            // In multi-device mode the read drops the removed device and keeps the others
+            if (!multiDevice)
+            {
+                LOG_INFO("Active device removed - clearing cached status");
+                inputReportsActive = false;
+                consecutiveFailures = 0;
+                current = {};
+                publish();
+            }
+            readAndPublish();
+        };
+
+        std::lock_guard<std::mutex> lock(queryMutex);
+        startFlight(nullptr, true, std::move(work));
+    }
+
+    // Interface paths of arrived devices. Arrivals that add no supported interface skip the read
+    // while a status is cached.
+    void OnDevicesArrived(vector<wstring> paths, std::function<void()> onComplete = nullptr)
+    {
+        auto work = [this, paths = std::move(paths)]
+        {
+            consecutiveFailures = 0;
+            bool relevant = false;
+            for (const auto &path : paths)
+            {
+                relevant = deviceManager.OnDeviceArrival(path) || relevant;
+            }
+            if (relevant)
+            {
+                connection.OnPresenceChanged();
+            }
+
+            if (!relevant && current.HasStatus())
+            {
+                LOG_DEBUG("Arrival involved no supported device - skipping read");
+                return;
+            }
+            readAndPublish();
+        };
+
+        std::lock_guard<std::mutex> lock(queryMutex);
+        startFlight(std::move(onComplete), true, std::move(work));
+    }
+
+    // Runs work with the device manager on the engine thread, outside the status cache (test
+    // notifications, tools); use Complete to hand results back
+    void Run(std::function<void(DeviceManager &)> work)
+    {
+        engine.Submit([this, work = std::move(work)]
+                      { work(deviceManager); });
+    }
+
+    // Engine thread: queues a completion for the owner thread
+    void Complete(HIDEngine::Task completion)
+    {
+        engine.Complete(std::move(completion));
+    }
+
+    // Owner thread
+    void DrainCompletions()
+    {
+        engine.DrainCompletions();
+    }
+
+private:
+    // Owned by the engine thread: only touched from tasks submitted to `engine`
+    DeviceManager deviceManager;
+    ConnectionSupervisor connection{deviceManager};
+    HIDEngine engine;
+    ChangeHandler changeHandler;
+
+    bool multiDevice = false;
+    // Multi-device mode: the last known status of each device, keyed by registry slot
+    std::map<size_t, StatusSnapshot::Device> deviceEntries;
+
+    // Status as of the last task, kept through sleeping and failed reads; the published
+    // snapshot is a copy of it
+    StatusSnapshot current;
+    StatusSnapshot lastPublished;
+    SeqlockSlot<StatusSnapshot> published;
+    int consecutiveFailures = 0;
+
+    // Callers waiting for one read task. A flight that may skip (scheduled, wake and device-change
+    // tasks) is only joined by scheduled queries.
+    struct Flight
+    {
+        vector<std::function<void()>> waiters;
+        bool maySkip = false;
+    };
+
+    // The most recently submitted read task until it finished; queries join it. Guarded by
+    // queryMutex together with queryStats.
+    mutable std::mutex queryMutex;
+    std::shared_ptr<Flight> latestFlight;
+    QueryStats queryStats;
+    std::atomic<size_t> reads{0};
+    // Steady-clock milliseconds at which the last read that produced a status published; 0 before
+    // the first
+    std::atomic<int64_t> lastReadAtMs{0};
+
+    // Sleep accounting: steady-clock milliseconds since the published status went asleep (0 while
+    // awake), earlier sleeping time, wake reads and when the last one was started
+    std::atomic<int64_t> sleepingSinceMs{0};
+    std::atomic<int64_t> sleptMs{0};
+    std::atomic<size_t> wakeReads{0};
+    std::atomic<int64_t> lastWakeMs{0};
+
+    // Input-report mode; see EnableInputReports
+    bool inputReportsActive = false;
+    std::chrono::steady_clock::time_point lastFeatureReadAt{};
+    std::chrono::seconds inputFallbackInterval{0};
+
+    // Telemetry attributes as last written to the log; the snapshot only carries the battery
+    string loggedTelemetry;
+
+    void query(std::chrono::milliseconds maxAge, std::function<void()> onComplete, bool scheduled)
+    {
+        {
+            std::lock_guard<std::mutex> lock(queryMutex);
+            if (latestFlight && (scheduled || !latestFlight->maySkip))
+            {
+                ++queryStats.joined;
+                if (onComplete)
+                {
+                    latestFlight->waiters.push_back(std::move(onComplete));
+                }
+                onComplete = nullptr;
+            }
+            else
+            {
+                const int64_t readAt = lastReadAtMs.load();
+                if (maxAge.count() <= 0 || readAt == 0 || NowMs() - readAt > maxAge.count())
+                {
+                    startFlight(std::move(onComplete), scheduled, [this, scheduled]
+                                {
+                                    // An explicit query reads a sleeping mouse before its backoff ends
+                                    if (!scheduled && !multiDevice)
+                                    {
+                                        connection.OnActivity();
+                                    }
+                                    if (scheduled && inputReportsActive && current.HasStatus() &&
+                                        std::chrono::steady_clock::now() - lastFeatureReadAt < inputFallbackInterval)
+                                    {
+                                        LOG_DEBUG("Input reports active - skipping scheduled read");
+                                        return;
+                                    }
+                                    readAndPublish(); });
+                    return;
+                }
+                ++queryStats.cacheHits;
+            }
+        }
+
+        if (onComplete)
+        {
+            // Cache hit
+            onComplete();
+            return;
+        }
+
+        // Reads never queue behind a slow one; a stuck task is worth a log line
+        const auto busy = engine.BusyFor();
+        if (busy >= HUNG_TASK_THRESHOLD)
+        {
+            LOG_ERROR("HID engine task running for " + std::to_string(busy.count()) +
+                      " ms - joined the read in flight");
+        }
+    }
+
+    static int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Caller holds queryMutex. Submits a read task as the flight later queries join; its waiters
+    // are completed once the task has run. maySkip marks work that can return without reading.
+    template <typename Work>
+    void startFlight(std::function<void()> onComplete, bool maySkip, Work work)
+    {
+        auto flight = std::make_shared<Flight>();
+        flight->maySkip = maySkip;
+        if (onComplete)
+        {
+            flight->waiters.push_back(std::move(onComplete));
+        }
+        latestFlight = flight;
+        engine.Submit([this, flight, work = std::move(work)]() mutable
+                      {
+                          work();
+                          vector<std::function<void()>> waiters;
+                          {
+                              std::lock_guard<std::mutex> lock(queryMutex);
+                              if (latestFlight == flight)
+                              {
+                                  latestFlight.reset();
+                              }
+                              waiters.swap(flight->waiters);
+                          }
+                          for (auto &waiter : waiters)
+                          {
+                              engine.Complete(std::move(waiter));
+                          } });
+    }
+
+    void publish()
+    {
+        if (current == lastPublished)
+        {
+            return;
+        }
+        lastPublished = current;
+        trackSleep();
+        published.Store(current);
+        if (changeHandler)
+        {
+            changeHandler(current);
+        }
+    }
+
+    void trackSleep()
+    {
+        const bool asleep = IsAsleep(current);
+        const int64_t since = sleepingSinceMs.load();
+        if (asleep && since == 0)
+        {
+            sleepingSinceMs = NowMs();
+        }
+        else if (!asleep && since != 0)
+        {
+            sleptMs += NowMs() - since;
+            sleepingSinceMs = 0;
+        }
+    }
+
+    void readAndPublish()
+    {
+        ++reads;
+        // Only a fresh status serves the cache; failed reads leave the next query to read again
+        bool read = false;
+        if (multiDevice)
+        {
+            const auto readings = readAllDevices();
+            read = std::any_of(readings.begin(), readings.end(),
+                               [](const DeviceManager::DeviceReading &reading)
+                               { return reading.status.percentage >= 0; });
+            applyReadings(readings);
+        }
+        else
+        {
+            const auto result = readBattery();
+            read = result.outcome == ReadOutcome::Success;
+            applyRead(result);
+        }
+        publish();
+        if (read)
+        {
+            lastReadAtMs = NowMs();
+        }
+    }
+
+    // Connects whatever appeared since the last poll and reads every device
+    vector<DeviceManager::DeviceReading> readAllDevices()
+    {
+        try
+        {
+            deviceManager.ConnectAll();
+            return deviceManager.ReadAll();
+        }
+        catch (const std::exception &ex)
+        {
+            LOG_ERROR("Exception in DeviceWorker::readAllDevices: " + string(ex.what()));
+        }
+        catch (...)
+        {
+            LOG_ERROR("Unknown exception in DeviceWorker::readAllDevices");
+        }
+        return {};
+    }
+
+    ConnectionSupervisor::Result readBattery()
+    {
+        try
+        {
+            return connection.Poll(current.HasStatus());
+        }
+        catch (const std::exception &ex)
+        {
+            LOG_ERROR("Exception in DeviceWorker::readBattery: " + string(ex.what()));
+        }
+        catch (...)
+        {
+            LOG_ERROR("Unknown exception in DeviceWorker::readBattery");
+        }
+        return {};
+    }
+
+    void applyReadings(const vector<DeviceManager::DeviceReading> &readings)
+    {
+        std::map<size_t, StatusSnapshot::Device> entries;
+        for (const auto &reading : readings)
+        {
+            if (reading.status.percentage >= 0)
+            {
+                entries[reading.slot] = {reading.status.percentage, reading.status.isCharging,
+                                         reading.name, reading.connectionMode};
+                continue;
+            }
+
+            // The handle is still open but the mouse did not answer - likely sleeping
+            auto cached = deviceEntries.find(reading.slot);
+            if (reading.connected && cached != deviceEntries.end())
+            {
+                LOG_DEBUG("No answer from a device - keeping its last known battery: " +
+                          std::to_string(cached->second.percentage) + "%");
+                entries.insert(*cached).first->second.asleep = true;
+            }
+        }
+        deviceEntries = std::move(entries);
+
+        if (deviceEntries.empty())
+        {
+            consecutiveFailures++;
+            handleDisconnected();
+            return;
+        }
+
+        consecutiveFailures = 0;
+        current = {};
+        for (const auto &[slot, entry] : deviceEntries)
+        {
+            if (current.deviceCount < StatusSnapshot::MAX_DEVICES)
+            {
+                current.devices[current.deviceCount++] = entry;
+            }
+        }
+        current.shown = *std::min_element(current.devices, current.devices + current.deviceCount,
+                                          [](const auto &a, const auto &b)
+                                          { return a.percentage < b.percentage; });
+        LOG_DEBUG(std::to_string(current.deviceCount) + " devices, lowest battery: " +
+                  std::to_string(current.shown.percentage) + "%");
+    }
+
+    void applyRead(const ConnectionSupervisor::Result &result)
+    {
+        if (result.skipped && result.outcome == ReadOutcome::Sleeping)
+        {
+            LOG_DEBUG("Mouse sleeping - read skipped, keeping last known battery: " +
+                      std::to_string(current.shown.percentage) + "%");
+            return;
+        }
+
+        if (result.outcome == ReadOutcome::Success)
+        {
+            consecutiveFailures = 0;
+            lastFeatureReadAt = std::chrono::steady_clock::now();
+            LOG_DEBUG("Battery: " + std::to_string(result.status.percentage) + "%, Charging: " +
+                      (result.status.isCharging ? "Yes" : "No"));
+            current.shown = {result.status.percentage, result.status.isCharging,
+                             deviceManager.GetDeviceName(), deviceManager.GetConnectionMode()};
+            logTelemetry();
+            return;
+        }
+
+        consecutiveFailures++;
+        LOG_DEBUG("Battery read failed (consecutive failures: " +
+                  std::to_string(consecutiveFailures) + ")");
+
+        if (result.outcome == ReadOutcome::TimedOut)
+        {
+            LOG_DEBUG("Battery read timed out - keeping last known status");
+        }
+        else if (result.outcome == ReadOutcome::Sleeping)
+        {
+            LOG_DEBUG("Mouse appears to be sleeping - keeping last known battery: " +
+                      std::to_string(current.shown.percentage) + "%");
+            current.shown.asleep = true;
+        }
+        else if (result.outcome == ReadOutcome::BackingOff)
+        {
+            LOG_DEBUG("Connection backing off - no read this time");
+        }
+        else if (result.outcome == ReadOutcome::Disconnected)
+        {
+            handleDisconnected();
+        }
+
+        // A new or missing handle has yet to prove it delivers input reports
+        if (result.outcome != ReadOutcome::Sleeping && result.outcome != ReadOutcome::BackingOff)
+        {
+            inputReportsActive = false;
+        }
+    }
+
+    // Merges an input-report update into the cached status
+    void applyStatusUpdate(const MouseDevice::StatusUpdate &update)
+    {
+        if (!current.HasStatus())
+        {
+            // Name and connection mode come from a full read; let the next one establish them
+            LOG_DEBUG("Input report before first full read - ignored");
+            return;
+        }
+
+        if (!inputReportsActive)
+        {
+            LOG_INFO("Device delivers status input reports - polling every " +
+                     std::to_string(inputFallbackInterval.count()) + "s");
+            inputReportsActive = true;
+        }
+
+        consecutiveFailures = 0;
+        current.shown.percentage = update.percentage.value_or(current.shown.percentage);
+        current.shown.isCharging = update.isCharging.value_or(current.shown.isCharging);
+        current.shown.asleep = false;
+        LOG_DEBUG("Battery: " + std::to_string(current.shown.percentage) + "%, Charging: " +
+                  (current.shown.isCharging ? "Yes" : "No"));
+        publish();
+    }
+
+    void handleDisconnected()
+    {
+        LOG_DEBUG("Device fully disconnected - showing disconnected icon");
+        deviceEntries.clear();
+        current = {};
+        loggedTelemetry.clear();
+    }
+
+    // Writes the active device's telemetry attributes (vaxee_telemetry) to the log when they change
+    void logTelemetry()
+    {
+        string line;
+        for (const auto &attribute : deviceManager.GetTelemetry())
+        {
+            line += (line.empty() ? "" : ", ") + attribute.name + ": " + attribute.value;
+        }
+        if (line == loggedTelemetry)
+        {
+            return;
+        }
+        loggedTelemetry = line;
+        if (!line.empty())
+        {
+            LOG_INFO("Telemetry: " + line);
+        }
+    }
+};
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include "devices/device_table.hpp"
+#include <vector>
+#include <map>
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+using std::string;
+using std::vector;
+
+// Linux counterpart of Raw Input mouse activity: watches the evdev nodes (/dev/input/event*) of
+// supported pointing devices, matched by (VID, PID) against the device table, and reports when any
+// of them sends an event. Only the event queue is read, so it does not touch the HID protocol or
+// wake the receiver. ReadFrames also yields the kernel timestamp of each input report, for timing
+// the mouse's report stream.
+class EvdevActivityMonitor
+{
+public:
+    // Event timestamps are switched to CLOCK_MONOTONIC, which steady_clock uses on Linux
+    using Clock = std::chrono::steady_clock;
+
+    EvdevActivityMonitor() = default;
+
+    ~EvdevActivityMonitor()
+    {
+        Close();
+    }
+
+    EvdevActivityMonitor(const EvdevActivityMonitor &) = delete;
+    EvdevActivityMonitor &operator=(const EvdevActivityMonitor &) = delete;
+
+    // Opens the event nodes of relative-motion devices in the device table from these vendors;
+    // returns how many. Nodes that cannot be opened (usually permissions) are skipped.
+    size_t Open(const vector<USHORT> &vendorIds)
+    {
+        Close();
+        DIR *dir = opendir(INPUT_DIR);
+        if (!dir)
+        {
+            return 0;
+        }
+
+        while (dirent *entry = readdir(dir))
+        {
+            const string node = entry->d_name;
+            if (node.compare(0, 5, "event") != 0)
+            {
+                continue;
+            }
+            const int fd = open((string(INPUT_DIR) + "/" + node).c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0)
+            {
+                continue;
+            }
+
+            input_id id = {};
+            unsigned long types = 0;
+            if (ioctl(fd, EVIOCGID, &id) == 0 &&
+                DeviceTable::Find(id.vendor, id.product) &&
+                std::find(vendorIds.begin(), vendorIds.end(), id.vendor) != vendorIds.end() &&
+                ioctl(fd, EVIOCGBIT(0, sizeof(types)), &types) >= 0 && (types & (1UL << EV_REL)))
+            {
+                int clock = CLOCK_MONOTONIC;
+                ioctl(fd, EVIOCSCLOCKID, &clock);
+                fds.push_back(fd);
+                continue;
+            }
+            close(fd);
+        }
+        closedir(dir);
+        return fds.size();
+    }
+
+    void Close()
+    {
+        for (int fd : fds)
+        {
+            close(fd);
+        }
+        fds.clear();
+    }
+
+    bool IsOpen() const { return !fds.empty(); }
+    // Times a node hung up (the device went away) and every node was closed
+    size_t HangUps() const { return hangUps; }
+
+    // Blocks until one of the devices sends an event (true) or the timeout passes (false). Pending
+    // events are drained, so the next wait starts from new activity.
+    bool WaitForActivity(std::chrono::milliseconds timeout)
+    {
+        if (fds.empty())
+        {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+        return Poll(timeout, [](int, const input_event &) {});
+    }
+
+    // Like WaitForActivity, but appends the kernel timestamp of every complete input report
+    // (SYN_REPORT) to the frames of the node it came from, keyed by its fd, on the steady clock.
+    // Each node is one report stream; only gaps within a stream are meaningful.
+    bool ReadFrames(std::map<int, vector<Clock::time_point>> &frames, std::chrono::milliseconds timeout)
+    {
+        return Poll(timeout, [&frames](int fd, const input_event &event)
+                    {
+                        if (event.type == EV_SYN && event.code == SYN_REPORT)
+                        {
+                            frames[fd].push_back(Clock::time_point(std::chrono::seconds(event.input_event_sec) +
+                                                                   std::chrono::microseconds(event.input_event_usec)));
+                        } });
+    }
+
+private:
+    static constexpr const char *INPUT_DIR = "/dev/input";
+
+    vector<int> fds;
+    size_t hangUps = 0;
+
+    template <typename Handler>
+    bool Poll(std::chrono::milliseconds timeout, Handler handler)
+    {
+        vector<pollfd> polled;
+        for (int fd : fds)
+        {
+            polled.push_back({fd, POLLIN, 0});
+        }
+        int ready;
+        do
+        {
+            ready = poll(polled.data(), polled.size(), static_cast<int>(timeout.count()));
+        } while (ready < 0 && errno == EINTR);
+        if (ready <= 0)
+        {
+            return false;
+        }
+
+        input_event events[64];
+        for (const auto &entry : polled)
+        {
+            if (entry.revents & (POLLHUP | POLLERR | POLLNVAL))
+            {
+                // The device went away; callers reopen once they wait again
+                ++hangUps;
+                Close();
+                return true;
+            }
+            if (entry.revents & POLLIN)
+            {
+                ssize_t length;
+                while ((length = read(entry.fd, events, sizeof(events))) > 0)
+                {
+                    for (size_t i = 0; i < static_cast<size_t>(length) / sizeof(input_event); ++i)
+                    {
+                        handler(entry.fd, events[i]);
+                    }
+                }
+            }
+        }
+        return true;
+    }
+};
@@ -2,11 +2,14 @@
 
 #include <windows.h>
 #include <vector>
+#include <chrono>
 #include <string>
 #include <memory>
 #include <optional>
-#include <thread>
-#include <chrono>
+#include <algorithm>
+#include "core/hid_types.hpp"
+#include "core/hid_path.hpp"
+#include "core/settle_tracker.hpp"
 
 extern "C"
 {
@@ -15,34 +18,52 @@ extern "C"
 #include <hidpi.h>
 }
 
+#ifndef IOCTL_HID_GET_FEATURE
+#define IOCTL_HID_GET_FEATURE CTL_CODE(FILE_DEVICE_KEYBOARD, 100, METHOD_OUT_DIRECT, FILE_ANY_ACCESS)
+#endif
+
+#ifndef IOCTL_HID_SET_FEATURE
+#define IOCTL_HID_SET_FEATURE CTL_CODE(FILE_DEVICE_KEYBOARD, 100, METHOD_IN_DIRECT, FILE_ANY_ACCESS)
+#endif
+
 using std::vector;
 using std::wstring;
 
-struct DeviceInfo
-{
-    wstring path;
-    USHORT vid;
-    USHORT pid;
-    USHORT usagePage;
-    USHORT usage;
-};
-
 class HIDDevice
 {
 public:
-    HIDDevice() : deviceHandle(INVALID_HANDLE_VALUE), vid(0), pid(0) {}
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr DWORD READY_PROBE_DEADLINE_MS = 100;
+    static constexpr DWORD READY_PROBE_INTERVAL_MS = 5;
+    // One readiness probe is a feature read; a device that has not answered it by then is not
+    // ready, and the request is cancelled
+    static constexpr DWORD READY_PROBE_IO_MS = 20;
+    // Feature reports complete in a few milliseconds; a call still pending after this is a stalled
+    // firmware and is cancelled rather than waited out
+    static constexpr DWORD IO_TIMEOUT_MS = 1000;
+
+    HIDDevice() : deviceHandle(INVALID_HANDLE_VALUE), vid(0), pid(0),
+                  ioEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr)),
+                  inputEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr)),
+                  cancelEvent(CreateEventW(nullptr, TRUE, FALSE, nullptr)) {}
 
     ~HIDDevice()
     {
         Close();
+        CloseHandle(ioEvent);
+        CloseHandle(inputEvent);
+        CloseHandle(cancelEvent);
     }
 
     HIDDevice(const HIDDevice &) = delete;
     HIDDevice &operator=(const HIDDevice &) = delete;
 
-    static vector<DeviceInfo> EnumerateDevices(USHORT vid, USHORT pid)
+    // Walks the HID tree once and returns every interface owned by one of the given vendors
+    static vector<DeviceInfo> EnumerateDevices(const vector<USHORT> &vendorIds, HIDScanStats &stats)
     {
         vector<DeviceInfo> devices;
+        stats = {};
 
         GUID hidGuid;
         HidD_GetHidGuid(&hidGuid);
@@ -66,7 +87,8 @@ public:
                                          memberIndex, &deviceInterfaceData);
              ++memberIndex)
         {
-            if (auto deviceInfo = GetDeviceInfo(deviceInfoSet, deviceInterfaceData, vid, pid))
+            ++stats.interfaces;
+            if (auto deviceInfo = GetDeviceInfo(deviceInfoSet, deviceInterfaceData, vendorIds, stats))
             {
                 devices.push_back(*deviceInfo);
             }
@@ -76,6 +98,21 @@ public:
         return devices;
     }
 
+    // Targeted lookup of one interface path, such as the one carried by a WM_DEVICECHANGE
+    // arrival, without walking the rest of the HID tree
+    static vector<DeviceInfo> QueryDevice(const wstring &path, const vector<USHORT> &vendorIds)
+    {
+        HANDLE h = CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+        if (h == INVALID_HANDLE_VALUE)
+        {
+            return {};
+        }
+
+        std::optional<DeviceInfo> info = ExtractDeviceInfo(h, path.c_str(), vendorIds);
+        CloseHandle(h);
+        return info ? vector<DeviceInfo>{*info} : vector<DeviceInfo>{};
+    }
+
     bool Open(const wstring &devicePath)
     {
         Close();
@@ -86,7 +123,7 @@ public:
             FILE_SHARE_READ | FILE_SHARE_WRITE,
             nullptr,
             OPEN_EXISTING,
-            0,
+            FILE_FLAG_OVERLAPPED,
             nullptr);
 
         if (deviceHandle == INVALID_HANDLE_VALUE)
@@ -94,6 +131,11 @@ public:
             return false;
         }
 
+        ResetEvent(cancelEvent);
+        inputReportLength = 0;
+        lastIoResult = HIDIoResult::Ok;
+        timeoutCount = 0;
+
         HIDD_ATTRIBUTES attrib;
         attrib.Size = sizeof(HIDD_ATTRIBUTES);
         if (HidD_GetAttributes(deviceHandle, &attrib))
@@ -102,11 +144,20 @@ public:
             pid = attrib.ProductID;
         }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        // Returns as soon as the device answers a feature read. If it has not by the probe
+        // deadline, the settle time this PID has been observed to need is paid lazily before the
+        // first transfer instead.
+        openedAt = GetTickCount64();
+        settlePending = !WaitUntilReady();
 
         return true;
     }
 
+    bool Open(const DeviceInfo &info)
+    {
+        return Open(info.path);
+    }
+
     void Close()
     {
         if (deviceHandle != INVALID_HANDLE_VALUE)
@@ -120,18 +171,81 @@ public:
 
     bool SendFeatureReport(const BYTE *buffer, DWORD size) const
     {
-        return IsOpen() && HidD_SetFeature(deviceHandle, const_cast<BYTE *>(buffer), size) == TRUE;
+        return Transfer(IOCTL_HID_SET_FEATURE, const_cast<BYTE *>(buffer), size);
     }
 
     bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const
     {
-        if (!IsOpen())
+        buffer[0] = reportId;
+        return Transfer(IOCTL_HID_GET_FEATURE, buffer, size);
+    }
+
+    HIDIoResult GetLastIoResult() const { return lastIoResult; }
+
+    // A timed-out request may leave the device's report pipe wedged; callers recycle the handle
+    size_t GetTimeoutCount() const { return timeoutCount; }
+
+    // Waits up to timeoutMs for the next input report. Uses its own OVERLAPPED and event, so one
+    // thread may listen while another exchanges feature reports on the same handle. Returns true
+    // with bytesRead == 0 on timeout and false on error, cancellation or a collection that has no
+    // input reports. The report ID is in buffer[0].
+    bool ReadInputReport(BYTE *buffer, DWORD size, DWORD timeoutMs, DWORD &bytesRead) const
+    {
+        bytesRead = 0;
+        if (!IsOpen() || inputReportLength == 0 || size < inputReportLength)
         {
             return false;
         }
 
-        buffer[0] = reportId;
-        return HidD_GetFeature(deviceHandle, buffer, size) == TRUE;
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = inputEvent;
+        ResetEvent(inputEvent);
+
+        if (ReadFile(deviceHandle, buffer, inputReportLength, &bytesRead, &overlapped))
+        {
+            return true;
+        }
+
+        if (GetLastError() != ERROR_IO_PENDING)
+        {
+            return false;
+        }
+
+        const HANDLE waitHandles[] = {inputEvent, cancelEvent};
+        const DWORD wait = WaitForMultipleObjects(2, waitHandles, FALSE, timeoutMs);
+        if (wait != WAIT_OBJECT_0)
+        {
+            CancelIoEx(deviceHandle, &overlapped);
+        }
+
+        // The HID class driver buffers input reports, so cancelling a timed-out read loses nothing
+        const BOOL completed = GetOverlappedResult(deviceHandle, &overlapped, &bytesRead, TRUE);
+        if (wait == WAIT_TIMEOUT)
+        {
+            bytesRead = completed ? bytesRead : 0;
+            return true;
+        }
+        return completed == TRUE && wait == WAIT_OBJECT_0;
+    }
+
+    // Waits between protocol steps. Returns false as soon as Cancel() is called so a
+    // shutdown never has to sit out a pending protocol delay.
+    bool Delay(DWORD milliseconds) const
+    {
+        return WaitForSingleObject(cancelEvent, milliseconds) == WAIT_TIMEOUT;
+    }
+
+    // Safe to call from any thread: aborts pending delays and in-flight reports.
+    // The flag is cleared on the next Open().
+    void Cancel() const
+    {
+        SetEvent(cancelEvent);
+    }
+
+    // Clears the flag without reopening, for a handle kept open across connections
+    void ResetCancel() const
+    {
+        ResetEvent(cancelEvent);
     }
 
     USHORT GetVID() const { return vid; }
@@ -141,11 +255,152 @@ private:
     HANDLE deviceHandle;
     USHORT vid;
     USHORT pid;
+    HANDLE ioEvent;
+    HANDLE inputEvent;
+    HANDLE cancelEvent;
+    USHORT inputReportLength = 0;
+    ULONGLONG openedAt = 0;
+    mutable bool settlePending = false;
+    mutable HIDIoResult lastIoResult = HIDIoResult::Ok;
+    mutable size_t timeoutCount = 0;
+
+    // Probes the device with a feature read of its first feature report until one is answered.
+    // The preparsed data and caps cannot tell: the class driver serves them from the descriptor
+    // cached at enumeration, so they succeed as soon as CreateFileW does. Each probe is cancelled
+    // after READY_PROBE_IO_MS and does not count as a timed-out transfer.
+    bool WaitUntilReady()
+    {
+        PHIDP_PREPARSED_DATA preparsedData;
+        if (!HidD_GetPreparsedData(deviceHandle, &preparsedData))
+        {
+            return false;
+        }
+        HIDP_CAPS caps{};
+        const bool hasCaps = HidP_GetCaps(preparsedData, &caps) == HIDP_STATUS_SUCCESS;
+        const BYTE reportId = hasCaps ? FirstFeatureReportId(preparsedData, caps) : 0;
+        HidD_FreePreparsedData(preparsedData);
+        if (!hasCaps || caps.FeatureReportByteLength == 0)
+        {
+            return false;
+        }
+        inputReportLength = caps.InputReportByteLength;
+
+        vector<BYTE> probe(caps.FeatureReportByteLength);
+        const ULONGLONG deadline = GetTickCount64() + READY_PROBE_DEADLINE_MS;
+        for (;;)
+        {
+            std::fill(probe.begin(), probe.end(), BYTE{0});
+            probe[0] = reportId;
+            const HIDIoResult result = IoControl(IOCTL_HID_GET_FEATURE, probe.data(), static_cast<DWORD>(probe.size()),
+                                                 READY_PROBE_IO_MS);
+            if (result == HIDIoResult::Ok)
+            {
+                return true;
+            }
+            if (result == HIDIoResult::Cancelled || GetTickCount64() >= deadline || !Delay(READY_PROBE_INTERVAL_MS))
+            {
+                return false;
+            }
+        }
+    }
+
+    // Report ID of the collection's first feature report, 0 when it does not use report IDs
+    static BYTE FirstFeatureReportId(PHIDP_PREPARSED_DATA preparsedData, const HIDP_CAPS &caps)
+    {
+        USHORT count = caps.NumberFeatureValueCaps;
+        if (count > 0)
+        {
+            vector<HIDP_VALUE_CAPS> values(count);
+            if (HidP_GetValueCaps(HidP_Feature, values.data(), &count, preparsedData) == HIDP_STATUS_SUCCESS && count > 0)
+            {
+                return values[0].ReportID;
+            }
+        }
+        count = caps.NumberFeatureButtonCaps;
+        if (count > 0)
+        {
+            vector<HIDP_BUTTON_CAPS> buttons(count);
+            if (HidP_GetButtonCaps(HidP_Feature, buttons.data(), &count, preparsedData) == HIDP_STATUS_SUCCESS && count > 0)
+            {
+                return buttons[0].ReportID;
+            }
+        }
+        return 0;
+    }
+
+    bool Transfer(DWORD code, BYTE *buffer, DWORD size) const
+    {
+        lastIoResult = IsOpen() ? SettleAndIoControl(code, buffer, size) : HIDIoResult::Error;
+        if (lastIoResult == HIDIoResult::Timeout)
+        {
+            ++timeoutCount;
+        }
+        return lastIoResult == HIDIoResult::Ok;
+    }
+
+    HIDIoResult SettleAndIoControl(DWORD code, BYTE *buffer, DWORD size) const
+    {
+        if (!settlePending)
+        {
+            return IoControl(code, buffer, size);
+        }
+
+        const ULONGLONG elapsed = GetTickCount64() - openedAt;
+        const ULONGLONG settleMs = SettleTracker::Instance().GetSettleMs(pid);
+        if (elapsed < settleMs && !Delay(static_cast<DWORD>(settleMs - elapsed)))
+        {
+            return HIDIoResult::Cancelled;
+        }
+
+        const HIDIoResult result = IoControl(code, buffer, size);
+        settlePending = false;
+        SettleTracker::Instance().RecordFirstTransfer(pid, result == HIDIoResult::Ok);
+        return result;
+    }
+
+    // Issues a feature-report IOCTL on the overlapped handle and waits for its completion, a
+    // cancellation request or the deadline, whichever comes first.
+    HIDIoResult IoControl(DWORD code, BYTE *buffer, DWORD size, DWORD timeoutMs = IO_TIMEOUT_MS) const
+    {
+        OVERLAPPED overlapped{};
+        overlapped.hEvent = ioEvent;
+        ResetEvent(ioEvent);
+
+        DWORD transferred = 0;
+        if (DeviceIoControl(deviceHandle, code, buffer, size, buffer, size, &transferred, &overlapped))
+        {
+            return HIDIoResult::Ok;
+        }
+
+        if (GetLastError() != ERROR_IO_PENDING)
+        {
+            return HIDIoResult::Error;
+        }
+
+        const HANDLE waitHandles[] = {ioEvent, cancelEvent};
+        const DWORD wait = WaitForMultipleObjects(2, waitHandles, FALSE, timeoutMs);
+        if (wait != WAIT_OBJECT_0)
+        {
+            CancelIoEx(deviceHandle, &overlapped);
+        }
+
+        // Always reap the request so the OVERLAPPED is no longer referenced by the driver
+        const BOOL completed = GetOverlappedResult(deviceHandle, &overlapped, &transferred, TRUE);
+        if (wait == WAIT_TIMEOUT)
+        {
+            return HIDIoResult::Timeout;
+        }
+        if (wait != WAIT_OBJECT_0)
+        {
+            return HIDIoResult::Cancelled;
+        }
+        return completed ? HIDIoResult::Ok : HIDIoResult::Error;
+    }
 
     static std::optional<DeviceInfo> GetDeviceInfo(HDEVINFO deviceInfoSet,
                                                    SP_DEVICE_INTERFACE_DATA &interfaceData,
-                                                   USHORT targetVid,
-                                                   USHORT targetPid)
+                                                   const vector<USHORT> &vendorIds,
+                                                   HIDScanStats &stats)
     {
         DWORD requiredSize = 0;
         SetupDiGetDeviceInterfaceDetailW(deviceInfoSet, &interfaceData, nullptr, 0, &requiredSize, nullptr);
@@ -159,22 +414,35 @@ private:
             return std::nullopt;
         }
 
+        // Paths that name a foreign vendor are rejected without touching the device; paths we
+        // cannot parse (virtual or converted devices) still fall through to the full query.
+        if (auto parsed = HIDPath::Parse(detailPtr->DevicePath))
+        {
+            if (std::find(vendorIds.begin(), vendorIds.end(), parsed->vid) == vendorIds.end())
+            {
+                ++stats.skippedByPath;
+                return std::nullopt;
+            }
+        }
+
+        ++stats.opened;
         HANDLE h = CreateFileW(detailPtr->DevicePath, 0, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
         if (h == INVALID_HANDLE_VALUE)
         {
             return std::nullopt;
         }
 
-        std::optional<DeviceInfo> result = ExtractDeviceInfo(h, detailPtr->DevicePath, targetVid, targetPid);
+        std::optional<DeviceInfo> result = ExtractDeviceInfo(h, detailPtr->DevicePath, vendorIds);
         CloseHandle(h);
         return result;
     }
 
-    static std::optional<DeviceInfo> ExtractDeviceInfo(HANDLE h, const wchar_t *path, USHORT targetVid, USHORT targetPid)
+    static std::optional<DeviceInfo> ExtractDeviceInfo(HANDLE h, const wchar_t *path, const vector<USHORT> &vendorIds)
     {
         HIDD_ATTRIBUTES attrib{};
         attrib.Size = sizeof(HIDD_ATTRIBUTES);
-        if (!HidD_GetAttributes(h, &attrib) || attrib.VendorID != targetVid || attrib.ProductID != targetPid)
+        if (!HidD_GetAttributes(h, &attrib) ||
+            std::find(vendorIds.begin(), vendorIds.end(), attrib.VendorID) == vendorIds.end())
         {
             return std::nullopt;
         }
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "core/hid_transport.hpp"
+#include "core/hid_path.hpp"
+#include "devices/device_table.hpp"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cwctype>
+
+using std::vector;
+using std::wstring;
+
+// Persistent view of the supported HID interfaces on the system, indexed by
+// (VID, PID, usage page, usage) so device classes can look up their interfaces in O(1). Only
+// products in the device table (DeviceTable::Find) are kept; other products of a supported vendor
+// are dropped when they are enumerated, and their arrivals are ignored by path.
+// It is built by one full enumeration pass and then kept current from the interface paths in
+// arrival/removal notifications; a full rescan only happens once it is marked stale.
+class HIDDeviceIndex
+{
+public:
+    explicit HIDDeviceIndex(vector<USHORT> vendors) : vendorIds(std::move(vendors)) {}
+
+    // Full enumeration pass; replaces the current contents
+    void Refresh()
+    {
+        byKey.clear();
+        keysByPath.clear();
+        interfaceCount = 0;
+
+        for (auto &info : HIDTransport::EnumerateDevices(vendorIds, stats))
+        {
+            if (IsSupportedProduct(info.vid, info.pid))
+            {
+                Add(std::move(info));
+            }
+        }
+
+        stale = false;
+        ++fullScans;
+        ++generation;
+    }
+
+    // Applies an arrival path. Paths naming an unsupported product are ignored without touching
+    // the device; anything else costs one targeted query. Returns true if a supported interface
+    // was added.
+    bool OnArrival(const wstring &path)
+    {
+        auto parsed = HIDPath::Parse(path);
+        if (parsed && !IsSupportedProduct(parsed->vid, parsed->pid))
+        {
+            return false;
+        }
+
+        auto infos = HIDTransport::QueryDevice(path, vendorIds);
+        infos.erase(std::remove_if(infos.begin(), infos.end(),
+                                   [this](const DeviceInfo &info)
+                                   { return !IsSupportedProduct(info.vid, info.pid); }),
+                    infos.end());
+        if (infos.empty())
+        {
+            // Ours by path but not queryable yet (still initialising); let the next lookup rescan
+            if (parsed)
+            {
+                stale = true;
+            }
+            return false;
+        }
+
+        Remove(path);
+        for (auto &info : infos)
+        {
+            Add(std::move(info));
+        }
+        ++generation;
+        return true;
+    }
+
+    // Returns true if the path was indexed
+    bool OnRemoval(const wstring &path)
+    {
+        if (!Remove(path))
+        {
+            return false;
+        }
+        ++generation;
+        return true;
+    }
+
+    void MarkStale() { stale = true; }
+    bool IsStale() const { return stale; }
+
+    const vector<DeviceInfo> &Find(USHORT vid, USHORT pid, USHORT usagePage, USHORT usage) const
+    {
+        static const vector<DeviceInfo> empty;
+        auto it = byKey.find(MakeKey(vid, pid, usagePage, usage));
+        return it != byKey.end() ? it->second : empty;
+    }
+
+    bool Contains(const wstring &path) const
+    {
+        return keysByPath.count(NormalizePath(path)) > 0;
+    }
+
+    bool IsSupportedVendor(USHORT vid) const
+    {
+        return std::find(vendorIds.begin(), vendorIds.end(), vid) != vendorIds.end();
+    }
+
+    // A product in the device table, from a vendor this build supports
+    bool IsSupportedProduct(USHORT vid, USHORT pid) const
+    {
+        return DeviceTable::Find(vid, pid) && IsSupportedVendor(vid);
+    }
+
+    size_t Size() const { return interfaceCount; }
+    // Stats of the most recent full scan
+    const HIDScanStats &Stats() const { return stats; }
+    size_t FullScanCount() const { return fullScans; }
+    // Bumped on every change; lets callers detect that the set of present devices moved
+    uint64_t Generation() const { return generation; }
+
+    // Notification paths and SetupAPI paths differ in case only
+    static wstring NormalizePath(const wstring &path)
+    {
+        wstring normalized(path);
+        std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+                       [](wchar_t c)
+                       { return static_cast<wchar_t>(std::towlower(static_cast<wint_t>(c))); });
+        return normalized;
+    }
+
+private:
+    vector<USHORT> vendorIds;
+    std::unordered_map<uint64_t, vector<DeviceInfo>> byKey;
+    std::unordered_map<wstring, vector<uint64_t>> keysByPath;
+    size_t interfaceCount = 0;
+    HIDScanStats stats;
+    size_t fullScans = 0;
+    uint64_t generation = 0;
+    bool stale = true;
+
+    void Add(DeviceInfo info)
+    {
+        const uint64_t key = MakeKey(info.vid, info.pid, info.usagePage, info.usage);
+        keysByPath[NormalizePath(info.path)].push_back(key);
+        byKey[key].push_back(std::move(info));
+        ++interfaceCount;
+    }
+
+    bool Remove(const wstring &path)
+    {
+        const wstring normalized = NormalizePath(path);
+        auto it = keysByPath.find(normalized);
+        if (it == keysByPath.end())
+        {
+            return false;
+        }
+
+        for (uint64_t key : it->second)
+        {
+            auto &entries = byKey[key];
+            const size_t before = entries.size();
+            entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                         [&normalized](const DeviceInfo &info)
+                                         { return NormalizePath(info.path) == normalized; }),
+                          entries.end());
+            interfaceCount -= before - entries.size();
+            if (entries.empty())
+            {
+                byKey.erase(key);
+            }
+        }
+
+        keysByPath.erase(it);
+        return true;
+    }
+
+    static uint64_t MakeKey(USHORT vid, USHORT pid, USHORT usagePage, USHORT usage)
+    {
+        return (static_cast<uint64_t>(vid) << 48) |
+               (static_cast<uint64_t>(pid) << 32) |
+               (static_cast<uint64_t>(usagePage) << 16) |
+               static_cast<uint64_t>(usage);
+    }
+};
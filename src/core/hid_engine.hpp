@@ -0,0 +1,185 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include "core/logger.hpp"
+
+using std::string;
+
+// Runs HID work on a dedicated thread so protocol delays never stall the window's message loop.
+// Work items hand their results back as completions; the owner is woken through the notify
+// callback (a PostMessage for the tray app) and runs them on its own thread via DrainCompletions.
+class HIDEngine
+{
+public:
+    using Task = std::function<void()>;
+
+    HIDEngine() = default;
+
+    ~HIDEngine()
+    {
+        Stop();
+    }
+
+    HIDEngine(const HIDEngine &) = delete;
+    HIDEngine &operator=(const HIDEngine &) = delete;
+
+    // notify: wakes the owner thread when completions are queued
+    // cancel: aborts whatever HID work is running so Stop() does not wait out protocol delays
+    void Start(std::function<void()> notify, std::function<void()> cancel)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (worker.joinable())
+        {
+            return;
+        }
+
+        notifyOwner = std::move(notify);
+        cancelWork = std::move(cancel);
+        stopping = false;
+        worker = std::thread(&HIDEngine::Run, this);
+        LOG_DEBUG("HID engine started");
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!worker.joinable())
+            {
+                return;
+            }
+            stopping = true;
+            pending.clear();
+        }
+
+        wake.notify_all();
+        if (cancelWork)
+        {
+            cancelWork();
+        }
+        worker.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        completions.clear();
+        LOG_DEBUG("HID engine stopped");
+    }
+
+    // Queues work for the engine thread; tasks run one at a time in submission order
+    void Submit(Task work)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || !worker.joinable())
+            {
+                return;
+            }
+            pending.push_back(std::move(work));
+        }
+        wake.notify_one();
+    }
+
+    // Called from engine tasks; the completion runs on the owner thread during DrainCompletions
+    void Complete(Task completion)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+            {
+                return;
+            }
+            completions.push_back(std::move(completion));
+        }
+
+        if (notifyOwner)
+        {
+            notifyOwner();
+        }
+    }
+
+    // How long the running task has been executing; zero while idle. With deadline-bounded
+    // transports this stays small, so a large value means a task is stuck.
+    std::chrono::milliseconds BusyFor() const
+    {
+        const int64_t started = taskStartedMs.load();
+        if (started == 0)
+        {
+            return std::chrono::milliseconds(0);
+        }
+        return std::chrono::milliseconds(NowMs() - started);
+    }
+
+    void DrainCompletions()
+    {
+        std::deque<Task> ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.swap(completions);
+        }
+
+        for (auto &completion : ready)
+        {
+            completion();
+        }
+    }
+
+private:
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Task> pending;
+    std::deque<Task> completions;
+    std::function<void()> notifyOwner;
+    std::function<void()> cancelWork;
+    bool stopping = false;
+    std::atomic<int64_t> taskStartedMs{0};
+
+    static int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    void Run()
+    {
+        for (;;)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this]
+                          { return stopping || !pending.empty(); });
+                if (stopping)
+                {
+                    return;
+                }
+                task = std::move(pending.front());
+                pending.pop_front();
+            }
+
+            taskStartedMs = (std::max)(NowMs(), int64_t{1});
+            try
+            {
+                task();
+            }
+            catch (const std::exception &ex)
+            {
+                LOG_ERROR("Exception in HID engine task: " + string(ex.what()));
+            }
+            catch (...)
+            {
+                LOG_ERROR("Unknown exception in HID engine task");
+            }
+            taskStartedMs = 0;
+        }
+    }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "core/hid_transport.hpp"
+#include "core/hid_device_index.hpp"
+#include <memory>
+#include <unordered_map>
+#include <string>
+
+using std::wstring;
+
+// Open HID handles by interface path, shared with the device classes using them. A handle stays
+// pooled after its device class lets go of it, e.g. the dongle's while the wired mouse is
+// active, so connecting to that interface again takes neither an open nor the readiness wait
+// after it. A handle leaves the pool when its interface is removed or no longer indexed, when
+// it hit a transport deadline, or when every connection is dropped. Engine thread only.
+class HIDHandlePool
+{
+public:
+    using Handle = std::shared_ptr<HIDTransport>;
+
+    struct Stats
+    {
+        size_t hits = 0;      // connections served by a pooled handle
+        size_t opens = 0;     // handles opened
+        size_t evictions = 0; // pooled handles dropped
+    };
+
+    // false closes every handle as soon as no device class uses it any more
+    void SetKeepIdle(bool keep)
+    {
+        keepIdle = keep;
+        if (!keepIdle)
+        {
+            handles.clear();
+        }
+    }
+
+    // The pooled handle for the interface if it is still open, otherwise a newly opened one;
+    // nullptr if the interface cannot be opened
+    Handle Acquire(const DeviceInfo &info)
+    {
+        const wstring key = HIDDeviceIndex::NormalizePath(info.path);
+        auto it = handles.find(key);
+        if (it != handles.end())
+        {
+            if (it->second->IsOpen())
+            {
+                ++stats.hits;
+                // A disconnect that stopped an input listener left the handle cancelled
+                it->second->ResetCancel();
+                return it->second;
+            }
+            handles.erase(it);
+            ++stats.evictions;
+        }
+
+        auto handle = std::make_shared<HIDTransport>();
+        if (!handle->Open(info))
+        {
+            return nullptr;
+        }
+        ++stats.opens;
+        if (keepIdle)
+        {
+            handles.emplace(key, handle);
+        }
+        return handle;
+    }
+
+    // The interface went away or its handle is wedged; a device class still holding the handle
+    // keeps it until it disconnects
+    void Evict(const wstring &path)
+    {
+        if (handles.erase(HIDDeviceIndex::NormalizePath(path)) > 0)
+        {
+            ++stats.evictions;
+        }
+    }
+
+    // Drops handles of interfaces a full rescan no longer found
+    void Retain(const HIDDeviceIndex &index)
+    {
+        for (auto it = handles.begin(); it != handles.end();)
+        {
+            if (index.Contains(it->first))
+            {
+                ++it;
+                continue;
+            }
+            it = handles.erase(it);
+            ++stats.evictions;
+        }
+    }
+
+    void Clear()
+    {
+        stats.evictions += handles.size();
+        handles.clear();
+    }
+
+    size_t Size() const { return handles.size(); }
+    const Stats &GetStats() const { return stats; }
+
+private:
+    std::unordered_map<wstring, Handle> handles;
+    Stats stats;
+    bool keepIdle = true;
+};
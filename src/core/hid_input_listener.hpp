@@ -0,0 +1,79 @@
+#pragma once
+
+#include "core/hid_transport.hpp"
+#include "core/logger.hpp"
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// Keeps an input-report read outstanding on an open transport from a dedicated thread and hands
+// every report to a callback. The transport is shared with the thread doing feature-report I/O;
+// the owner must Cancel() the transport before Stop() so a pending read returns at once, and
+// must not Close() it while the listener runs.
+class HIDInputListener
+{
+public:
+    using Handler = std::function<void(const BYTE *report, DWORD size)>;
+
+    static constexpr DWORD MAX_REPORT_SIZE = 256;
+    static constexpr DWORD READ_TIMEOUT_MS = 1000;
+
+    HIDInputListener() = default;
+
+    ~HIDInputListener()
+    {
+        Stop();
+    }
+
+    HIDInputListener(const HIDInputListener &) = delete;
+    HIDInputListener &operator=(const HIDInputListener &) = delete;
+
+    void Start(const HIDTransport &transport, Handler handler)
+    {
+        Stop();
+        stopping = false;
+        running = true;
+        worker = std::thread(&HIDInputListener::Run, this, &transport, std::move(handler));
+    }
+
+    void Stop()
+    {
+        stopping = true;
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    // False once the thread has ended, either through Stop() or because the read failed
+    bool IsRunning() const { return running; }
+
+private:
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> running{false};
+
+    void Run(const HIDTransport *transport, Handler handler)
+    {
+        LOG_DEBUG("Input report listener started");
+
+        BYTE buffer[MAX_REPORT_SIZE];
+        size_t reports = 0;
+        while (!stopping)
+        {
+            DWORD bytesRead = 0;
+            if (!transport->ReadInputReport(buffer, MAX_REPORT_SIZE, READ_TIMEOUT_MS, bytesRead))
+            {
+                break;
+            }
+            if (bytesRead > 0)
+            {
+                ++reports;
+                handler(buffer, bytesRead);
+            }
+        }
+
+        LOG_DEBUG("Input report listener stopped after " + std::to_string(reports) + " reports");
+        running = false;
+    }
+};
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <cwctype>
+#include <optional>
+#include <string_view>
+
+// Identity fields recoverable from a HID device interface path without opening it
+struct HIDPathInfo
+{
+    uint16_t vid = 0;
+    uint16_t pid = 0;
+    int interfaceNumber = -1; // MI_xx, -1 when the device has a single interface
+    int collection = -1;      // COLxx, -1 when the interface has a single top-level collection
+};
+
+// Parses SetupAPI / WM_DEVICECHANGE interface paths such as
+//   \\?\hid#vid_3367&pid_1970&mi_02&col03#8&2c3a1b7&0&0002#{4d1e55b2-...}
+//   \\?\hid#{00001124-0000-1000-8000-00805f9b34fb}_vid&0002046d_pid&b019&col01#...
+// Deliberately free of Win32 types so it can be exercised on any platform.
+class HIDPath
+{
+public:
+    static std::optional<HIDPathInfo> Parse(std::wstring_view path)
+    {
+        const std::wstring_view hardwareId = HardwareIdSegment(path);
+
+        HIDPathInfo info;
+        bool hasVid = false;
+        bool hasPid = false;
+
+        // USB style: VID_xxxx&PID_xxxx
+        if (auto vid = HexAfter(hardwareId, L"vid_", 4, 4))
+        {
+            info.vid = static_cast<uint16_t>(*vid);
+            hasVid = true;
+        }
+        // Bluetooth style: VID&0002xxxx (vendor source + vendor id) or BLE VID&02xxxx
+        else if (auto vid = HexAfter(hardwareId, L"vid&", 4, 8))
+        {
+            info.vid = static_cast<uint16_t>(*vid & 0xFFFF);
+            hasVid = true;
+        }
+
+        if (auto pid = HexAfter(hardwareId, L"pid_", 4, 4))
+        {
+            info.pid = static_cast<uint16_t>(*pid);
+            hasPid = true;
+        }
+        else if (auto pid = HexAfter(hardwareId, L"pid&", 4, 4))
+        {
+            info.pid = static_cast<uint16_t>(*pid);
+            hasPid = true;
+        }
+
+        if (!hasVid || !hasPid)
+        {
+            return std::nullopt;
+        }
+
+        if (auto mi = HexAfter(hardwareId, L"&mi_", 2, 2))
+        {
+            info.interfaceNumber = static_cast<int>(*mi);
+        }
+
+        if (auto col = HexAfter(hardwareId, L"&col", 2, 2))
+        {
+            info.collection = static_cast<int>(*col);
+        }
+
+        return info;
+    }
+
+private:
+    // The hardware ID sits between the first and second '#'; restricting the search to it keeps
+    // instance IDs and the interface GUID from producing false matches.
+    static std::wstring_view HardwareIdSegment(std::wstring_view path)
+    {
+        const size_t first = path.find(L'#');
+        if (first == std::wstring_view::npos)
+        {
+            return path;
+        }
+
+        const size_t second = path.find(L'#', first + 1);
+        return path.substr(first + 1, second == std::wstring_view::npos ? std::wstring_view::npos
+                                                                          : second - first - 1);
+    }
+
+    static size_t FindNoCase(std::wstring_view haystack, std::wstring_view needle)
+    {
+        if (needle.size() > haystack.size())
+        {
+            return std::wstring_view::npos;
+        }
+
+        for (size_t i = 0; i + needle.size() <= haystack.size(); ++i)
+        {
+            size_t j = 0;
+            while (j < needle.size() &&
+                   std::towlower(static_cast<wint_t>(haystack[i + j])) == static_cast<wint_t>(needle[j]))
+            {
+                ++j;
+            }
+            if (j == needle.size())
+            {
+                return i;
+            }
+        }
+        return std::wstring_view::npos;
+    }
+
+    static int HexValue(wchar_t c)
+    {
+        if (c >= L'0' && c <= L'9')
+            return c - L'0';
+        if (c >= L'a' && c <= L'f')
+            return c - L'a' + 10;
+        if (c >= L'A' && c <= L'F')
+            return c - L'A' + 10;
+        return -1;
+    }
+
+    // Reads between minDigits and maxDigits hex digits following the (lowercase) marker
+    static std::optional<uint32_t> HexAfter(std::wstring_view text, std::wstring_view marker,
+                                            size_t minDigits, size_t maxDigits)
+    {
+        const size_t pos = FindNoCase(text, marker);
+        if (pos == std::wstring_view::npos)
+        {
+            return std::nullopt;
+        }
+
+        uint32_t value = 0;
+        size_t digits = 0;
+        for (size_t i = pos + marker.size(); i < text.size() && digits < maxDigits; ++i, ++digits)
+        {
+            const int v = HexValue(text[i]);
+            if (v < 0)
+            {
+                break;
+            }
+            value = (value << 4) | static_cast<uint32_t>(v);
+        }
+
+        if (digits < minDigits)
+        {
+            return std::nullopt;
+        }
+        return value;
+    }
+};
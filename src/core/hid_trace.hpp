@@ -0,0 +1,222 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include "core/hid_types.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <memory>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <filesystem>
+#include <algorithm>
+#include <cstdio>
+
+using std::string;
+using std::vector;
+
+// Compact binary capture of the report traffic of one device session (Open to Close).
+//
+// Header (16 bytes, little endian):  "MBMT" | u16 version | u16 vid | u16 pid | u16 usagePage |
+//                                    u16 usage | u16 reserved
+// Record:                            u8 op | u8 HIDIoResult | u16 size | u32 offsetUs | u32 durationUs |
+//                                    size bytes of report data
+//
+// offsetUs is the call start relative to Open; durationUs is how long the call took. Send records
+// hold the bytes written, Get records the bytes the device returned, Input records an unsolicited
+// input report (durationUs is how long the listener waited for it).
+enum class HIDTraceOp : BYTE
+{
+    Send = 1,
+    Get = 2,
+    Input = 3
+};
+
+struct HIDTraceRecord
+{
+    HIDTraceOp op = HIDTraceOp::Send;
+    HIDIoResult result = HIDIoResult::Error;
+    uint32_t offsetUs = 0;
+    uint32_t durationUs = 0;
+    vector<BYTE> data;
+};
+
+struct HIDTraceFile
+{
+    static constexpr char MAGIC[4] = {'M', 'B', 'M', 'T'};
+    static constexpr USHORT VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t RECORD_HEADER_SIZE = 12;
+
+    DeviceInfo device{};
+    vector<HIDTraceRecord> records;
+
+    // Reads only the header; used to enumerate traces without loading them
+    static std::optional<DeviceInfo> ReadHeader(const string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        BYTE header[HEADER_SIZE];
+        if (!file.read(reinterpret_cast<char *>(header), HEADER_SIZE))
+        {
+            return std::nullopt;
+        }
+        return ParseHeader(header, path);
+    }
+
+    static std::optional<HIDTraceFile> Load(const string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        BYTE header[HEADER_SIZE];
+        if (!file.read(reinterpret_cast<char *>(header), HEADER_SIZE))
+        {
+            return std::nullopt;
+        }
+
+        auto device = ParseHeader(header, path);
+        if (!device)
+        {
+            return std::nullopt;
+        }
+
+        HIDTraceFile trace;
+        trace.device = *device;
+
+        BYTE recordHeader[RECORD_HEADER_SIZE];
+        while (file.read(reinterpret_cast<char *>(recordHeader), RECORD_HEADER_SIZE))
+        {
+            HIDTraceRecord record;
+            record.op = static_cast<HIDTraceOp>(recordHeader[0]);
+            record.result = static_cast<HIDIoResult>(recordHeader[1]);
+            record.data.resize(GetU16(recordHeader + 2));
+            record.offsetUs = GetU32(recordHeader + 4);
+            record.durationUs = GetU32(recordHeader + 8);
+
+            if (!record.data.empty() &&
+                !file.read(reinterpret_cast<char *>(record.data.data()), record.data.size()))
+            {
+                break; // Truncated tail, keep what was complete
+            }
+            trace.records.push_back(std::move(record));
+        }
+
+        return trace;
+    }
+
+    static USHORT GetU16(const BYTE *p) { return static_cast<USHORT>(p[0] | (p[1] << 8)); }
+
+    static uint32_t GetU32(const BYTE *p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+               (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    static void PutU16(BYTE *p, USHORT value)
+    {
+        p[0] = static_cast<BYTE>(value);
+        p[1] = static_cast<BYTE>(value >> 8);
+    }
+
+    static void PutU32(BYTE *p, uint32_t value)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            p[i] = static_cast<BYTE>(value >> (8 * i));
+        }
+    }
+
+private:
+    static std::optional<DeviceInfo> ParseHeader(const BYTE *header, const string &path)
+    {
+        if (!std::equal(MAGIC, MAGIC + 4, header) || GetU16(header + 4) != VERSION)
+        {
+            return std::nullopt;
+        }
+        return DeviceInfo{wstring(path.begin(), path.end()),
+                          GetU16(header + 6), GetU16(header + 8),
+                          GetU16(header + 10), GetU16(header + 12)};
+    }
+};
+
+// Appends records for one session; created by RecordingTransport when tracing is enabled
+class HIDTraceWriter
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Process-wide capture switch. An empty directory disables recording.
+    static void SetDirectory(const string &directory)
+    {
+        std::atomic_store(&traceDirectory, std::make_shared<const string>(directory));
+    }
+
+    static std::unique_ptr<HIDTraceWriter> Create(const DeviceInfo &info)
+    {
+        auto directory = std::atomic_load(&traceDirectory);
+        if (!directory || directory->empty())
+        {
+            return nullptr;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(*directory, ec);
+
+        static std::atomic<unsigned> sessionCounter{0};
+        const auto stamp = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::system_clock::now().time_since_epoch())
+                               .count();
+        char name[64];
+        std::snprintf(name, sizeof(name), "%04x_%04x_%lld_%u.mbmt", info.vid, info.pid,
+                      static_cast<long long>(stamp), sessionCounter++);
+
+        auto writer = std::unique_ptr<HIDTraceWriter>(
+            new HIDTraceWriter((std::filesystem::path(*directory) / name).string()));
+        if (!writer->file.is_open())
+        {
+            return nullptr;
+        }
+
+        BYTE header[HIDTraceFile::HEADER_SIZE] = {0};
+        std::copy(HIDTraceFile::MAGIC, HIDTraceFile::MAGIC + 4, header);
+        HIDTraceFile::PutU16(header + 4, HIDTraceFile::VERSION);
+        HIDTraceFile::PutU16(header + 6, info.vid);
+        HIDTraceFile::PutU16(header + 8, info.pid);
+        HIDTraceFile::PutU16(header + 10, info.usagePage);
+        HIDTraceFile::PutU16(header + 12, info.usage);
+        writer->file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        return writer;
+    }
+
+    // Thread-safe: input reports are recorded from the listener thread
+    void Append(HIDTraceOp op, HIDIoResult result, const BYTE *data, DWORD size,
+                Clock::time_point start, Clock::time_point end)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        BYTE recordHeader[HIDTraceFile::RECORD_HEADER_SIZE];
+        recordHeader[0] = static_cast<BYTE>(op);
+        recordHeader[1] = static_cast<BYTE>(result);
+        HIDTraceFile::PutU16(recordHeader + 2, static_cast<USHORT>(size));
+        HIDTraceFile::PutU32(recordHeader + 4, ToMicros(start - sessionStart));
+        HIDTraceFile::PutU32(recordHeader + 8, ToMicros(end - start));
+
+        file.write(reinterpret_cast<const char *>(recordHeader), sizeof(recordHeader));
+        file.write(reinterpret_cast<const char *>(data), size);
+        file.flush();
+    }
+
+private:
+    explicit HIDTraceWriter(const string &path)
+        : file(path, std::ios::binary | std::ios::trunc), sessionStart(Clock::now()) {}
+
+    static uint32_t ToMicros(Clock::duration duration)
+    {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    static inline std::shared_ptr<const string> traceDirectory;
+
+    std::ofstream file;
+    std::mutex mutex;
+    Clock::time_point sessionStart;
+};
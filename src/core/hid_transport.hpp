@@ -0,0 +1,82 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include "core/hid_types.hpp"
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// HID transport contract shared by every backend. Protocol and device code is written against
+// HIDTransport, which is resolved at compile time, so report I/O stays a direct call with no
+// virtual dispatch. A transport provides:
+//
+//   using Clock = ...;                      // time base of Delay(); steady_clock on hardware
+//   static vector<DeviceInfo> EnumerateDevices(const vector<USHORT> &vendorIds, HIDScanStats &stats);
+//   static vector<DeviceInfo> QueryDevice(const wstring &path, const vector<USHORT> &vendorIds);
+//   bool Open(const DeviceInfo &info);      void Close();          bool IsOpen() const;
+//   bool SendFeatureReport(const BYTE *buffer, DWORD size) const;
+//   bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const;
+//   bool ReadInputReport(BYTE *buffer, DWORD size, DWORD timeoutMs, DWORD &bytesRead) const;
+//                                           // bytesRead == 0 on timeout; may run on another thread
+//   HIDIoResult GetLastIoResult() const;    // classification of the last feature-report call
+//   size_t GetTimeoutCount() const;         // feature calls that hit their deadline since Open
+//   bool Delay(DWORD milliseconds) const;   // false when cancelled
+//   void Cancel() const;                    // thread-safe
+//   void ResetCancel() const;               // lets a kept-open handle work again after Cancel()
+//   USHORT GetVID() const;                  USHORT GetPID() const;
+template <typename T, typename = void>
+struct IsHIDTransport : std::false_type
+{
+};
+
+template <typename T>
+struct IsHIDTransport<T, std::void_t<
+                             decltype(T::Clock::now()),
+                             decltype(T::EnumerateDevices(std::declval<const std::vector<USHORT> &>(),
+                                                          std::declval<HIDScanStats &>())),
+                             decltype(T::QueryDevice(std::declval<const wstring &>(),
+                                                     std::declval<const std::vector<USHORT> &>())),
+                             decltype(std::declval<T &>().Open(std::declval<const DeviceInfo &>())),
+                             decltype(std::declval<T &>().Close()),
+                             decltype(std::declval<const T &>().IsOpen()),
+                             decltype(std::declval<const T &>().SendFeatureReport(std::declval<const BYTE *>(), DWORD{})),
+                             decltype(std::declval<const T &>().GetFeatureReport(BYTE{}, std::declval<BYTE *>(), DWORD{})),
+                             decltype(std::declval<const T &>().ReadInputReport(std::declval<BYTE *>(), DWORD{}, DWORD{},
+                                                                                std::declval<DWORD &>())),
+                             decltype(std::declval<const T &>().GetLastIoResult()),
+                             decltype(std::declval<const T &>().GetTimeoutCount()),
+                             decltype(std::declval<const T &>().Delay(DWORD{})),
+                             decltype(std::declval<const T &>().Cancel()),
+                             decltype(std::declval<const T &>().ResetCancel()),
+                             decltype(std::declval<const T &>().GetVID()),
+                             decltype(std::declval<const T &>().GetPID())>> : std::true_type
+{
+};
+
+// MBM_HID_REPLAY builds run entirely against recorded traces (see battery_replay),
+// MBM_HID_SIM builds against a timing model of the Endgame Gear dongle (see battery_sim)
+// HID_PARALLEL_HANDLES tells whether separate handles may do report I/O on different threads
+// at once; the replay and simulated backends run every handle on one shared timeline
+#if defined(MBM_HID_REPLAY)
+#include "core/replay_transport.hpp"
+using HIDTransport = HIDReplayTransport;
+inline constexpr bool HID_PARALLEL_HANDLES = false;
+#elif defined(MBM_HID_SIM)
+#include "core/sim_transport.hpp"
+using HIDTransport = HIDSimTransport;
+inline constexpr bool HID_PARALLEL_HANDLES = false;
+#else
+#ifdef _WIN32
+#include "core/hid_device.hpp"
+using PlatformHIDTransport = HIDDevice;
+#else
+#include "core/hidraw_device.hpp"
+using PlatformHIDTransport = HidrawDevice;
+#endif
+
+#include "core/recording_transport.hpp"
+using HIDTransport = RecordingTransport<PlatformHIDTransport>;
+inline constexpr bool HID_PARALLEL_HANDLES = true;
+#endif
+
+static_assert(IsHIDTransport<HIDTransport>::value, "HIDTransport does not satisfy the transport contract");
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include <string>
+#include <cstddef>
+
+using std::wstring;
+
+struct DeviceInfo
+{
+    wstring path;
+    USHORT vid;
+    USHORT pid;
+    USHORT usagePage;
+    USHORT usage;
+};
+
+// Per-scan counters showing how many interfaces were rejected from their path alone
+struct HIDScanStats
+{
+    size_t interfaces = 0;
+    // Interfaces opened to read their attributes, and those rejected by their path instead; both
+    // stay 0 on backends that identify interfaces without opening them (hidraw reads sysfs)
+    size_t opened = 0;
+    size_t skippedByPath = 0;
+};
+
+// Outcome of one feature-report call. The values are stored in trace records, where older traces
+// only used Error (0) and Ok (1).
+enum class HIDIoResult : BYTE
+{
+    Error = 0,
+    Ok = 1,
+    Timeout = 2,   // exceeded the transport's deadline and was cancelled
+    Cancelled = 3  // aborted through Cancel()
+};
+
+inline const char *ToString(HIDIoResult result)
+{
+    switch (result)
+    {
+    case HIDIoResult::Ok:
+        return "ok";
+    case HIDIoResult::Timeout:
+        return "timeout";
+    case HIDIoResult::Cancelled:
+        return "cancelled";
+    default:
+        return "error";
+    }
+}
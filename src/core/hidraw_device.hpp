@@ -0,0 +1,390 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include "core/hid_types.hpp"
+#include <vector>
+#include <chrono>
+#include <string>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/hidraw.h>
+
+using std::string;
+using std::vector;
+using std::wstring;
+
+// Linux transport built on /dev/hidraw*. Enumeration reads sysfs only, so no device node is
+// opened until a candidate has matched on vendor and top-level collection.
+class HidrawDevice
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    HidrawDevice() : fd(-1), vid(0), pid(0), cancelFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+    ~HidrawDevice()
+    {
+        Close();
+        if (cancelFd >= 0)
+        {
+            close(cancelFd);
+        }
+    }
+
+    HidrawDevice(const HidrawDevice &) = delete;
+    HidrawDevice &operator=(const HidrawDevice &) = delete;
+
+    static vector<DeviceInfo> EnumerateDevices(const vector<USHORT> &vendorIds, HIDScanStats &stats)
+    {
+        vector<DeviceInfo> devices;
+        stats = {};
+
+        DIR *dir = opendir(SYSFS_HIDRAW);
+        if (!dir)
+        {
+            return devices;
+        }
+
+        while (dirent *entry = readdir(dir))
+        {
+            const string node = entry->d_name;
+            if (node.compare(0, 6, "hidraw") != 0)
+            {
+                continue;
+            }
+
+            // Identified from sysfs without opening the node, so opened and skippedByPath stay 0
+            ++stats.interfaces;
+            QueryNode(node, vendorIds, devices);
+        }
+
+        closedir(dir);
+        return devices;
+    }
+
+    // Targeted lookup of a single /dev/hidrawN node
+    static vector<DeviceInfo> QueryDevice(const wstring &path, const vector<USHORT> &vendorIds)
+    {
+        vector<DeviceInfo> devices;
+        const string narrowPath = Narrow(path);
+        QueryNode(narrowPath.substr(narrowPath.find_last_of('/') + 1), vendorIds, devices);
+        return devices;
+    }
+
+    bool Open(const wstring &devicePath)
+    {
+        Close();
+
+        fd = open(Narrow(devicePath).c_str(), O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        DrainCancel();
+        lastIoResult = HIDIoResult::Ok;
+        timeoutCount = 0;
+
+        hidraw_devinfo info{};
+        if (ioctl(fd, HIDIOCGRAWINFO, &info) >= 0)
+        {
+            vid = static_cast<USHORT>(info.vendor);
+            pid = static_cast<USHORT>(info.product);
+        }
+
+        return true;
+    }
+
+    bool Open(const DeviceInfo &info)
+    {
+        return Open(info.path);
+    }
+
+    void Close()
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    bool IsOpen() const { return fd >= 0; }
+
+    bool SendFeatureReport(const BYTE *buffer, DWORD size) const
+    {
+        return Transfer(HIDIOCSFEATURE(size), const_cast<BYTE *>(buffer));
+    }
+
+    bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const
+    {
+        buffer[0] = reportId;
+        return Transfer(HIDIOCGFEATURE(size), buffer);
+    }
+
+    HIDIoResult GetLastIoResult() const { return lastIoResult; }
+    size_t GetTimeoutCount() const { return timeoutCount; }
+
+    // Same contract as HIDDevice::ReadInputReport. hidraw prefixes the report ID only for
+    // numbered reports, which every supported vendor collection uses.
+    bool ReadInputReport(BYTE *buffer, DWORD size, DWORD timeoutMs, DWORD &bytesRead) const
+    {
+        bytesRead = 0;
+        if (!IsOpen())
+        {
+            return false;
+        }
+
+        pollfd pfds[2] = {{fd, POLLIN, 0}, {cancelFd, POLLIN, 0}};
+        int result;
+        do
+        {
+            result = poll(pfds, 2, static_cast<int>(timeoutMs));
+        } while (result < 0 && errno == EINTR);
+
+        if (result == 0)
+        {
+            return true;
+        }
+        if (result < 0 || (pfds[1].revents & POLLIN) || !(pfds[0].revents & POLLIN))
+        {
+            return false;
+        }
+
+        const ssize_t received = read(fd, buffer, size);
+        if (received < 0)
+        {
+            return false;
+        }
+        bytesRead = static_cast<DWORD>(received);
+        return true;
+    }
+
+    // Same contract as HIDDevice::Delay: false when Cancel() interrupts the wait
+    bool Delay(DWORD milliseconds) const
+    {
+        pollfd pfd{cancelFd, POLLIN, 0};
+        int result;
+        do
+        {
+            result = poll(&pfd, 1, static_cast<int>(milliseconds));
+        } while (result < 0 && errno == EINTR);
+        return result == 0;
+    }
+
+    void Cancel() const
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(cancelFd, &one, sizeof(one));
+    }
+
+    void ResetCancel() const
+    {
+        DrainCancel();
+    }
+
+    USHORT GetVID() const { return vid; }
+    USHORT GetPID() const { return pid; }
+
+private:
+    static constexpr const char *SYSFS_HIDRAW = "/sys/class/hidraw";
+
+    int fd;
+    USHORT vid;
+    USHORT pid;
+    int cancelFd;
+    mutable HIDIoResult lastIoResult = HIDIoResult::Ok;
+    mutable size_t timeoutCount = 0;
+
+    // Feature ioctls cannot be interrupted from user space; the deadline is the kernel's USB
+    // control-transfer timeout (5 s), which surfaces as ETIMEDOUT
+    bool Transfer(unsigned long request, BYTE *buffer) const
+    {
+        if (!IsOpen())
+        {
+            lastIoResult = HIDIoResult::Error;
+        }
+        else if (ioctl(fd, request, buffer) >= 0)
+        {
+            lastIoResult = HIDIoResult::Ok;
+        }
+        else if (errno == ETIMEDOUT)
+        {
+            lastIoResult = HIDIoResult::Timeout;
+            ++timeoutCount;
+        }
+        else
+        {
+            lastIoResult = HIDIoResult::Error;
+        }
+        return lastIoResult == HIDIoResult::Ok;
+    }
+
+    // Appends one DeviceInfo per top-level collection of the node; false if the node belongs to
+    // another vendor or its sysfs entry cannot be read
+    static bool QueryNode(const string &node, const vector<USHORT> &vendorIds, vector<DeviceInfo> &devices)
+    {
+        const string sysfsDevice = string(SYSFS_HIDRAW) + "/" + node + "/device";
+
+        USHORT nodeVid = 0;
+        USHORT nodePid = 0;
+        if (!ReadHidId(sysfsDevice + "/uevent", nodeVid, nodePid) ||
+            std::find(vendorIds.begin(), vendorIds.end(), nodeVid) == vendorIds.end())
+        {
+            return false;
+        }
+
+        const wstring path = Widen("/dev/" + node);
+        for (const auto &usage : ReadTopLevelUsages(sysfsDevice + "/report_descriptor"))
+        {
+            devices.push_back(DeviceInfo{path, nodeVid, nodePid, usage.first, usage.second});
+        }
+        return true;
+    }
+
+    void DrainCancel() const
+    {
+        uint64_t value;
+        while (read(cancelFd, &value, sizeof(value)) > 0)
+        {
+        }
+    }
+
+    // uevent carries HID_ID=<bus>:<vendor>:<product> with 4/8/8 hex digits
+    static bool ReadHidId(const string &ueventPath, USHORT &outVid, USHORT &outPid)
+    {
+        std::ifstream file(ueventPath);
+        string line;
+        while (std::getline(file, line))
+        {
+            if (line.compare(0, 7, "HID_ID=") != 0)
+            {
+                continue;
+            }
+
+            const size_t first = line.find(':');
+            const size_t second = line.find(':', first + 1);
+            if (first == string::npos || second == string::npos)
+            {
+                return false;
+            }
+
+            try
+            {
+                outVid = static_cast<USHORT>(std::stoul(line.substr(first + 1, second - first - 1), nullptr, 16));
+                outPid = static_cast<USHORT>(std::stoul(line.substr(second + 1), nullptr, 16));
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Windows exposes one interface per top-level collection; hidraw exposes one node per USB
+    // interface. Walking the report descriptor recovers the (usage page, usage) pairs so both
+    // backends produce the same DeviceInfo shape.
+    static vector<std::pair<USHORT, USHORT>> ReadTopLevelUsages(const string &descriptorPath)
+    {
+        vector<std::pair<USHORT, USHORT>> usages;
+
+        std::ifstream file(descriptorPath, std::ios::binary);
+        const vector<BYTE> desc((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        USHORT usagePage = 0;
+        uint32_t usage = 0;
+        bool hasUsage = false;
+        bool usageExtended = false; // 4-byte usage carries its own page in the high word
+        int depth = 0;
+
+        for (size_t i = 0; i < desc.size();)
+        {
+            const BYTE prefix = desc[i];
+
+            if (prefix == 0xFE)
+            {
+                // Long item: skip data size + tag + data
+                if (i + 1 >= desc.size())
+                {
+                    break;
+                }
+                i += 3 + desc[i + 1];
+                continue;
+            }
+
+            const size_t size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+            if (i + 1 + size > desc.size())
+            {
+                break;
+            }
+
+            uint32_t value = 0;
+            for (size_t b = 0; b < size; ++b)
+            {
+                value |= static_cast<uint32_t>(desc[i + 1 + b]) << (8 * b);
+            }
+
+            const BYTE type = (prefix >> 2) & 0x03;
+            const BYTE tag = prefix >> 4;
+
+            if (type == 1 && tag == 0x0) // Global: Usage Page
+            {
+                usagePage = static_cast<USHORT>(value);
+            }
+            else if (type == 2 && tag == 0x0 && !hasUsage) // Local: Usage (first one wins)
+            {
+                usage = value;
+                hasUsage = true;
+                usageExtended = size == 4;
+            }
+            else if (type == 0)
+            {
+                if (tag == 0xA) // Collection
+                {
+                    if (depth == 0 && hasUsage)
+                    {
+                        const USHORT page = usageExtended ? static_cast<USHORT>(usage >> 16) : usagePage;
+                        usages.emplace_back(page, static_cast<USHORT>(usage & 0xFFFF));
+                    }
+                    ++depth;
+                }
+                else if (tag == 0xC && depth > 0) // End Collection
+                {
+                    --depth;
+                }
+                hasUsage = false; // Local items only apply to the next main item
+            }
+
+            i += 1 + size;
+        }
+
+        return usages;
+    }
+
+    static wstring Widen(const string &text)
+    {
+        return wstring(text.begin(), text.end());
+    }
+
+    static string Narrow(const wstring &text)
+    {
+        string result;
+        result.reserve(text.size());
+        for (wchar_t c : text)
+        {
+            result.push_back(static_cast<char>(c));
+        }
+        return result;
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <algorithm>
+
+// Holds scheduled battery reads back while the mouse is in use. A feature report goes through
+// the same receiver as the mouse's input reports, and on 4K/8K polling dongles a round trip in
+// the middle of a flick can delay them; a read therefore waits until there was no input for
+// idleWindow, but never longer than maxDeferral. Times are passed in, so the simulator can run it
+// on its own clock.
+class IdleGate
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using milliseconds = std::chrono::milliseconds;
+
+    struct Settings
+    {
+        milliseconds idleWindow{500};
+        milliseconds maxDeferral{60000};
+    };
+
+    struct Stats
+    {
+        size_t reads = 0;    // reads let through
+        size_t deferred = 0; // reads that had to wait for an idle window
+        size_t forced = 0;   // reads that ran at maxDeferral without one
+        milliseconds longestWait{0};
+    };
+
+    explicit IdleGate(Settings settings) : settings(settings) {}
+
+    // A scheduled read is due; idleFor is the time since the last input. Returns zero when it may
+    // run now, otherwise how long to wait before asking again.
+    milliseconds Check(milliseconds idleFor, Clock::time_point now)
+    {
+        if (idleFor >= settings.idleWindow)
+        {
+            return Release(now, false);
+        }
+        if (!waiting)
+        {
+            waiting = true;
+            waitingSince = now;
+            ++stats.deferred;
+        }
+        const auto waited = std::chrono::duration_cast<milliseconds>(now - waitingSince);
+        if (waited >= settings.maxDeferral)
+        {
+            return Release(now, true);
+        }
+        return (std::min)(settings.idleWindow - idleFor, settings.maxDeferral - waited);
+    }
+
+    bool IsWaiting() const { return waiting; }
+    // Whether the read released last ran at maxDeferral rather than in an idle window
+    bool LastForced() const { return lastForced; }
+    const Stats &GetStats() const { return stats; }
+
+private:
+    Settings settings;
+    // Set while a due read waits for an idle window
+    bool waiting = false;
+    Clock::time_point waitingSince;
+    bool lastForced = false;
+    Stats stats;
+
+    milliseconds Release(Clock::time_point now, bool forced)
+    {
+        if (waiting)
+        {
+            stats.longestWait = (std::max)(stats.longestWait, std::chrono::duration_cast<milliseconds>(now - waitingSince));
+            waiting = false;
+        }
+        ++stats.reads;
+        stats.forced += forced ? 1 : 0;
+        lastForced = forced;
+        return milliseconds(0);
+    }
+};
@@ -110,7 +110,11 @@ private:
                         1000;
 
         std::tm tm;
+#ifdef _WIN32
         localtime_s(&tm, &timeT);
+#else
+        localtime_r(&timeT, &tm);
+#endif
 
         std::ostringstream oss;
         oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
@@ -0,0 +1,12 @@
+#pragma once
+
+// Win32 integer typedefs used throughout the device and protocol code. On other platforms the
+// same names are provided so the core builds unchanged against the Linux transport.
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cstdint>
+using BYTE = uint8_t;
+using USHORT = uint16_t;
+using DWORD = uint32_t;
+#endif
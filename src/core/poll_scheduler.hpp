@@ -0,0 +1,111 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <algorithm>
+
+// Picks the delay before the next scheduled battery read from what the last reads showed. A high
+// battery that drains slowly is read rarely; reads come closer together as the predicted time to
+// the low-battery threshold shrinks, so the crossing is noticed soon after it happens. Without a
+// status, while charging and below the threshold it reads at the base interval. A sleeping mouse
+// (no answer while its receiver is present) is read only at the maximum interval, since it cannot
+// answer until it is used again. Times are passed in, so the simulator can run it on its own clock.
+class PollScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using seconds = std::chrono::seconds;
+
+    struct Settings
+    {
+        seconds base{300};
+        seconds min{60};
+        seconds max{3600};
+        int lowThreshold = 20;
+    };
+
+    // Assumed drain until the readings give an estimate; wireless mice last roughly 50-100 h
+    static constexpr double DEFAULT_DRAIN_PER_HOUR = 2.0;
+    // Lowest drain trusted from readings, so a long flat stretch cannot stretch reads indefinitely
+    static constexpr double MIN_DRAIN_PER_HOUR = 0.5;
+    // Readings must span this long before their drain is used, and are kept for RATE_HISTORY
+    static constexpr seconds RATE_WINDOW{1800};
+    static constexpr std::chrono::hours RATE_HISTORY{24};
+    // Share of the predicted time to the threshold waited before the next read
+    static constexpr double THRESHOLD_SHARE = 0.25;
+    // Largest drop, in percent, the tray may fall behind by between two reads
+    static constexpr double MAX_STEP_PERCENT = 5.0;
+
+    explicit PollScheduler(Settings settings) : settings(settings) {}
+
+    // A read or input report published this status; percentage < 0 when there is none. Asleep
+    // means the mouse did not answer and the percentage is its last known one.
+    void OnStatus(int percentage, bool charging, bool asleep, Clock::time_point now)
+    {
+        this->asleep = asleep;
+        if (percentage < 0)
+        {
+            level = -1;
+            readings.clear();
+            return;
+        }
+        if (asleep)
+        {
+            return;
+        }
+
+        // A plug, an unplug or a rising level starts a new discharge curve
+        if (charging != this->charging || (!readings.empty() && percentage > readings.back().level))
+        {
+            readings.clear();
+        }
+        level = percentage;
+        this->charging = charging;
+        readings.push_back({now, percentage});
+        while (readings.size() > 2 && now - readings.front().at > RATE_HISTORY)
+        {
+            readings.pop_front();
+        }
+    }
+
+    seconds NextInterval() const
+    {
+        seconds interval = settings.base;
+        if (level >= 0 && asleep)
+        {
+            interval = settings.max;
+        }
+        else if (level > settings.lowThreshold && !charging)
+        {
+            const double drain = DrainPerHour();
+            const double hours = (std::min)((level - settings.lowThreshold) / drain * THRESHOLD_SHARE,
+                                            MAX_STEP_PERCENT / drain);
+            interval = seconds(static_cast<seconds::rep>(hours * 3600.0));
+        }
+        return (std::clamp)(interval, settings.min, (std::max)(settings.min, settings.max));
+    }
+
+    // Percent per hour from the readings of the current discharge curve, or the default
+    double DrainPerHour() const
+    {
+        if (readings.size() < 2 || readings.back().at - readings.front().at < RATE_WINDOW)
+        {
+            return DEFAULT_DRAIN_PER_HOUR;
+        }
+        const double hours = std::chrono::duration<double, std::ratio<3600>>(readings.back().at - readings.front().at).count();
+        return (std::max)((readings.front().level - readings.back().level) / hours, MIN_DRAIN_PER_HOUR);
+    }
+
+private:
+    struct Reading
+    {
+        Clock::time_point at;
+        int level;
+    };
+
+    Settings settings;
+    std::deque<Reading> readings;
+    int level = -1;
+    bool charging = false;
+    bool asleep = false;
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "core/hid_trace.hpp"
+#include <memory>
+
+// Wraps a platform transport and, when HIDTraceWriter has a capture directory, writes every
+// report call of the session to a trace file. With capture disabled the only cost over
+// the wrapped transport is a null check per call.
+template <typename Inner>
+class RecordingTransport : public Inner
+{
+public:
+    using Clock = HIDTraceWriter::Clock;
+
+    bool Open(const DeviceInfo &info)
+    {
+        trace.reset();
+        if (!Inner::Open(info))
+        {
+            return false;
+        }
+
+        trace = HIDTraceWriter::Create(info);
+        return true;
+    }
+
+    void Close()
+    {
+        trace.reset();
+        Inner::Close();
+    }
+
+    bool SendFeatureReport(const BYTE *buffer, DWORD size) const
+    {
+        if (!trace)
+        {
+            return Inner::SendFeatureReport(buffer, size);
+        }
+
+        const auto start = Clock::now();
+        const bool result = Inner::SendFeatureReport(buffer, size);
+        trace->Append(HIDTraceOp::Send, Inner::GetLastIoResult(), buffer, size, start, Clock::now());
+        return result;
+    }
+
+    bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const
+    {
+        if (!trace)
+        {
+            return Inner::GetFeatureReport(reportId, buffer, size);
+        }
+
+        const auto start = Clock::now();
+        const bool result = Inner::GetFeatureReport(reportId, buffer, size);
+        trace->Append(HIDTraceOp::Get, Inner::GetLastIoResult(), buffer, size, start, Clock::now());
+        return result;
+    }
+
+    // Only delivered reports are recorded; timeouts carry no information worth replaying
+    bool ReadInputReport(BYTE *buffer, DWORD size, DWORD timeoutMs, DWORD &bytesRead) const
+    {
+        if (!trace)
+        {
+            return Inner::ReadInputReport(buffer, size, timeoutMs, bytesRead);
+        }
+
+        const auto start = Clock::now();
+        const bool result = Inner::ReadInputReport(buffer, size, timeoutMs, bytesRead);
+        if (result && bytesRead > 0)
+        {
+            trace->Append(HIDTraceOp::Input, HIDIoResult::Ok, buffer, bytesRead, start, Clock::now());
+        }
+        return result;
+    }
+
+private:
+    std::unique_ptr<HIDTraceWriter> trace;
+};
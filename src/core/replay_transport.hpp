@@ -0,0 +1,256 @@
+#pragma once
+
+#include "core/hid_trace.hpp"
+#include "core/logger.hpp"
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+// Transport that serves a recorded trace back to the protocol code. Selected at compile time with
+// MBM_HID_REPLAY so DeviceManager, enumeration and both protocol families run unmodified against
+// captured sessions. Each trace file enumerates as one device; its path is the trace path.
+class HIDReplayTransport
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    HIDReplayTransport() = default;
+
+    HIDReplayTransport(const HIDReplayTransport &) = delete;
+    HIDReplayTransport &operator=(const HIDReplayTransport &) = delete;
+
+    // Traces presented by EnumerateDevices
+    static void SetSources(vector<string> traceFiles)
+    {
+        sources = std::move(traceFiles);
+    }
+
+    // 1.0 replays calls and protocol delays at recorded speed, 10.0 ten times faster,
+    // 0 as fast as possible
+    static void SetSpeed(double factor)
+    {
+        speed = factor;
+    }
+
+    // Replay calls whose direction or written bytes differed from the recording
+    static size_t GetMismatchCount() { return mismatches.load(); }
+
+    static vector<DeviceInfo> EnumerateDevices(const vector<USHORT> &vendorIds, HIDScanStats &stats)
+    {
+        vector<DeviceInfo> devices;
+        stats = {};
+
+        for (const auto &source : sources)
+        {
+            ++stats.interfaces;
+            auto info = HIDTraceFile::ReadHeader(source);
+            if (!info || std::find(vendorIds.begin(), vendorIds.end(), info->vid) == vendorIds.end())
+            {
+                ++stats.skippedByPath;
+                continue;
+            }
+            ++stats.opened;
+            devices.push_back(*info);
+        }
+        return devices;
+    }
+
+    static vector<DeviceInfo> QueryDevice(const wstring &path, const vector<USHORT> &vendorIds)
+    {
+        auto info = HIDTraceFile::ReadHeader(string(path.begin(), path.end()));
+        if (!info || std::find(vendorIds.begin(), vendorIds.end(), info->vid) == vendorIds.end())
+        {
+            return {};
+        }
+        return {*info};
+    }
+
+    bool Open(const DeviceInfo &info)
+    {
+        Close();
+
+        auto loaded = HIDTraceFile::Load(string(info.path.begin(), info.path.end()));
+        if (!loaded)
+        {
+            return false;
+        }
+
+        trace = std::move(*loaded);
+        cursor = 0;
+        inputCursor = 0;
+        lastIoResult = HIDIoResult::Ok;
+        timeoutCount = 0;
+        cancelled = false;
+        open = true;
+        return true;
+    }
+
+    void Close()
+    {
+        open = false;
+        trace.records.clear();
+        cursor = 0;
+        inputCursor = 0;
+    }
+
+    bool IsOpen() const { return open; }
+
+    bool SendFeatureReport(const BYTE *buffer, DWORD size) const
+    {
+        const HIDTraceRecord *record = Next(HIDTraceOp::Send);
+        if (!record)
+        {
+            return false;
+        }
+
+        if (!std::equal(buffer, buffer + (std::min)(static_cast<size_t>(size), record->data.size()),
+                        record->data.begin()))
+        {
+            ++mismatches;
+            LOG_DEBUG("Replay: sent report differs from recording at record " + std::to_string(cursor - 1));
+        }
+        return Complete(*record);
+    }
+
+    bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const
+    {
+        const HIDTraceRecord *record = Next(HIDTraceOp::Get);
+        if (!record)
+        {
+            return false;
+        }
+
+        std::fill(buffer, buffer + size, BYTE{0});
+        std::copy_n(record->data.begin(), (std::min)(static_cast<size_t>(size), record->data.size()), buffer);
+        buffer[0] = reportId;
+        return Complete(*record);
+    }
+
+    // Serves the recorded input reports in order, each after its recorded wait. Returns false
+    // once none are left so a listener thread ends with the trace.
+    bool ReadInputReport(BYTE *buffer, DWORD size, DWORD /*timeoutMs*/, DWORD &bytesRead) const
+    {
+        bytesRead = 0;
+
+        size_t index = inputCursor.load();
+        while (index < trace.records.size() && trace.records[index].op != HIDTraceOp::Input)
+        {
+            ++index;
+        }
+        if (!open || cancelled || index >= trace.records.size())
+        {
+            return false;
+        }
+        inputCursor = index + 1;
+
+        const HIDTraceRecord &record = trace.records[index];
+        Pace(std::chrono::microseconds(record.durationUs));
+        if (cancelled)
+        {
+            return false;
+        }
+
+        bytesRead = static_cast<DWORD>((std::min)(static_cast<size_t>(size), record.data.size()));
+        std::copy_n(record.data.begin(), bytesRead, buffer);
+        return record.result == HIDIoResult::Ok;
+    }
+
+    HIDIoResult GetLastIoResult() const { return lastIoResult; }
+    size_t GetTimeoutCount() const { return timeoutCount; }
+
+    bool Delay(DWORD milliseconds) const
+    {
+        Pace(std::chrono::milliseconds(milliseconds));
+        return !cancelled;
+    }
+
+    void Cancel() const
+    {
+        cancelled = true;
+    }
+
+    void ResetCancel() const
+    {
+        cancelled = false;
+    }
+
+    USHORT GetVID() const { return trace.device.vid; }
+    USHORT GetPID() const { return trace.device.pid; }
+
+    // True once every recorded feature-report call has been consumed
+    bool IsExhausted() const
+    {
+        for (size_t i = cursor; i < trace.records.size(); ++i)
+        {
+            if (trace.records[i].op != HIDTraceOp::Input)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static inline vector<string> sources;
+    static inline double speed = 0.0;
+    static inline std::atomic<size_t> mismatches{0};
+
+    HIDTraceFile trace;
+    mutable size_t cursor = 0;
+    mutable HIDIoResult lastIoResult = HIDIoResult::Ok;
+    mutable size_t timeoutCount = 0;
+    // Advanced by the listener thread only
+    mutable std::atomic<size_t> inputCursor{0};
+    mutable std::atomic<bool> cancelled{false};
+    bool open = false;
+
+    // Recorded timeouts replay as timeouts (after the recorded wait), so stalled-device sessions
+    // exercise the same recovery path as on hardware
+    bool Complete(const HIDTraceRecord &record) const
+    {
+        lastIoResult = record.result;
+        if (lastIoResult == HIDIoResult::Timeout)
+        {
+            ++timeoutCount;
+        }
+        return lastIoResult == HIDIoResult::Ok;
+    }
+
+    const HIDTraceRecord *Next(HIDTraceOp op) const
+    {
+        // Input records belong to the listener; feature calls step over them
+        while (cursor < trace.records.size() && trace.records[cursor].op == HIDTraceOp::Input)
+        {
+            ++cursor;
+        }
+        if (!open || cancelled || cursor >= trace.records.size())
+        {
+            lastIoResult = cancelled ? HIDIoResult::Cancelled : HIDIoResult::Error;
+            return nullptr;
+        }
+
+        const HIDTraceRecord &record = trace.records[cursor++];
+        if (record.op != op)
+        {
+            ++mismatches;
+            LOG_DEBUG("Replay: call order differs from recording at record " + std::to_string(cursor - 1));
+            lastIoResult = HIDIoResult::Error;
+            return nullptr;
+        }
+
+        Pace(std::chrono::microseconds(record.durationUs));
+        return &record;
+    }
+
+    static void Pace(std::chrono::microseconds recorded)
+    {
+        if (speed > 0.0)
+        {
+            std::this_thread::sleep_for(std::chrono::duration_cast<std::chrono::microseconds>(recorded / speed));
+        }
+    }
+};
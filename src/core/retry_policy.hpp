@@ -0,0 +1,289 @@
+#pragma once
+
+#include "core/hid_types.hpp"
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <random>
+#include <optional>
+#include <sstream>
+#include <algorithm>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+// Why one attempt of a protocol operation failed
+enum class FailureClass
+{
+    SendFailed,    // SetFeature returned an error
+    GetFailed,     // GetFeature returned an error
+    InvalidEcho,   // a response arrived, but not for the command that was sent
+    InvalidStatus, // the response carried no valid status within the deadline
+    Timeout        // a transfer hit the transport deadline; the handle is stalled
+};
+
+inline constexpr size_t FAILURE_CLASS_COUNT = 5;
+
+inline const char *ToString(FailureClass failure)
+{
+    switch (failure)
+    {
+    case FailureClass::SendFailed:
+        return "send";
+    case FailureClass::GetFailed:
+        return "get";
+    case FailureClass::InvalidEcho:
+        return "echo";
+    case FailureClass::InvalidStatus:
+        return "status";
+    case FailureClass::Timeout:
+        return "timeout";
+    }
+    return "unknown";
+}
+
+enum class TransferStage
+{
+    Send,
+    Get
+};
+
+// Failure class of a feature-report call that returned false; nullopt when it was cancelled,
+// which ends the operation without counting as a failure
+inline std::optional<FailureClass> ClassifyTransfer(TransferStage stage, HIDIoResult result)
+{
+    if (result == HIDIoResult::Cancelled)
+    {
+        return std::nullopt;
+    }
+    if (result == HIDIoResult::Timeout)
+    {
+        return FailureClass::Timeout;
+    }
+    return stage == TransferStage::Send ? FailureClass::SendFailed : FailureClass::GetFailed;
+}
+
+// Retries one failure class may use within an operation, and the wait before the first of them.
+// Each further retry of the same class waits twice as long, unless doubling is off.
+struct RetryRule
+{
+    int budget = 0;
+    DWORD delayMs = 0;
+    bool doubling = true;
+};
+
+// How an operation (one command, one battery read) is retried. Rules are per failure class; an
+// operation ends once the class of its latest failure has spent its budget or maxAttempts
+// attempts have run. Policies are constants next to the protocol code that uses them.
+struct RetryPolicy
+{
+    const char *name; // key of the attempts-to-success histogram
+    int maxAttempts;
+    RetryRule sendFailed;
+    RetryRule getFailed;
+    RetryRule invalidEcho;
+    RetryRule invalidStatus;
+    RetryRule timeout;
+
+    // Every delay is scaled by a random factor within +/- this share
+    static constexpr double JITTER = 0.25;
+
+    constexpr const RetryRule &Rule(FailureClass failure) const
+    {
+        switch (failure)
+        {
+        case FailureClass::SendFailed:
+            return sendFailed;
+        case FailureClass::GetFailed:
+            return getFailed;
+        case FailureClass::InvalidEcho:
+            return invalidEcho;
+        case FailureClass::InvalidStatus:
+            return invalidStatus;
+        default:
+            return timeout;
+        }
+    }
+};
+
+// Attempts-to-success histograms and failure counts per policy, shared by every device and
+// thread. Also owns the random source of the delay jitter, so tools can seed it.
+class RetryStats
+{
+public:
+    // Attempts beyond this are counted in the last bucket
+    static constexpr int MAX_TRACKED_ATTEMPTS = 8;
+
+    struct Entry
+    {
+        string policy;
+        // successes[n - 1]: operations that succeeded on attempt n
+        size_t successes[MAX_TRACKED_ATTEMPTS] = {};
+        size_t exhausted = 0;
+        size_t failures[FAILURE_CLASS_COUNT] = {};
+    };
+
+    static RetryStats &Instance()
+    {
+        static RetryStats instance;
+        return instance;
+    }
+
+    RetryStats(const RetryStats &) = delete;
+    RetryStats &operator=(const RetryStats &) = delete;
+
+    void Seed(uint32_t seed)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        random.seed(seed);
+    }
+
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.clear();
+    }
+
+    vector<Entry> Snapshot() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        vector<Entry> snapshot;
+        for (const auto &[policy, entry] : entries)
+        {
+            snapshot.push_back(entry);
+        }
+        return snapshot;
+    }
+
+    // "name  attempts 1:n 2:n ...  exhausted n  failures send:n get:n ..."; buckets and classes
+    // without a count are left out
+    static string Format(const Entry &entry)
+    {
+        std::ostringstream line;
+        line << entry.policy << "  attempts";
+        bool any = false;
+        for (int i = 0; i < MAX_TRACKED_ATTEMPTS; ++i)
+        {
+            if (entry.successes[i] > 0)
+            {
+                line << " " << i + 1 << (i + 1 == MAX_TRACKED_ATTEMPTS ? "+:" : ":") << entry.successes[i];
+                any = true;
+            }
+        }
+        line << (any ? "" : " none") << "  exhausted " << entry.exhausted << "  failures";
+        any = false;
+        for (size_t i = 0; i < FAILURE_CLASS_COUNT; ++i)
+        {
+            if (entry.failures[i] > 0)
+            {
+                line << " " << ToString(static_cast<FailureClass>(i)) << ":" << entry.failures[i];
+                any = true;
+            }
+        }
+        line << (any ? "" : " none");
+        return line.str();
+    }
+
+private:
+    friend class RetrySession;
+
+    mutable std::mutex mutex;
+    std::map<string, Entry> entries;
+    std::mt19937 random{std::random_device{}()};
+
+    RetryStats() = default;
+
+    Entry &EntryFor(const char *policy)
+    {
+        Entry &entry = entries[policy];
+        if (entry.policy.empty())
+        {
+            entry.policy = policy;
+        }
+        return entry;
+    }
+
+    void RecordFailure(const char *policy, FailureClass failure)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++EntryFor(policy).failures[static_cast<size_t>(failure)];
+    }
+
+    void RecordSuccess(const char *policy, int attempts)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++EntryFor(policy).successes[(std::min)(attempts, MAX_TRACKED_ATTEMPTS) - 1];
+    }
+
+    void RecordExhausted(const char *policy)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++EntryFor(policy).exhausted;
+    }
+
+    DWORD Jitter(DWORD delayMs)
+    {
+        if (delayMs == 0)
+        {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        std::uniform_real_distribution<double> factor(1.0 - RetryPolicy::JITTER, 1.0 + RetryPolicy::JITTER);
+        return static_cast<DWORD>(delayMs * factor(random) + 0.5);
+    }
+};
+
+// Attempt bookkeeping of one operation under a policy. The caller runs the attempts and waits the
+// returned delays itself (cancellable, on its own transport):
+//
+//   RetrySession retry(POLICY);
+//   for (;;)
+//   {
+//       if (ok) { retry.OnSuccess(); return result; }
+//       const auto delay = retry.OnFailure(failure);
+//       if (!delay || !device.Delay(*delay)) return {};
+//   }
+//
+// An operation abandoned without either call (a cancelled read) is not recorded.
+class RetrySession
+{
+public:
+    explicit RetrySession(const RetryPolicy &policy) : policy(&policy) {}
+
+    // 1-based number of the attempt in progress
+    int Attempt() const { return attempt; }
+    const RetryPolicy &Policy() const { return *policy; }
+
+    void OnSuccess()
+    {
+        RetryStats::Instance().RecordSuccess(policy->name, attempt);
+    }
+
+    // Records the failure of the current attempt. Returns the jittered delay before the next one,
+    // or nullopt when the failure's class has no budget left or the attempt limit is reached.
+    std::optional<DWORD> OnFailure(FailureClass failure)
+    {
+        RetryStats &stats = RetryStats::Instance();
+        stats.RecordFailure(policy->name, failure);
+
+        const RetryRule &rule = policy->Rule(failure);
+        int &used = retriesUsed[static_cast<size_t>(failure)];
+        if (used >= rule.budget || attempt >= policy->maxAttempts)
+        {
+            stats.RecordExhausted(policy->name);
+            return std::nullopt;
+        }
+
+        const DWORD delay = rule.doubling ? rule.delayMs << (std::min)(used, 8) : rule.delayMs;
+        ++used;
+        ++attempt;
+        return stats.Jitter(delay);
+    }
+
+private:
+    const RetryPolicy *policy;
+    int attempt = 1;
+    int retriesUsed[FAILURE_CLASS_COUNT] = {};
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+
+// Single-writer slot for a trivially copyable value. Readers never take a lock and never block
+// the writer: a read that overlaps a write sees an odd or changed sequence number and copies
+// again. The value is kept in atomic words, so a read racing a write is well defined and only
+// its result is discarded.
+template <typename T>
+class SeqlockSlot
+{
+    static_assert(std::is_trivially_copyable_v<T>, "SeqlockSlot needs a trivially copyable value");
+
+public:
+    SeqlockSlot()
+    {
+        Store(T{});
+    }
+
+    SeqlockSlot(const SeqlockSlot &) = delete;
+    SeqlockSlot &operator=(const SeqlockSlot &) = delete;
+
+    // Writer thread only
+    void Store(const T &value)
+    {
+        Word buffer[WORDS] = {};
+        std::memcpy(buffer, &value, sizeof(T));
+
+        const size_t sequence = version.load(std::memory_order_relaxed);
+        version.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; ++i)
+        {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        version.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Any thread
+    T Load() const
+    {
+        Word buffer[WORDS];
+        for (;;)
+        {
+            const size_t before = version.load(std::memory_order_acquire);
+            if (before & 1)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t i = 0; i < WORDS; ++i)
+            {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (version.load(std::memory_order_relaxed) == before)
+            {
+                break;
+            }
+        }
+
+        T value;
+        std::memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    // Number of completed stores
+    size_t Stores() const { return version.load(std::memory_order_acquire) / 2; }
+
+private:
+    // Pointer-sized words are lock-free on every target, 32-bit included
+    using Word = uintptr_t;
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(Word) - 1) / sizeof(Word);
+
+    std::atomic<size_t> version{0};
+    std::atomic<Word> words[WORDS];
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+#include <cstdint>
+
+// Learns, per product ID, how long a freshly opened handle needs before its first feature report
+// succeeds. Devices that answer straight away converge towards zero; a first transfer that fails
+// backs the settle time off again.
+class SettleTracker
+{
+public:
+    static constexpr uint32_t DEFAULT_SETTLE_MS = 100;
+    static constexpr uint32_t MIN_FAILURE_SETTLE_MS = 20;
+    static constexpr uint32_t MAX_SETTLE_MS = 500;
+
+    static SettleTracker &Instance()
+    {
+        static SettleTracker instance;
+        return instance;
+    }
+
+    SettleTracker(const SettleTracker &) = delete;
+    SettleTracker &operator=(const SettleTracker &) = delete;
+
+    uint32_t GetSettleMs(uint16_t pid)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = settleMs.find(pid);
+        return it != settleMs.end() ? it->second : DEFAULT_SETTLE_MS;
+    }
+
+    // Feeds back the outcome of the first transfer after Open()
+    void RecordFirstTransfer(uint16_t pid, bool success)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = settleMs.find(pid);
+        uint32_t current = it != settleMs.end() ? it->second : DEFAULT_SETTLE_MS;
+
+        if (success)
+        {
+            current = current * 3 / 4;
+        }
+        else
+        {
+            current = (std::min)((std::max)(current * 2, MIN_FAILURE_SETTLE_MS), MAX_SETTLE_MS);
+        }
+
+        settleMs[pid] = current;
+    }
+
+private:
+    SettleTracker() = default;
+
+    std::unordered_map<uint16_t, uint32_t> settleMs;
+    std::mutex mutex;
+};
@@ -0,0 +1,693 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include "core/hid_types.hpp"
+#include "core/hid_path.hpp"
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+using std::vector;
+using std::wstring;
+
+// Virtual time base for HIDSimTransport: protocol delays advance it instead of sleeping, so
+// latency distributions over thousands of reads are measured in milliseconds of wall time.
+struct HIDSimClock
+{
+    using duration = std::chrono::microseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<HIDSimClock>;
+    static constexpr bool is_steady = true;
+
+    static time_point now() { return time_point(duration(nowUs)); }
+
+    static void Advance(duration elapsed) { nowUs += elapsed.count(); }
+
+private:
+    static inline rep nowUs = 0;
+};
+
+// Timing parameters of the simulated Endgame Gear device (see docs/ENDGAME.md, "Timing")
+struct HIDSimModel
+{
+    uint32_t readyMinMs = 25;     // awake: command to valid response
+    uint32_t readyMaxMs = 70;
+    uint32_t wakeMinMs = 180;     // asleep: the first command wakes the radio link
+    uint32_t wakeMaxMs = 320;
+    uint32_t sleepAfterMs = 30000; // idle time after which the device is asleep
+    uint32_t transferUs = 1500;   // cost of one feature-report transfer
+    uint32_t openMs = 100;        // opening a handle, up to the collection answering
+};
+
+// Timing parameters of the simulated VAXEE dongle (see docs/VAXEE.md, "Command queue")
+struct HIDSimVaxeeModel
+{
+    uint32_t responseMinMs = 20;  // command to response, uniformly jittered
+    uint32_t responseMaxMs = 140;
+    uint32_t transferUs = 1500;
+    uint32_t openMs = 100;
+};
+
+// The rest of the HID tree an enumeration pass walks besides the simulated device: keyboards,
+// headsets, hubs and virtual devices. Walking an interface (SetupDiEnumDeviceInterfaces plus its
+// detail) and querying one (open, attributes, caps) cost virtual time; the costs are modelling
+// assumptions, not measurements. The default is an otherwise empty tree that enumerates for free.
+struct HIDSimEnumerationModel
+{
+    size_t otherInterfaces = 0;
+    uint32_t walkUs = 0;
+    uint32_t queryUs = 0;
+};
+
+// How the simulated device comes up after Open, for battery_sim --first-read. It answers feature
+// reports only answerMin..answerMaxMs after the handle opened; earlier calls fail, as assumed by
+// SettleTracker. Open then either probes it the way HIDDevice does (a feature read every
+// PROBE_INTERVAL_MS until one is answered, for at most PROBE_DEADLINE_MS) or leaves settleMs to
+// be waited before the first transfer; a probe that runs out of time falls back to the settle
+// time. The default device answers as soon as Open returns.
+struct HIDSimOpenModel
+{
+    uint32_t answerMinMs = 0;
+    uint32_t answerMaxMs = 0;
+    bool probe = false;
+    uint32_t settleMs = 0;
+};
+
+// Simulated device selected with MBM_HID_SIM (see battery_sim), either of:
+//  - an Endgame Gear dongle. It answers the battery command after a model-driven delay; before
+//    that, Get returns a status byte of 0x00. After waking from sleep, the first response reports
+//    a stale level of 0, which is why the protocol discards it.
+//  - a VAXEE dongle. Each command is answered after a jittered delay into a single response slot;
+//    until then Get returns whatever answer the slot held before, echo included.
+class HIDSimTransport
+{
+public:
+    using Clock = HIDSimClock;
+
+    enum class Device
+    {
+        EndgameGear,
+        Vaxee
+    };
+
+    static constexpr USHORT SIM_VID = 0x3367;
+    static constexpr USHORT SIM_PID = 0x1970;
+    static constexpr BYTE SIM_BATTERY = 73;
+
+    static constexpr USHORT SIM_VAXEE_VID = 0x3057;
+    static constexpr USHORT SIM_VAXEE_PID = 0x1001;
+    static constexpr USHORT SIM_VAXEE_CABLE_PID = 0x1003;
+    static constexpr BYTE SIM_VAXEE_LEVEL = 15; // 75 %, until SetVaxeeLevel
+    static inline const wstring SIM_VAXEE_CABLE_PATH = L"sim://vaxee-cable";
+
+    HIDSimTransport() = default;
+
+    HIDSimTransport(const HIDSimTransport &) = delete;
+    HIDSimTransport &operator=(const HIDSimTransport &) = delete;
+
+    static void SetModel(const HIDSimModel &simModel, uint32_t seed)
+    {
+        simDevice = Device::EndgameGear;
+        model = simModel;
+        Reset(seed);
+    }
+
+    static void SetVaxeeModel(const HIDSimVaxeeModel &simModel, uint32_t seed)
+    {
+        simDevice = Device::Vaxee;
+        vaxeeModel = simModel;
+        Reset(seed);
+    }
+
+    // Battery percentage the simulated device reports when read correctly
+    static int ExpectedBattery()
+    {
+        return simDevice == Device::Vaxee ? vaxeeLevel * 5 : SIM_BATTERY;
+    }
+
+    // VAXEE battery level (0-20) answered from now on. Changing it between reads makes an old
+    // battery answer taken for a new one show up as a wrong level.
+    static void SetVaxeeLevel(BYTE level)
+    {
+        vaxeeLevel = level;
+    }
+
+    // VAXEE charging flag reported from now on; a real cable change would also raise a device arrival
+    static void SetVaxeeCharging(bool charging)
+    {
+        vaxeeCharging = charging;
+    }
+
+    static bool ExpectedCharging()
+    {
+        return simDevice == Device::Vaxee && vaxeeCharging;
+    }
+
+    // Feature reports sent since the model was set
+    static size_t GetSendCount() { return sendCount; }
+
+    // Endgame Gear: with the mouse switched off the dongle still opens and takes commands, but
+    // never reports a battery level
+    static void SetMouseOn(bool on)
+    {
+        mouseOn = on;
+    }
+
+    // Handles opened and enumeration passes since the model was set
+    static size_t GetOpenCount() { return openCount; }
+    static size_t GetScanCount() { return scanCount; }
+
+    static void SetOpenModel(const HIDSimOpenModel &simOpenModel)
+    {
+        openModel = simOpenModel;
+    }
+
+    // Input reports: with injection on, ReadInputReport waits in wall time, up to its timeout, for
+    // reports queued by InjectInputReport from any thread. Off (the default), it fails at once as
+    // on a collection without input reports, so listeners end right away.
+    static void EnableInputInjection(bool enabled)
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        inputInjection = enabled;
+        inputQueue.clear();
+        ioWake.notify_all();
+    }
+
+    // Wedges the report pipe of every handle open now, as a stalled firmware does: each feature
+    // call blocks in wall time until the deadline (a timeout) or Cancel(), like HIDDevice's
+    // overlapped calls. Handles opened afterwards, such as a recycled one, are not affected.
+    static void StallOpenHandles(std::chrono::milliseconds deadline)
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        stallDeadline = deadline;
+        ++stallEpoch;
+    }
+
+    static void InjectInputReport(vector<BYTE> report)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ioMutex);
+            inputQueue.push_back(std::move(report));
+        }
+        ioWake.notify_all();
+    }
+
+    // Wall-clock time every open and feature-report call blocks for, on top of the virtual time
+    // the model charges; lets battery_sim check that the engine thread's callers never wait on HID
+    static void SetCallLatency(std::chrono::microseconds latency)
+    {
+        callLatency = latency;
+    }
+
+    // Idle time between reads
+    static void Advance(std::chrono::milliseconds idle)
+    {
+        Clock::Advance(idle);
+    }
+
+    // Builds the other interfaces every enumeration walks; kept across SetModel calls. One in
+    // OWN_VENDOR_EVERY is a non-battery collection (mouse, consumer control) of a supported
+    // vendor, one in VIRTUAL_EVERY has a path naming no vendor, so only a query rejects it.
+    static void SetEnumerationModel(const HIDSimEnumerationModel &enumerationModel)
+    {
+        static constexpr USHORT FOREIGN_VIDS[] = {0x046D, 0x1532, 0x045E, 0x0B05, 0x8087, 0x1B1C};
+        static constexpr size_t OWN_VENDOR_EVERY = 10;
+        static constexpr size_t VIRTUAL_EVERY = 25;
+
+        enumeration = enumerationModel;
+        otherInterfaces.clear();
+        for (size_t i = 0; i < enumeration.otherInterfaces; ++i)
+        {
+            DeviceInfo info;
+            const bool ownVendor = i % OWN_VENDOR_EVERY == OWN_VENDOR_EVERY - 1;
+            info.vid = ownVendor ? (i % 2 ? SIM_VID : SIM_VAXEE_VID) : FOREIGN_VIDS[i % std::size(FOREIGN_VIDS)];
+            info.pid = ownVendor ? (i % 2 ? SIM_PID : SIM_VAXEE_PID) : static_cast<USHORT>(0xC000 + i);
+            info.usagePage = i % 3 == 0 ? 0x000C : 0x0001;
+            info.usage = i % 3 == 0 ? 0x0001 : 0x0002;
+            const int collection = static_cast<int>(i % 4) + 1;
+            if (i % VIRTUAL_EVERY == VIRTUAL_EVERY - 1)
+            {
+                info.path = L"\\\\?\\hid#vhf&col0" + std::to_wstring(collection) + L"#1&2d595ca7&" +
+                            std::to_wstring(i) + L"&0000#{4d1e55b2-f16f-11cf-88cb-001111000030}";
+            }
+            else
+            {
+                info.path = L"\\\\?\\hid#vid_" + Hex4(info.vid) + L"&pid_" + Hex4(info.pid) + L"&mi_0" +
+                            std::to_wstring(i % 3) + L"&col0" + std::to_wstring(collection) + L"#8&1f2e" +
+                            std::to_wstring(i) + L"&0&0000#{4d1e55b2-f16f-11cf-88cb-001111000030}";
+            }
+            otherInterfaces.push_back(std::move(info));
+        }
+    }
+
+    // false unplugs the simulated dongle: enumeration no longer lists it and it cannot be opened
+    static void SetDevicePresent(bool present)
+    {
+        devicePresent = present;
+    }
+
+    // Interfaces opened to read their attributes, and virtual time spent walking and querying
+    static size_t GetQueryCount() { return queryCount; }
+    static Clock::duration GetEnumerationTime() { return enumerationTime; }
+
+    static vector<DeviceInfo> EnumerateDevices(const vector<USHORT> &vendorIds, HIDScanStats &stats)
+    {
+        return Walk(vendorIds, stats, true);
+    }
+
+    // One pass over the tree as HIDDevice::EnumerateDevices makes it: paths naming a foreign
+    // vendor are skipped, every other interface is queried. pathFilter false queries every
+    // interface, as enumeration did before the path prefilter.
+    static vector<DeviceInfo> Walk(const vector<USHORT> &vendorIds, HIDScanStats &stats, bool pathFilter)
+    {
+        stats = {};
+        ++scanCount;
+        vector<DeviceInfo> found;
+        auto visit = [&](const DeviceInfo &info)
+        {
+            ++stats.interfaces;
+            Charge(enumeration.walkUs);
+            const bool supported = std::find(vendorIds.begin(), vendorIds.end(), info.vid) != vendorIds.end();
+            if (pathFilter && HIDPath::Parse(info.path) && !supported)
+            {
+                ++stats.skippedByPath;
+                return;
+            }
+            ++stats.opened;
+            ++queryCount;
+            Charge(enumeration.queryUs);
+            if (supported)
+            {
+                found.push_back(info);
+            }
+        };
+        for (const auto &info : otherInterfaces)
+        {
+            visit(info);
+        }
+        if (devicePresent)
+        {
+            visit(SimInfo());
+        }
+        return found;
+    }
+
+    static vector<DeviceInfo> QueryDevice(const wstring &path, const vector<USHORT> &vendorIds)
+    {
+        // The VAXEE mouse interface that appears while a charging cable is plugged in
+        if (simDevice == Device::Vaxee && path == SIM_VAXEE_CABLE_PATH)
+        {
+            return {DeviceInfo{SIM_VAXEE_CABLE_PATH, SIM_VAXEE_VID, SIM_VAXEE_CABLE_PID, 0xFF05, 0x0001}};
+        }
+
+        const DeviceInfo info = SimInfo();
+        if (!devicePresent || path != info.path || std::find(vendorIds.begin(), vendorIds.end(), info.vid) == vendorIds.end())
+        {
+            return {};
+        }
+        return {info};
+    }
+
+    bool Open(const DeviceInfo &info)
+    {
+        // The cable interface reaches the same simulated mouse as the dongle
+        Block();
+        cancelled = false;
+        timeoutCount = 0;
+        {
+            std::lock_guard<std::mutex> lock(ioMutex);
+            openEpoch = stallEpoch;
+        }
+        open = (devicePresent && info.path == SimInfo().path) ||
+               (simDevice == Device::Vaxee && info.path == SIM_VAXEE_CABLE_PATH);
+        if (open)
+        {
+            ++openCount;
+            Clock::Advance(std::chrono::milliseconds(simDevice == Device::Vaxee ? vaxeeModel.openMs : model.openMs));
+            ComeUp();
+        }
+        return open;
+    }
+
+    void Close()
+    {
+        open = false;
+        ioWake.notify_all();
+    }
+
+    bool IsOpen() const { return open; }
+
+    bool SendFeatureReport(const BYTE *buffer, DWORD size) const
+    {
+        ++sendCount;
+        Block();
+        if (!Answering())
+        {
+            return false;
+        }
+        if (simDevice == Device::Vaxee)
+        {
+            return SendVaxee(buffer, size);
+        }
+
+        Clock::Advance(std::chrono::microseconds(model.transferUs));
+        if (!open || size < 2)
+        {
+            return false;
+        }
+
+        const auto now = Clock::now();
+        const bool asleep = lastActivity == Clock::time_point::min() ||
+                            now - lastActivity > std::chrono::milliseconds(model.sleepAfterMs);
+        const uint32_t delayMs = asleep ? Uniform(model.wakeMinMs, model.wakeMaxMs)
+                                        : Uniform(model.readyMinMs, model.readyMaxMs);
+        readyAt = now + std::chrono::milliseconds(delayMs);
+        staleResponse = asleep;
+        lastActivity = now;
+        return buffer[1] == 0xB4;
+    }
+
+    bool GetFeatureReport(BYTE reportId, BYTE *buffer, DWORD size) const
+    {
+        Block();
+        if (!Answering())
+        {
+            return false;
+        }
+        if (simDevice == Device::Vaxee)
+        {
+            return GetVaxee(reportId, buffer, size);
+        }
+
+        Clock::Advance(std::chrono::microseconds(model.transferUs));
+        if (!open || size <= 16)
+        {
+            return false;
+        }
+
+        std::fill(buffer, buffer + size, BYTE{0});
+        buffer[0] = reportId;
+
+        const auto now = Clock::now();
+        lastActivity = now;
+        if (now < readyAt || !mouseOn)
+        {
+            return true;
+        }
+
+        buffer[1] = 0x01;
+        buffer[16] = staleResponse ? 0 : SIM_BATTERY;
+        return true;
+    }
+
+    bool ReadInputReport(BYTE *buffer, DWORD size, DWORD timeoutMs, DWORD &bytesRead) const
+    {
+        bytesRead = 0;
+        std::unique_lock<std::mutex> lock(ioMutex);
+        if (!inputInjection)
+        {
+            return false;
+        }
+        ioWake.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+                            { return cancelled || !open || !inputQueue.empty(); });
+        if (cancelled || !open)
+        {
+            return false;
+        }
+        if (inputQueue.empty())
+        {
+            return true;
+        }
+
+        const vector<BYTE> report = std::move(inputQueue.front());
+        inputQueue.pop_front();
+        bytesRead = static_cast<DWORD>((std::min)(static_cast<size_t>(size), report.size()));
+        std::copy_n(report.begin(), bytesRead, buffer);
+        return true;
+    }
+
+    HIDIoResult GetLastIoResult() const { return lastIoResult; }
+    size_t GetTimeoutCount() const { return timeoutCount; }
+
+    bool Delay(DWORD milliseconds) const
+    {
+        Clock::Advance(std::chrono::milliseconds(milliseconds));
+        return true;
+    }
+
+    // Only a waiting input-report read has anything to abort; feature calls do not block
+    void Cancel() const
+    {
+        {
+            std::lock_guard<std::mutex> lock(ioMutex);
+            cancelled = true;
+        }
+        ioWake.notify_all();
+    }
+
+    void ResetCancel() const { cancelled = false; }
+
+    USHORT GetVID() const { return SimInfo().vid; }
+    USHORT GetPID() const { return SimInfo().pid; }
+
+private:
+    static inline const wstring SIM_PATH = L"sim://endgame-dongle";
+    static inline const wstring SIM_VAXEE_PATH = L"sim://vaxee-dongle";
+    static inline Device simDevice = Device::EndgameGear;
+    static inline HIDSimModel model;
+    static inline HIDSimVaxeeModel vaxeeModel;
+    static inline std::mt19937 random{1};
+    static inline size_t sendCount = 0;
+    static inline Clock::time_point lastActivity = Clock::time_point::min();
+    static inline Clock::time_point readyAt;
+    static inline bool staleResponse = false;
+    // VAXEE: command in progress (0 = none) and the response slot (echo, value)
+    static inline BYTE pendingCmd = 0;
+    static inline BYTE slotCmd = 0;
+    static inline BYTE slotValue = 0;
+    static inline bool vaxeeCharging = false;
+    static inline BYTE vaxeeLevel = SIM_VAXEE_LEVEL;
+    static inline bool mouseOn = true;
+    static inline size_t openCount = 0;
+    static inline size_t scanCount = 0;
+    static inline HIDSimEnumerationModel enumeration;
+    static inline vector<DeviceInfo> otherInterfaces;
+    static inline size_t queryCount = 0;
+    static inline bool devicePresent = true;
+    static inline Clock::duration enumerationTime{0};
+    static inline std::chrono::microseconds callLatency{0};
+    static inline HIDSimOpenModel openModel;
+    static inline std::mutex ioMutex;
+    static inline std::condition_variable ioWake;
+    static inline std::deque<vector<BYTE>> inputQueue;
+    static inline bool inputInjection = false;
+    static inline size_t stallEpoch = 0;
+    static inline std::chrono::milliseconds stallDeadline{0};
+
+    static constexpr uint32_t PROBE_INTERVAL_MS = 5;
+    static constexpr uint32_t PROBE_DEADLINE_MS = 100;
+
+    // Atomic: an input-report read on a listener thread waits on these
+    std::atomic<bool> open{false};
+    mutable std::atomic<bool> cancelled{false};
+    // Open model: when the device answers, and until when the first transfer waits
+    mutable Clock::time_point answerAt = Clock::time_point::min();
+    mutable Clock::time_point settleUntil = Clock::time_point::min();
+    mutable HIDIoResult lastIoResult = HIDIoResult::Ok;
+    mutable size_t timeoutCount = 0;
+    // Handles opened before the last StallOpenHandles are wedged
+    size_t openEpoch = 0;
+
+    static DeviceInfo SimInfo()
+    {
+        if (simDevice == Device::Vaxee)
+        {
+            return DeviceInfo{SIM_VAXEE_PATH, SIM_VAXEE_VID, SIM_VAXEE_PID, 0xFF05, 0x0001};
+        }
+        return DeviceInfo{SIM_PATH, SIM_VID, SIM_PID, 0xFF01, 0x0002};
+    }
+
+    static void Reset(uint32_t seed)
+    {
+        random.seed(seed);
+        sendCount = 0;
+        lastActivity = Clock::time_point::min();
+        pendingCmd = 0;
+        slotCmd = 0;
+        slotValue = 0;
+        vaxeeCharging = false;
+        vaxeeLevel = SIM_VAXEE_LEVEL;
+        mouseOn = true;
+        openCount = 0;
+        scanCount = 0;
+        queryCount = 0;
+        enumerationTime = {};
+        devicePresent = true;
+        callLatency = {};
+        openModel = {};
+    }
+
+    static void Charge(uint32_t microseconds)
+    {
+        Clock::Advance(std::chrono::microseconds(microseconds));
+        enumerationTime += std::chrono::microseconds(microseconds);
+    }
+
+    uint32_t TransferUs() const
+    {
+        return simDevice == Device::Vaxee ? vaxeeModel.transferUs : model.transferUs;
+    }
+
+    // Applies the open model to a handle that was just opened
+    void ComeUp()
+    {
+        const auto openedAt = Clock::now();
+        answerAt = openModel.answerMaxMs > 0
+                       ? openedAt + std::chrono::milliseconds(Uniform(openModel.answerMinMs, openModel.answerMaxMs))
+                       : openedAt;
+        settleUntil = openedAt + std::chrono::milliseconds(openModel.settleMs);
+        if (!openModel.probe)
+        {
+            return;
+        }
+
+        const auto deadline = openedAt + std::chrono::milliseconds(PROBE_DEADLINE_MS);
+        for (;;)
+        {
+            Clock::Advance(std::chrono::microseconds(TransferUs()));
+            if (Clock::now() >= answerAt)
+            {
+                settleUntil = Clock::time_point::min();
+                return;
+            }
+            if (Clock::now() >= deadline)
+            {
+                return;
+            }
+            Clock::Advance(std::chrono::milliseconds(PROBE_INTERVAL_MS));
+        }
+    }
+
+    // Waits out a pending settle time; false on a wedged handle, and after the cost of a failed
+    // transfer while the device has not come up since Open
+    bool Answering() const
+    {
+        lastIoResult = HIDIoResult::Ok;
+        if (Wedged())
+        {
+            return false;
+        }
+        if (Clock::now() < settleUntil)
+        {
+            Clock::Advance(settleUntil - Clock::now());
+        }
+        if (Clock::now() >= answerAt)
+        {
+            return true;
+        }
+        Clock::Advance(std::chrono::microseconds(TransferUs()));
+        lastIoResult = HIDIoResult::Error;
+        return false;
+    }
+
+    // On a wedged handle, blocks the call until its deadline or Cancel() and returns true
+    bool Wedged() const
+    {
+        std::unique_lock<std::mutex> lock(ioMutex);
+        if (openEpoch == stallEpoch)
+        {
+            return false;
+        }
+        const auto deadline = stallDeadline;
+        const bool woken = ioWake.wait_for(lock, deadline, [this]
+                                           { return cancelled.load() || !open; });
+        lock.unlock();
+        if (woken)
+        {
+            lastIoResult = HIDIoResult::Cancelled;
+            return true;
+        }
+        Clock::Advance(deadline);
+        lastIoResult = HIDIoResult::Timeout;
+        ++timeoutCount;
+        return true;
+    }
+
+    static void Block()
+    {
+        if (callLatency.count() > 0)
+        {
+            std::this_thread::sleep_for(callLatency);
+        }
+    }
+
+    static wstring Hex4(USHORT value)
+    {
+        static constexpr wchar_t DIGITS[] = L"0123456789abcdef";
+        wstring text(4, L'0');
+        for (int i = 3; i >= 0; --i, value >>= 4)
+        {
+            text[i] = DIGITS[value & 0xF];
+        }
+        return text;
+    }
+
+    bool SendVaxee(const BYTE *buffer, DWORD size) const
+    {
+        Clock::Advance(std::chrono::microseconds(vaxeeModel.transferUs));
+        if (!open || size < 5 || buffer[1] != 0xA5)
+        {
+            return false;
+        }
+
+        // A new command replaces one still in progress
+        pendingCmd = buffer[2];
+        readyAt = Clock::now() + std::chrono::milliseconds(Uniform(vaxeeModel.responseMinMs, vaxeeModel.responseMaxMs));
+        return true;
+    }
+
+    bool GetVaxee(BYTE reportId, BYTE *buffer, DWORD size) const
+    {
+        Clock::Advance(std::chrono::microseconds(vaxeeModel.transferUs));
+        if (!open || size < 6)
+        {
+            return false;
+        }
+
+        if (pendingCmd != 0 && Clock::now() >= readyAt)
+        {
+            slotCmd = pendingCmd;
+            // Other commands than battery level and charging status answer with their cmd_id
+            slotValue = pendingCmd == 0x0B   ? vaxeeLevel
+                        : pendingCmd == 0x10 ? static_cast<BYTE>(vaxeeCharging ? 1 : 0)
+                                             : pendingCmd;
+            pendingCmd = 0;
+        }
+
+        std::fill(buffer, buffer + size, BYTE{0});
+        buffer[0] = reportId;
+        if (slotCmd != 0)
+        {
+            buffer[1] = 0xA5;
+            buffer[2] = slotCmd;
+            buffer[3] = 0x01;
+            buffer[4] = 0x01;
+            buffer[5] = slotValue;
+        }
+        return true;
+    }
+
+    static uint32_t Uniform(uint32_t low, uint32_t high)
+    {
+        return std::uniform_int_distribution<uint32_t>(low, high)(random);
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+
+using std::string;
+
+// Small persistent key/value store for protocol timings learned at runtime, so a restart does not
+// have to relearn them. Same "key = value" format as config.ini. Without Load() values are kept
+// in memory only. A value is written back once it moved SAVE_THRESHOLD_MS from the saved one;
+// Flush() writes the rest.
+class TimingStore
+{
+public:
+    static TimingStore &Instance()
+    {
+        static TimingStore instance;
+        return instance;
+    }
+
+    TimingStore(const TimingStore &) = delete;
+    TimingStore &operator=(const TimingStore &) = delete;
+
+    static constexpr uint32_t SAVE_THRESHOLD_MS = 4;
+
+    // Reads the file if it exists and saves later changes back to it
+    void Load(const string &filename)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        path = filename;
+
+        std::ifstream file(filename);
+        string line;
+        while (std::getline(file, line))
+        {
+            const size_t pos = line.find('=');
+            if (line.empty() || line[0] == '#' || pos == string::npos)
+            {
+                continue;
+            }
+
+            try
+            {
+                values[Trim(line.substr(0, pos))] = static_cast<uint32_t>(std::stoul(line.substr(pos + 1)));
+            }
+            catch (const std::exception &)
+            {
+                // Ignore malformed lines; the value is simply relearned
+            }
+        }
+        saved = values;
+    }
+
+    std::optional<uint32_t> Get(const string &key) const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = values.find(key);
+        if (it == values.end())
+        {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    void Set(const string &key, uint32_t value)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = values.find(key);
+        if (it != values.end() && it->second == value)
+        {
+            return;
+        }
+
+        values[key] = value;
+        auto last = saved.find(key);
+        if (last == saved.end() || (std::max)(last->second, value) - (std::min)(last->second, value) >= SAVE_THRESHOLD_MS)
+        {
+            Save();
+        }
+    }
+
+    // Writes changes still below the threshold; called at shutdown
+    void Flush()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (values != saved)
+        {
+            Save();
+        }
+    }
+
+private:
+    TimingStore() = default;
+
+    std::map<string, uint32_t> values;
+    // As last written to the file
+    std::map<string, uint32_t> saved;
+    string path;
+    mutable std::mutex mutex;
+
+    void Save()
+    {
+        saved = values;
+        if (path.empty())
+        {
+            return;
+        }
+
+        std::ofstream file(path, std::ios::trunc);
+        file << "# Learned device timings (milliseconds); safe to delete\n";
+        for (const auto &entry : values)
+        {
+            file << entry.first << " = " << entry.second << "\n";
+        }
+    }
+
+    static string Trim(const string &str)
+    {
+        const auto start = str.find_first_not_of(" \t");
+        if (start == string::npos)
+        {
+            return "";
+        }
+        const auto end = str.find_last_not_of(" \t");
+        return str.substr(start, end - start + 1);
+    }
+};
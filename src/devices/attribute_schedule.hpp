@@ -0,0 +1,82 @@
+#pragma once
+
+#include "devices/mouse_device.hpp"
+#include "core/hid_transport.hpp"
+#include <map>
+#include <chrono>
+#include <cstdint>
+
+// Decides which cached device attributes a read has to fetch again. An attribute is due when it
+// has never been read, its TTL has passed, or one of its invalidation triggers fired since the
+// last read. A TTL of zero makes it due on every read.
+class AttributeSchedule
+{
+public:
+    using Clock = HIDTransport::Clock;
+    using Trigger = MouseDevice::InvalidationTrigger;
+
+    static constexpr unsigned TriggerBit(Trigger trigger)
+    {
+        return 1u << static_cast<unsigned>(trigger);
+    }
+
+    // triggers: TriggerBit() values or'ed together
+    void Define(uint32_t key, std::chrono::milliseconds ttl, unsigned triggers = 0)
+    {
+        Entry &entry = entries[key];
+        entry.ttl = ttl;
+        entry.triggers = triggers;
+    }
+
+    bool IsDue(uint32_t key, Clock::time_point now) const
+    {
+        auto it = entries.find(key);
+        if (it == entries.end() || !it->second.valid)
+        {
+            return true;
+        }
+        return now - it->second.readAt >= it->second.ttl;
+    }
+
+    void MarkRead(uint32_t key, Clock::time_point now)
+    {
+        Entry &entry = entries[key];
+        entry.readAt = now;
+        entry.valid = true;
+    }
+
+    // Returns the number of attributes that became due
+    size_t Invalidate(Trigger trigger)
+    {
+        size_t invalidated = 0;
+        for (auto &[key, entry] : entries)
+        {
+            if (entry.valid && (entry.triggers & TriggerBit(trigger)))
+            {
+                entry.valid = false;
+                ++invalidated;
+            }
+        }
+        return invalidated;
+    }
+
+    // Forgets every read (definitions stay), e.g. when the device disconnects
+    void Reset()
+    {
+        for (auto &[key, entry] : entries)
+        {
+            entry.valid = false;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        std::chrono::milliseconds ttl{0};
+        unsigned triggers = 0;
+        Clock::time_point readAt{};
+        bool valid = false;
+    };
+
+    std::map<uint32_t, Entry> entries;
+};
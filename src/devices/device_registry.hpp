@@ -0,0 +1,172 @@
+#pragma once
+
+#include "devices/device_table.hpp"
+#include <tuple>
+#include <array>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cstddef>
+
+// Vendor families compiled into the build. Define MBM_NO_ENDGAME_GEAR or MBM_NO_VAXEE (the
+// Makefile's VENDORS option does this) to leave a family out: its classes are not instantiated
+// and its vendor ID is not probed during enumeration.
+#ifndef MBM_NO_ENDGAME_GEAR
+#include "devices/endgame_gear_mouse.hpp"
+#include "devices/endgame_gear_dongle.hpp"
+#endif
+#ifndef MBM_NO_VAXEE
+#include "devices/vaxee_mouse.hpp"
+#include "devices/vaxee_dongle.hpp"
+#endif
+
+template <typename... Devices>
+struct DeviceList
+{
+};
+
+template <typename... Lists>
+struct ConcatDeviceLists
+{
+    using type = DeviceList<>;
+};
+
+template <typename... A>
+struct ConcatDeviceLists<DeviceList<A...>>
+{
+    using type = DeviceList<A...>;
+};
+
+template <typename... A, typename... B, typename... Rest>
+struct ConcatDeviceLists<DeviceList<A...>, DeviceList<B...>, Rest...>
+{
+    using type = typename ConcatDeviceLists<DeviceList<A..., B...>, Rest...>::type;
+};
+
+#ifndef MBM_NO_ENDGAME_GEAR
+using EndgameGearFamily = DeviceList<EndgameGearMouse, EndgameGearDongle>;
+#else
+using EndgameGearFamily = DeviceList<>;
+#endif
+#ifndef MBM_NO_VAXEE
+using VaxeeFamily = DeviceList<VaxeeMouse, VaxeeDongle>;
+#else
+using VaxeeFamily = DeviceList<>;
+#endif
+
+// Every device class the build supports, one entry per vendor family
+using RegisteredDevices = typename ConcatDeviceLists<EndgameGearFamily, VaxeeFamily>::type;
+
+// Holds one instance of each registered device class in a tuple and dispatches to them by slot
+// (tuple position) without going through MouseDevice's vtable. Each class declares FAMILY and
+// KIND; its priority comes from the device table, and the probe order is sorted at compile time.
+template <typename List>
+class DeviceRegistry;
+
+template <typename... Devices>
+class DeviceRegistry<DeviceList<Devices...>>
+{
+public:
+    static_assert(sizeof...(Devices) > 0, "At least one vendor family must be compiled in");
+
+    static constexpr size_t COUNT = sizeof...(Devices);
+    // Slot value meaning "no device"
+    static constexpr size_t NONE = COUNT;
+
+    static constexpr std::array<int, COUNT> PRIORITIES = {
+        DeviceTable::GroupPriority(Devices::FAMILY, Devices::KIND)...};
+    static constexpr std::array<USHORT, COUNT> VIDS = {Devices::VID...};
+
+    // Slots by ascending priority; registration order breaks ties
+    static constexpr std::array<size_t, COUNT> ORDER = []
+    {
+        std::array<size_t, COUNT> order{};
+        for (size_t i = 0; i < COUNT; ++i)
+        {
+            size_t j = i;
+            for (; j > 0 && PRIORITIES[order[j - 1]] > PRIORITIES[i]; --j)
+            {
+                order[j] = order[j - 1];
+            }
+            order[j] = i;
+        }
+        return order;
+    }();
+
+    static constexpr int BEST_PRIORITY = PRIORITIES[ORDER[0]];
+
+    static int Priority(size_t slot) { return PRIORITIES[slot]; }
+
+    // Distinct vendor IDs of the registered classes, for the enumeration pass
+    static std::vector<USHORT> VendorIds()
+    {
+        std::vector<USHORT> vendors;
+        for (USHORT vid : VIDS)
+        {
+            if (std::find(vendors.begin(), vendors.end(), vid) == vendors.end())
+            {
+                vendors.push_back(vid);
+            }
+        }
+        return vendors;
+    }
+
+    // Calls f(device, slot) in probe order until it returns true; returns that slot or NONE
+    template <typename F>
+    size_t FindFirst(F &&f)
+    {
+        return FindFirstIn(f, std::make_index_sequence<COUNT>{});
+    }
+
+    template <typename F>
+    void ForEach(F &&f)
+    {
+        std::apply([&f](auto &...device)
+                   { (f(device), ...); },
+                   devices);
+    }
+
+    // Calls f with the device in slot; slot must not be NONE. Non-void results must be
+    // default-constructible.
+    template <typename F>
+    auto Visit(size_t slot, F &&f)
+    {
+        return VisitIn(devices, slot, f, std::make_index_sequence<COUNT>{});
+    }
+
+    template <typename F>
+    auto Visit(size_t slot, F &&f) const
+    {
+        return VisitIn(devices, slot, f, std::make_index_sequence<COUNT>{});
+    }
+
+private:
+    std::tuple<Devices...> devices;
+
+    template <typename F, size_t... I>
+    size_t FindFirstIn(F &f, std::index_sequence<I...>)
+    {
+        size_t found = NONE;
+        (void)((f(std::get<ORDER[I]>(devices), ORDER[I]) && (found = ORDER[I], true)) || ...);
+        return found;
+    }
+
+    template <typename Tuple, typename F, size_t... I>
+    static auto VisitIn(Tuple &tuple, size_t slot, F &f, std::index_sequence<I...>)
+    {
+        using Result = std::invoke_result_t<F &, decltype(std::get<0>(tuple))>;
+        if constexpr (std::is_void_v<Result>)
+        {
+            (void)((slot == I && (f(std::get<I>(tuple)), true)) || ...);
+        }
+        else
+        {
+            Result result{};
+            (void)((slot == I && (result = f(std::get<I>(tuple)), true)) || ...);
+            return result;
+        }
+    }
+};
+
+using RegisteredDeviceSet = DeviceRegistry<RegisteredDevices>;
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "core/platform.hpp"
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+enum class DeviceFamily : BYTE
+{
+    EndgameGear,
+    Vaxee
+};
+
+enum class DeviceKind : BYTE
+{
+    Mouse,
+    Dongle
+};
+
+// Everything the device classes need to know about one supported product
+struct DeviceDescriptor
+{
+    USHORT vid;
+    USHORT pid;
+    const wchar_t *name;
+    DeviceFamily family;
+    DeviceKind kind;
+    bool wired;       // connected by cable, so it charges while in use
+    int priority;     // lower wins when several supported devices are attached
+    USHORT usagePage; // vendor collection carrying the battery reports
+    USHORT usage;
+    BYTE reportId;
+    BYTE levelOffset; // response byte holding the battery level
+    BYTE levelScale;  // percent per level unit
+};
+
+constexpr DeviceDescriptor EndgameGearDescriptor(USHORT pid, const wchar_t *name, DeviceKind kind, bool wired,
+                                                 int priority)
+{
+    return {0x3367, pid, name, DeviceFamily::EndgameGear, kind, wired, priority, 0xFF01, 0x0002, 0xA1, 16, 1};
+}
+
+constexpr DeviceDescriptor VaxeeDescriptor(USHORT pid, const wchar_t *name, DeviceKind kind, bool wired,
+                                           int priority)
+{
+    return {0x3057, pid, name, DeviceFamily::Vaxee, kind, wired, priority, 0xFF05, 0x0001, 0x0E, 5, 5};
+}
+
+// Every supported device. Rows of one family and kind are served by one device class and must
+// share its priority.
+inline constexpr DeviceDescriptor DEVICE_DESCRIPTORS[] = {
+    EndgameGearDescriptor(0x1972, L"OP1W", DeviceKind::Mouse, true, 1),
+    EndgameGearDescriptor(0x1982, L"XM2W v2", DeviceKind::Mouse, true, 1),
+    EndgameGearDescriptor(0x1970, L"Endgame Gear Dongle", DeviceKind::Dongle, false, 3),
+
+    VaxeeDescriptor(0x1003, L"VAXEE XE Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1004, L"ZYGEN NP-01S Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1005, L"VAXEE AX Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1006, L"ZYGEN NP-01 Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1007, L"VAXEE XE-S Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1008, L"VAXEE XE-S-L Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1009, L"VAXEE x NINJUTSO Sora Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1010, L"VAXEE E1 Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1011, L"ZYGEN NP-01S V2 Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1012, L"VAXEE XE V2 Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1013, L"ZYGEN NP-01S Ergo Wireless", DeviceKind::Mouse, true, 4),
+    VaxeeDescriptor(0x1001, L"VAXEE Dongle", DeviceKind::Dongle, false, 5),
+    VaxeeDescriptor(0x1002, L"VAXEE 4K Dongle", DeviceKind::Dongle, false, 5),
+    VaxeeDescriptor(0x0005, L"VAXEE Dongle", DeviceKind::Dongle, false, 5),
+    VaxeeDescriptor(0x2001, L"VAXEE 4K Dongle (Dual-track)", DeviceKind::Dongle, false, 5),
+};
+
+// Multiplicative hash of (VID << 16 | PID) into SLOT_COUNT slots. The multiplier is searched at
+// compile time until no two descriptors share a slot, so a lookup is one multiply, one load and
+// one key compare.
+struct DeviceTableHash
+{
+    static constexpr size_t SLOT_BITS = 6;
+    static constexpr size_t SLOT_COUNT = size_t{1} << SLOT_BITS;
+    static constexpr uint8_t EMPTY = 0xFF;
+    static constexpr int MAX_TRIES = 4096;
+
+    uint32_t multiplier;
+    std::array<uint8_t, SLOT_COUNT> slots;
+
+    static constexpr uint32_t Key(USHORT vid, USHORT pid)
+    {
+        return (static_cast<uint32_t>(vid) << 16) | pid;
+    }
+
+    static constexpr size_t Slot(uint32_t key, uint32_t multiplier)
+    {
+        return static_cast<uint32_t>(key * multiplier) >> (32 - SLOT_BITS);
+    }
+
+    // Returns multiplier 0 if no collision-free multiplier was found
+    template <size_t N>
+    static constexpr DeviceTableHash Build(const DeviceDescriptor (&rows)[N])
+    {
+        static_assert(N < EMPTY && N <= SLOT_COUNT, "Device table too large for the hash");
+
+        uint32_t multiplier = 0x9E3779B1u;
+        for (int attempt = 0; attempt < MAX_TRIES; ++attempt, multiplier += 2)
+        {
+            DeviceTableHash hash{multiplier, {}};
+            for (auto &slot : hash.slots)
+            {
+                slot = EMPTY;
+            }
+
+            bool collision = false;
+            for (size_t i = 0; i < N && !collision; ++i)
+            {
+                const size_t slot = Slot(Key(rows[i].vid, rows[i].pid), multiplier);
+                collision = hash.slots[slot] != EMPTY;
+                hash.slots[slot] = static_cast<uint8_t>(i);
+            }
+            if (!collision)
+            {
+                return hash;
+            }
+        }
+        return {0, {}};
+    }
+};
+
+class DeviceTable
+{
+public:
+    static constexpr const DeviceDescriptor *Find(USHORT vid, USHORT pid)
+    {
+        const uint8_t row = hash.slots[DeviceTableHash::Slot(DeviceTableHash::Key(vid, pid), hash.multiplier)];
+        if (row == DeviceTableHash::EMPTY)
+        {
+            return nullptr;
+        }
+        const DeviceDescriptor &descriptor = DEVICE_DESCRIPTORS[row];
+        return descriptor.vid == vid && descriptor.pid == pid ? &descriptor : nullptr;
+    }
+
+    // Priority shared by the rows one device class serves; INT32_MAX if it serves none
+    static constexpr int GroupPriority(DeviceFamily family, DeviceKind kind)
+    {
+        for (const auto &descriptor : DEVICE_DESCRIPTORS)
+        {
+            if (descriptor.family == family && descriptor.kind == kind)
+            {
+                return descriptor.priority;
+            }
+        }
+        return INT32_MAX;
+    }
+
+    // Compile-time checks of the table, asserted below
+    static constexpr bool GroupsShareOnePriority()
+    {
+        for (const auto &descriptor : DEVICE_DESCRIPTORS)
+        {
+            if (descriptor.priority != GroupPriority(descriptor.family, descriptor.kind))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool EveryRowFindsItself()
+    {
+        for (const auto &descriptor : DEVICE_DESCRIPTORS)
+        {
+            if (Find(descriptor.vid, descriptor.pid) != &descriptor)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static constexpr DeviceTableHash hash = DeviceTableHash::Build(DEVICE_DESCRIPTORS);
+};
+
+static_assert(DeviceTable::hash.multiplier != 0, "No collision-free hash multiplier; duplicate VID/PID or raise SLOT_BITS");
+static_assert(DeviceTable::GroupsShareOnePriority(), "Rows of one family and kind must share a priority");
+static_assert(DeviceTable::EveryRowFindsItself(), "Device table hash lookup is inconsistent");
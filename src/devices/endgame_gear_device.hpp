@@ -1,14 +1,21 @@
 #pragma once
 
 #include "devices/mouse_device.hpp"
-#include "core/hid_device.hpp"
+#include "devices/device_table.hpp"
+#include "core/hid_transport.hpp"
+#include "core/hid_device_index.hpp"
+#include "core/hid_handle_pool.hpp"
+#include "core/hid_input_listener.hpp"
+#include "core/timing_store.hpp"
+#include "core/retry_policy.hpp"
 #include "core/logger.hpp"
 #include <string>
-#include <thread>
-#include <chrono>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <memory>
+#include <optional>
 
 using std::string;
 using std::vector;
@@ -17,9 +24,29 @@ using std::wstring;
 class EndgameGearDevice : public MouseDevice
 {
 public:
+    static constexpr DeviceFamily FAMILY = DeviceFamily::EndgameGear;
     static constexpr USHORT VID = 0x3367;
     static constexpr USHORT USAGE_PAGE = 0xFF01;
     static constexpr USHORT USAGE = 0x0002;
+    static constexpr BYTE REPORT_ID = 0xA1;
+    static constexpr BYTE BATTERY_CMD = 0xB4;
+    static constexpr DWORD REPORT_SIZE = 64;
+
+    // Adaptive read cycle
+    static constexpr uint32_t MIN_POLL_DELAY_MS = 10;
+    static constexpr DWORD POLL_INTERVAL_MS = 10;
+    static constexpr uint32_t MAX_CYCLE_MS = 600;
+    // Must stay below the device's idle sleep timeout: a response inside this window is trusted
+    // without the wake-up cycle. That the timeout is longer is an assumption, not yet checked on
+    // hardware; the cycle is off by default until it is
+    static constexpr std::chrono::seconds AWAKE_WINDOW{10};
+
+    // Retries after the wake-up cycle, as {budget, delay ms} for send, get, echo, status and
+    // timeout failures. A stalled handle is left to DeviceManager, which recycles it. The fixed
+    // read's second response is final; the polled cycle retries a missing status at once, having
+    // already waited up to MAX_CYCLE_MS.
+    static constexpr RetryPolicy FIXED_RETRY{"endgame_fixed", 3, {1, 100}, {1, 100}, {}, {}, {}};
+    static constexpr RetryPolicy ADAPTIVE_RETRY{"endgame_adaptive", 3, {1, 50}, {1, 50}, {}, {1, 0}, {}};
 
     virtual ~EndgameGearDevice()
     {
@@ -29,11 +56,11 @@ public:
     EndgameGearDevice(const EndgameGearDevice &) = delete;
     EndgameGearDevice &operator=(const EndgameGearDevice &) = delete;
 
-    bool FindAndConnect() override
+    bool FindAndConnect(const HIDDeviceIndex &index, HIDHandlePool &pool) override
     {
-        for (USHORT pid : GetSupportedPIDs())
+        for (const auto &row : DEVICE_DESCRIPTORS)
         {
-            if (FindAndConnectWithPID(pid))
+            if (row.family == DeviceFamily::EndgameGear && row.kind == kind && Connect(index, pool, row))
             {
                 return true;
             }
@@ -43,13 +70,56 @@ public:
 
     void Disconnect() override
     {
-        device.Close();
-        currentPid = 0;
+        if (listener.IsRunning())
+        {
+            device->Cancel();
+        }
+        listener.Stop();
+        // The handle itself stays in the pool for the next connection
+        std::atomic_store(&device, HIDHandlePool::Handle{});
+        descriptor = nullptr;
+        currentPath.clear();
+        hasReadBefore = false;
     }
 
     bool IsConnected() const override
     {
-        return device.IsOpen();
+        return device && device->IsOpen();
+    }
+
+    void Cancel() override
+    {
+        // May run on another thread while the engine thread connects or disconnects
+        if (const auto handle = std::atomic_load(&device))
+        {
+            handle->Cancel();
+        }
+    }
+
+    void StartStatusListener(StatusHandler handler) override
+    {
+        if (!IsConnected())
+        {
+            return;
+        }
+
+        listener.Start(*device, [this, handler = std::move(handler)](const BYTE *report, DWORD size)
+                       {
+                           StatusUpdate update = DecodeInputReport(report, size);
+                           if (update.percentage || update.isCharging)
+                           {
+                               handler(update);
+                           } });
+    }
+
+    bool IsStatusListenerRunning() const override
+    {
+        return listener.IsRunning();
+    }
+
+    size_t GetTimeoutCount() const override
+    {
+        return device ? device->GetTimeoutCount() : 0;
     }
 
     BatteryStatus ReadBattery() override
@@ -60,111 +130,350 @@ public:
             return {};
         }
 
-        constexpr BYTE REPORT_ID = 0xA1;
-        constexpr BYTE BATTERY_CMD = 0xB4;
-        constexpr DWORD REPORT_SIZE = 64;
-        constexpr int NUM_ATTEMPTS = 2;
-
         try
         {
-            BatteryStatus status;
+            const auto start = HIDTransport::Clock::now();
+            BatteryStatus status = adaptiveRead ? ReadBatteryAdaptive() : ReadBatteryFixed();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                HIDTransport::Clock::now() - start);
+
+            if (status.percentage >= 0)
+            {
+                lastStatus = status;
+                lastSuccessAt = HIDTransport::Clock::now();
+                hasReadBefore = true;
+                LOG_DEBUG(string(GetDeviceType()) + ": Success - Battery " +
+                          std::to_string(status.percentage) + "% in " + std::to_string(elapsed.count()) + " ms");
+            }
+            return status;
+        }
+        catch (const std::exception &ex)
+        {
+            LOG_ERROR(string(GetDeviceType()) + " exception: " + ex.what());
+        }
+        catch (...)
+        {
+            LOG_ERROR(string(GetDeviceType()) + ": Unknown exception");
+        }
+        return {};
+    }
+
+    // false restores the documented fixed-delay cycle (two 350 ms round trips per read)
+    static void SetAdaptiveRead(bool enabled)
+    {
+        adaptiveRead = enabled;
+    }
+
+    std::wstring_view GetDeviceName() const override
+    {
+        if (descriptor)
+            return descriptor->name;
+        return kind == DeviceKind::Dongle ? L"Endgame Gear Dongle" : L"Endgame Gear Mouse";
+    }
+
+    virtual const char *GetDeviceType() const = 0;
+
+    int GetPriority() const override { return priority; }
+
+    std::wstring_view GetConnectionMode() const override
+    {
+        if (!descriptor)
+            return L"Unknown";
+        return descriptor->wired ? L"Wired (Charging)" : L"Wireless";
+    }
+
+    USHORT GetCurrentPID() const { return descriptor ? descriptor->pid : 0; }
+
+    const wstring &GetDevicePath() const override { return currentPath; }
+
+protected:
+    // Serves the Endgame Gear rows of this kind in the device table
+    explicit EndgameGearDevice(DeviceKind kind)
+        : kind(kind), priority(DeviceTable::GroupPriority(FAMILY, kind)), lastStatus{} {}
+
+    bool Connect(const HIDDeviceIndex &index, HIDHandlePool &pool, const DeviceDescriptor &row)
+    {
+        for (const auto &info : index.Find(row.vid, row.pid, row.usagePage, row.usage))
+        {
+            if (auto handle = pool.Acquire(info))
+            {
+                std::atomic_store(&device, std::move(handle));
+                descriptor = &row;
+                currentPath = info.path;
+                std::ostringstream pidStream;
+                pidStream << std::hex << std::uppercase << row.pid;
+                LOG_INFO(string(GetDeviceType()) + " connected (PID: 0x" +
+                         pidStream.str() + ")");
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Unsolicited reports share the battery-response layout: status in byte[1], level in byte[16]
+    StatusUpdate DecodeInputReport(const BYTE *report, DWORD size) const
+    {
+        StatusUpdate update;
+        if (size <= descriptor->levelOffset || report[0] != REPORT_ID || !IsValidStatus(report[1]))
+        {
+            return update;
+        }
+
+        update.percentage = LevelPercent(report[descriptor->levelOffset]);
+        update.isCharging = descriptor->wired;
+        return update;
+    }
+
+    // Documented protocol: send/350 ms/get cycles, the first response after the wake-up command
+    // discarded. Failed cycles are retried as FIXED_RETRY allows.
+    BatteryStatus ReadBatteryFixed()
+    {
+        RetrySession retry(FIXED_RETRY);
+        bool wakeUp = true;
 
-            for (int attempt = 0; attempt < NUM_ATTEMPTS; ++attempt)
+        for (;;)
+        {
+            if (wakeUp)
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Wake-up cycle");
+            }
+            else
             {
-                LOG_DEBUG(string(GetDeviceType()) + ": Attempt " +
-                          std::to_string(attempt + 1) + "/" + std::to_string(NUM_ATTEMPTS));
+                LOG_DEBUG(string(GetDeviceType()) + ": Attempt " + std::to_string(retry.Attempt()) + "/" +
+                          std::to_string(FIXED_RETRY.maxAttempts));
+            }
 
-                if (!SendBatteryCommand(REPORT_ID, BATTERY_CMD, REPORT_SIZE))
+            if (!SendBatteryCommand(REPORT_ID, BATTERY_CMD, REPORT_SIZE))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Failed to send battery command (" +
+                          ToString(device->GetLastIoResult()) + ")");
+                if (!BackOff(retry, ClassifyTransfer(TransferStage::Send, device->GetLastIoResult())))
                 {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Failed to send battery command");
                     return {};
                 }
+                continue;
+            }
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(350));
+            if (!device->Delay(350))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+                return {};
+            }
 
-                BYTE readBuffer[REPORT_SIZE] = {0};
-                if (!device.GetFeatureReport(REPORT_ID, readBuffer, REPORT_SIZE))
+            BYTE readBuffer[REPORT_SIZE] = {0};
+            if (!device->GetFeatureReport(REPORT_ID, readBuffer, REPORT_SIZE))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Failed to get feature report (" +
+                          ToString(device->GetLastIoResult()) + ")");
+                if (!BackOff(retry, ClassifyTransfer(TransferStage::Get, device->GetLastIoResult())))
                 {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Failed to get feature report");
                     return {};
                 }
+                continue;
+            }
 
-                std::ostringstream oss;
-                oss << GetDeviceType() << ": Response bytes [0-3]: " << std::hex << std::setfill('0')
-                    << std::setw(2) << static_cast<int>(readBuffer[0]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[1]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[2]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[3])
-                    << ", byte[16]: " << std::setw(2) << static_cast<int>(readBuffer[16]);
-                LOG_DEBUG(oss.str());
+            LogResponse(readBuffer);
 
-                if (attempt == 0)
+            if (wakeUp)
+            {
+                wakeUp = false;
+                if (!device->Delay(100))
                 {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    continue;
+                    LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+                    return {};
                 }
+                continue;
+            }
 
-                if (readBuffer[1] != 0x01 && readBuffer[1] != 0x08)
+            if (!IsValidStatus(readBuffer[1]))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Invalid response - unexpected byte[1] value");
+                if (!BackOff(retry, FailureClass::InvalidStatus))
                 {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Invalid response - unexpected byte[1] value");
                     return {};
                 }
-
-                status = ParseBatteryResponse(readBuffer[16]);
-                lastStatus = status;
-                LOG_DEBUG(string(GetDeviceType()) + ": Success - Battery " +
-                          std::to_string(status.percentage) + "%");
-                return status;
+                continue;
             }
+
+            retry.OnSuccess();
+            return ParseBatteryResponse(readBuffer[descriptor->levelOffset]);
         }
-        catch (const std::exception &ex)
+    }
+
+    // Polls for the response instead of sleeping a fixed 350 ms, and skips the wake-up cycle when
+    // the device answered recently enough to still be awake (see docs/ENDGAME.md, "Timing").
+    // Failed cycles are retried as ADAPTIVE_RETRY allows.
+    BatteryStatus ReadBatteryAdaptive()
+    {
+        RetrySession retry(ADAPTIVE_RETRY);
+        bool wakeUp = !(hasReadBefore && HIDTransport::Clock::now() - lastSuccessAt < AWAKE_WINDOW);
+
+        for (;;)
         {
-            LOG_ERROR(string(GetDeviceType()) + " exception: " + ex.what());
+            BYTE readBuffer[REPORT_SIZE] = {0};
+            const CycleResult result = RunPolledCycle(readBuffer, !wakeUp);
+            switch (result)
+            {
+            case CycleResult::Cancelled:
+                return {};
+            case CycleResult::SendFailed:
+            case CycleResult::GetFailed:
+                if (!BackOff(retry, ClassifyTransfer(result == CycleResult::SendFailed ? TransferStage::Send
+                                                                                        : TransferStage::Get,
+                                                     device->GetLastIoResult())))
+                {
+                    return {};
+                }
+                continue;
+            default:
+                break;
+            }
+
+            if (wakeUp && result == CycleResult::Ready)
+            {
+                // A response to the wake-up command is stale; the next cycle is the first attempt
+                LOG_DEBUG(string(GetDeviceType()) + ": Wake-up response discarded");
+                wakeUp = false;
+                continue;
+            }
+
+            if (result == CycleResult::NotReady)
+            {
+                // No answer even to the wake-up command counts against the status budget, so a
+                // switched-off mouse costs two cycles as before
+                LOG_DEBUG(string(GetDeviceType()) + ": No valid response within the cycle deadline");
+                wakeUp = false;
+                if (!BackOff(retry, FailureClass::InvalidStatus))
+                {
+                    return {};
+                }
+                continue;
+            }
+
+            retry.OnSuccess();
+            return ParseBatteryResponse(readBuffer[descriptor->levelOffset]);
         }
-        catch (...)
+    }
+
+    // Records the failure and waits before the next attempt; false when the read should end
+    // (budget spent, or cancelled: a cancelled transfer has no failure class)
+    bool BackOff(RetrySession &retry, std::optional<FailureClass> failure) const
+    {
+        if (!failure)
         {
-            LOG_ERROR(string(GetDeviceType()) + ": Unknown exception");
+            return false;
         }
 
-        LOG_DEBUG(string(GetDeviceType()) + ": All attempts failed");
-        return {};
+        const auto delay = retry.OnFailure(*failure);
+        if (!delay)
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Giving up after " + ToString(*failure) + " failure on attempt " +
+                      std::to_string(retry.Attempt()));
+            return false;
+        }
+        if (!device->Delay(*delay))
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+            return false;
+        }
+        return true;
     }
 
-    virtual wstring GetDeviceName() const = 0;
-    virtual const char *GetDeviceType() const = 0;
-    virtual int GetPriority() const = 0;
-
-    wstring GetConnectionMode() const override
+    enum class CycleResult
     {
-        if (currentPid == 0)
-            return L"Unknown";
-        return IsWiredPID(currentPid) ? L"Wired (Charging)" : L"Wireless";
-    }
+        Ready,
+        NotReady,
+        SendFailed,
+        GetFailed,
+        Cancelled
+    };
 
-    USHORT GetCurrentPID() const { return currentPid; }
+    // Sends the battery command and polls Get until byte[1] carries a valid status. Polling starts
+    // shortly before the response time learned for this PID.
+    CycleResult RunPolledCycle(BYTE *readBuffer, bool learn)
+    {
+        if (!SendBatteryCommand(REPORT_ID, BATTERY_CMD, REPORT_SIZE))
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Failed to send battery command (" +
+                      ToString(device->GetLastIoResult()) + ")");
+            return CycleResult::SendFailed;
+        }
 
-protected:
-    EndgameGearDevice() : currentPid(0), lastStatus{} {}
+        const auto sent = HIDTransport::Clock::now();
+        const std::optional<uint32_t> learned = TimingStore::Instance().Get(TimingKey());
+        const DWORD firstPollMs = learned ? (std::max)(*learned * 3 / 4, MIN_POLL_DELAY_MS) : MIN_POLL_DELAY_MS;
 
-    virtual vector<USHORT> GetSupportedPIDs() const = 0;
-    virtual bool IsWiredPID(USHORT pid) const = 0;
+        if (!device->Delay(firstPollMs))
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+            return CycleResult::Cancelled;
+        }
 
-    bool FindAndConnectWithPID(USHORT pid)
-    {
-        auto devices = HIDDevice::EnumerateDevices(VID, pid);
-        for (const auto &info : devices)
+        for (;;)
         {
-            if (info.usagePage == USAGE_PAGE && info.usage == USAGE && device.Open(info.path))
+            if (!device->GetFeatureReport(REPORT_ID, readBuffer, REPORT_SIZE))
             {
-                currentPid = pid;
-                std::ostringstream pidStream;
-                pidStream << std::hex << std::uppercase << pid;
-                LOG_INFO(string(GetDeviceType()) + " connected (PID: 0x" +
-                         pidStream.str() + ")");
-                return true;
+                LOG_DEBUG(string(GetDeviceType()) + ": Failed to get feature report (" +
+                          ToString(device->GetLastIoResult()) + ")");
+                return CycleResult::GetFailed;
+            }
+
+            const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    HIDTransport::Clock::now() - sent)
+                                    .count();
+            if (IsValidStatus(readBuffer[1]))
+            {
+                LogResponse(readBuffer);
+                if (learn)
+                {
+                    LearnResponseTime(learned, static_cast<uint32_t>(waited));
+                }
+                return CycleResult::Ready;
+            }
+
+            if (waited >= MAX_CYCLE_MS)
+            {
+                return CycleResult::NotReady;
+            }
+
+            if (!device->Delay(POLL_INTERVAL_MS))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+                return CycleResult::Cancelled;
             }
         }
-        return false;
+    }
+
+    // Moving average of the command-to-response time of an awake device. Polling starts at 3/4 of
+    // it, so a device that gets faster pulls the value down over a few reads.
+    void LearnResponseTime(std::optional<uint32_t> learned, uint32_t observedMs)
+    {
+        const uint32_t updated = learned ? (*learned * 3 + observedMs) / 4 : observedMs;
+        TimingStore::Instance().Set(TimingKey(), (std::min)(updated, MAX_CYCLE_MS));
+    }
+
+    string TimingKey() const
+    {
+        std::ostringstream key;
+        key << "endgame_" << std::hex << std::setw(4) << std::setfill('0') << descriptor->pid << "_response_ms";
+        return key.str();
+    }
+
+    static bool IsValidStatus(BYTE status)
+    {
+        return status == 0x01 || status == 0x08;
+    }
+
+    void LogResponse(const BYTE *readBuffer) const
+    {
+        std::ostringstream oss;
+        oss << GetDeviceType() << ": Response bytes [0-3]: " << std::hex << std::setfill('0')
+            << std::setw(2) << static_cast<int>(readBuffer[0]) << " "
+            << std::setw(2) << static_cast<int>(readBuffer[1]) << " "
+            << std::setw(2) << static_cast<int>(readBuffer[2]) << " "
+            << std::setw(2) << static_cast<int>(readBuffer[3])
+            << ", byte[16]: " << std::setw(2) << static_cast<int>(readBuffer[16]);
+        LOG_DEBUG(oss.str());
     }
 
     bool SendBatteryCommand(BYTE reportId, BYTE command, DWORD size) const
@@ -172,19 +481,52 @@ protected:
         BYTE writeBuffer[64] = {0};
         writeBuffer[0] = reportId;
         writeBuffer[1] = command;
-        return device.SendFeatureReport(writeBuffer, size);
+        return device->SendFeatureReport(writeBuffer, size);
+    }
+
+    int LevelPercent(BYTE level) const
+    {
+        return (std::min)(static_cast<int>(level) * descriptor->levelScale, 100);
     }
 
     BatteryStatus ParseBatteryResponse(BYTE batteryValue) const
     {
         BatteryStatus status;
-        status.percentage = (std::min)(static_cast<int>(batteryValue), 100);
-        status.isWireless = !IsWiredPID(currentPid);
-        status.isCharging = IsWiredPID(currentPid);
+        status.percentage = LevelPercent(batteryValue);
+        status.isWireless = !descriptor->wired;
+        status.isCharging = descriptor->wired;
         return status;
     }
 
-    HIDDevice device;
-    USHORT currentPid;
+    // Shared with the pool; null while disconnected. Replaced only on the engine thread.
+    HIDHandlePool::Handle device;
+    HIDInputListener listener;
+    const DeviceKind kind;
+    const int priority;
+    // Table row of the connected product; nullptr while disconnected. Wired or wireless is fixed
+    // by the PID for the whole connection, since a cable change re-enumerates the device
+    const DeviceDescriptor *descriptor = nullptr;
+    wstring currentPath;
     BatteryStatus lastStatus;
+    HIDTransport::Clock::time_point lastSuccessAt{};
+    bool hasReadBefore = false;
+
+    static inline bool adaptiveRead = false;
 };
+
+// The protocol code frames reports with the class constants; every Endgame Gear row has to agree
+constexpr bool EndgameGearRowsMatchProtocol()
+{
+    for (const auto &row : DEVICE_DESCRIPTORS)
+    {
+        if (row.family == DeviceFamily::EndgameGear &&
+            (row.vid != EndgameGearDevice::VID || row.usagePage != EndgameGearDevice::USAGE_PAGE ||
+             row.usage != EndgameGearDevice::USAGE || row.reportId != EndgameGearDevice::REPORT_ID ||
+             row.levelOffset >= EndgameGearDevice::REPORT_SIZE))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(EndgameGearRowsMatchProtocol(), "Endgame Gear device table rows disagree with the protocol constants");
@@ -2,23 +2,13 @@
 
 #include "devices/endgame_gear_device.hpp"
 
-class EndgameGearDongle : public EndgameGearDevice
+// Endgame Gear wireless receiver; products are listed in devices/device_table.hpp
+class EndgameGearDongle final : public EndgameGearDevice
 {
 public:
-    static constexpr USHORT PID_DONGLE = 0x1970;
+    static constexpr DeviceKind KIND = DeviceKind::Dongle;
 
-    std::wstring GetDeviceName() const override { return L"Endgame Gear Dongle"; }
-    const char *GetDeviceType() const override { return "EndgameGearDongle"; }
-    int GetPriority() const override { return 3; }
-
-protected:
-    std::vector<USHORT> GetSupportedPIDs() const override
-    {
-        return {PID_DONGLE};
-    }
+    EndgameGearDongle() : EndgameGearDevice(KIND) {}
 
-    bool IsWiredPID(USHORT) const override
-    {
-        return false;
-    }
+    const char *GetDeviceType() const override { return "EndgameGearDongle"; }
 };
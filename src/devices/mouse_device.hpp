@@ -1,6 +1,14 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+#include <optional>
+#include <functional>
+
+class HIDDeviceIndex;
+class HIDHandlePool;
 
 class MouseDevice
 {
@@ -12,20 +20,59 @@ public:
         bool isWireless{false};
     };
 
+    // Fields carried by one unsolicited input report; unset fields were not reported
+    struct StatusUpdate
+    {
+        std::optional<int> percentage;
+        std::optional<bool> isCharging;
+    };
+
+    // Read-only device value beyond battery state (polling rate, firmware version, ...)
+    struct Attribute
+    {
+        std::string name;
+        std::string value;
+    };
+
+    // Events after which cached attributes may no longer hold
+    enum class InvalidationTrigger
+    {
+        DeviceArrival, // a supported interface appeared, e.g. a charging cable was plugged in
+        DeviceRemoval
+    };
+
+    // Runs on the listener thread
+    using StatusHandler = std::function<void(const StatusUpdate &)>;
+
     virtual ~MouseDevice() = default;
 
     MouseDevice(const MouseDevice &) = delete;
     MouseDevice &operator=(const MouseDevice &) = delete;
 
-    virtual bool FindAndConnect() = 0;
+    // Connects to the first interface in the index this class serves, through a pooled handle
+    virtual bool FindAndConnect(const HIDDeviceIndex &index, HIDHandlePool &pool) = 0;
     virtual void Disconnect() = 0;
     virtual bool IsConnected() const = 0;
+    // Thread-safe request to abort whatever HID work is currently running on this device
+    virtual void Cancel() = 0;
     virtual BatteryStatus ReadBattery() = 0;
+    // Listens for unsolicited status reports on the vendor collection until Disconnect()
+    virtual void StartStatusListener(StatusHandler handler) = 0;
+    virtual bool IsStatusListenerRunning() const = 0;
+    // Feature-report calls that hit the transport deadline since the device was connected
+    virtual size_t GetTimeoutCount() const = 0;
 
-    virtual std::wstring GetDeviceName() const = 0;
+    // Names point into static storage and stay valid for the life of the program
+    virtual std::wstring_view GetDeviceName() const = 0;
     virtual const char *GetDeviceType() const = 0;
     virtual int GetPriority() const = 0;
-    virtual std::wstring GetConnectionMode() const = 0;
+    virtual std::wstring_view GetConnectionMode() const = 0;
+    // Interface path of the open handle; empty while disconnected
+    virtual const std::wstring &GetDevicePath() const = 0;
+    // Attributes gathered by past reads on this connection; devices without any return none
+    virtual std::vector<Attribute> GetTelemetry() const { return {}; }
+    // Marks cached attributes that depend on the event for re-reading on the next ReadBattery
+    virtual void Invalidate(InvalidationTrigger) {}
 
 protected:
     MouseDevice() = default;
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "core/hid_transport.hpp"
+#include "core/retry_policy.hpp"
+#include "core/logger.hpp"
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <chrono>
+
+using std::string;
+using std::vector;
+
+// Runs a batch of 0xA5-protocol read commands on one handle and collects their responses.
+// The device keeps a single response slot per report ID, so commands go out back to back
+// rather than all at once (a second command would overwrite the first answer). Instead of a
+// fixed delay, each response is polled for and matched by the cmd_id echo in byte[2]; reads
+// that still show an earlier command's answer are skipped. That only works while the slot does
+// not already hold the command's echo, so a command is never sent into a slot holding its own
+// (or an unknown) answer: another command's answer is put there first. A command without a
+// matching response is resent as COMMAND_RETRY allows.
+class VaxeeCommandQueue
+{
+public:
+    static constexpr BYTE REPORT_ID = 0x0E;
+    static constexpr BYTE HEADER = 0xA5;
+    static constexpr BYTE CMD_READ = 0x01;
+    static constexpr DWORD REPORT_SIZE = 64;
+    // First payload byte of a response, after report ID, header, echo, ack and length
+    static constexpr DWORD DATA_OFFSET = 5;
+
+    static constexpr DWORD FIRST_POLL_MS = 15;
+    static constexpr DWORD POLL_INTERVAL_MS = 10;
+    static constexpr uint32_t RESPONSE_TIMEOUT_MS = 300;
+    // Per command, as {budget, delay ms} for send, get, echo, status and timeout failures. A
+    // stalled handle ends the whole run; DeviceManager recycles it.
+    static constexpr RetryPolicy COMMAND_RETRY{"vaxee_command", 3, {2, 50}, {2, 50}, {2, 50}, {}, {}};
+
+    // previousEcho: the cmd_id last seen in the response slot on this handle, 0 if unknown.
+    // primer: command run ahead of a batch whose only command already has its echo in the slot;
+    // its answer replaces the old one and is available through Value like any other.
+    VaxeeCommandQueue(const HIDTransport &device, const char *deviceType, BYTE previousEcho, BYTE primer)
+        : device(device), deviceType(deviceType), lastEcho(previousEcho), primer(primer) {}
+
+    void Submit(BYTE cmdId)
+    {
+        if (!FindCommand(cmdId))
+        {
+            commands.push_back({cmdId, std::nullopt, {}});
+        }
+    }
+
+    // Returns false when the read was cancelled, the handle stalled or the slot could not be
+    // read; commands that ran out of attempts are left without a value
+    bool Run()
+    {
+        // After a reconnect the slot still holds whatever was last answered on the handle
+        if (lastEcho == 0 && !ReadSlotEcho())
+        {
+            return false;
+        }
+
+        // A command whose echo is already in the slot cannot tell a fresh answer from the old
+        // one, so it goes last, after another command has replaced the slot contents; alone, it
+        // is preceded by the primer
+        auto stale = std::find_if(commands.begin(), commands.end(),
+                                  [this](const Command &command)
+                                  { return command.cmdId == lastEcho; });
+        if (stale != commands.end() && commands.size() > 1)
+        {
+            std::rotate(stale, stale + 1, commands.end());
+        }
+        else if (stale != commands.end() && stale->cmdId != primer)
+        {
+            commands.insert(commands.begin(), {primer, std::nullopt, {}});
+        }
+
+        for (auto &command : commands)
+        {
+            if (command.cmdId == lastEcho)
+            {
+                // Nothing answered ahead of it, so its old answer is still in the slot
+                LOG_DEBUG(string(deviceType) + ": Slot still holds the answer to cmd_id " +
+                          std::to_string(command.cmdId) + " - not sending it");
+                continue;
+            }
+
+            RetrySession retry(COMMAND_RETRY);
+            for (;;)
+            {
+                FailureClass failure = FailureClass::InvalidEcho;
+                const Outcome outcome = Execute(command, failure);
+                if (outcome == Outcome::Answered)
+                {
+                    retry.OnSuccess();
+                    break;
+                }
+                if (outcome == Outcome::Aborted)
+                {
+                    return false;
+                }
+
+                const auto delay = retry.OnFailure(failure);
+                if (!delay)
+                {
+                    if (failure == FailureClass::Timeout)
+                    {
+                        // A stalled device will not answer a retry or the next command on this handle
+                        return false;
+                    }
+                    LOG_DEBUG(string(deviceType) + ": No response to cmd_id " + std::to_string(command.cmdId) +
+                              " after " + std::to_string(retry.Attempt()) + " attempts (" + ToString(failure) + ")");
+                    break;
+                }
+
+                ++retries;
+                if (!device.Delay(*delay))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // First payload byte (byte[5]) of a command that was answered
+    std::optional<BYTE> Value(BYTE cmdId) const
+    {
+        const Command *command = FindCommand(cmdId);
+        return command ? command->value : std::nullopt;
+    }
+
+    // Response payload (byte[4] bytes from byte[5] on); empty if the command was not answered
+    const vector<BYTE> &Data(BYTE cmdId) const
+    {
+        static const vector<BYTE> none;
+        const Command *command = FindCommand(cmdId);
+        return command && command->value ? command->data : none;
+    }
+
+    BYTE LastEcho() const { return lastEcho; }
+    int Retries() const { return retries; }
+
+private:
+    enum class Outcome
+    {
+        Answered,
+        Failed, // failure says why
+        Aborted // cancelled
+    };
+
+    struct Command
+    {
+        BYTE cmdId;
+        std::optional<BYTE> value;
+        vector<BYTE> data;
+    };
+
+    const HIDTransport &device;
+    const char *deviceType;
+    BYTE lastEcho;
+    BYTE primer;
+    vector<Command> commands;
+    int retries = 0;
+
+    const Command *FindCommand(BYTE cmdId) const
+    {
+        for (const auto &command : commands)
+        {
+            if (command.cmdId == cmdId)
+            {
+                return &command;
+            }
+        }
+        return nullptr;
+    }
+
+    // Reads the slot without sending anything and notes the echo it holds; false if it could not
+    // be read
+    bool ReadSlotEcho()
+    {
+        BYTE response[REPORT_SIZE] = {0};
+        if (!device.GetFeatureReport(REPORT_ID, response, REPORT_SIZE))
+        {
+            LOG_DEBUG(string(deviceType) + ": Failed to read the response slot (" +
+                      ToString(device.GetLastIoResult()) + ")");
+            return false;
+        }
+        if (response[1] == HEADER && response[2] != 0)
+        {
+            lastEcho = response[2];
+        }
+        return true;
+    }
+
+    Outcome Execute(Command &command, FailureClass &failure)
+    {
+        BYTE request[REPORT_SIZE] = {0};
+        request[0] = REPORT_ID;
+        request[1] = HEADER;
+        request[2] = command.cmdId;
+        request[3] = CMD_READ;
+        request[4] = 0x01;
+
+        if (!device.SendFeatureReport(request, REPORT_SIZE))
+        {
+            LOG_DEBUG(string(deviceType) + ": Failed to send cmd_id " + std::to_string(command.cmdId) +
+                      " (" + ToString(device.GetLastIoResult()) + ")");
+            return Classify(TransferStage::Send, failure);
+        }
+
+        const auto sentAt = HIDTransport::Clock::now();
+        DWORD delay = FIRST_POLL_MS;
+        while (true)
+        {
+            if (!device.Delay(delay))
+            {
+                LOG_DEBUG(string(deviceType) + ": Read cancelled");
+                return Outcome::Aborted;
+            }
+            delay = POLL_INTERVAL_MS;
+
+            BYTE response[REPORT_SIZE] = {0};
+            if (!device.GetFeatureReport(REPORT_ID, response, REPORT_SIZE))
+            {
+                LOG_DEBUG(string(deviceType) + ": Failed to get response to cmd_id " +
+                          std::to_string(command.cmdId) + " (" + ToString(device.GetLastIoResult()) + ")");
+                return Classify(TransferStage::Get, failure);
+            }
+
+            if (response[1] == HEADER && response[2] != 0)
+            {
+                lastEcho = response[2];
+            }
+
+            const auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+                HIDTransport::Clock::now() - sentAt);
+            if (response[1] == HEADER && response[2] == command.cmdId)
+            {
+                command.value = response[DATA_OFFSET];
+                const DWORD length = (std::max)(DWORD{1}, (std::min)(static_cast<DWORD>(response[4]), REPORT_SIZE - DATA_OFFSET));
+                command.data.assign(response + DATA_OFFSET, response + DATA_OFFSET + length);
+                LOG_DEBUG(string(deviceType) + ": cmd_id " + std::to_string(command.cmdId) + " answered in " +
+                          std::to_string(waited.count()) + " ms, value " + std::to_string(response[DATA_OFFSET]));
+                return Outcome::Answered;
+            }
+
+            if (waited.count() >= RESPONSE_TIMEOUT_MS)
+            {
+                failure = FailureClass::InvalidEcho;
+                return Outcome::Failed;
+            }
+        }
+    }
+
+    Outcome Classify(TransferStage stage, FailureClass &failure) const
+    {
+        const auto classified = ClassifyTransfer(stage, device.GetLastIoResult());
+        if (!classified)
+        {
+            return Outcome::Aborted;
+        }
+        failure = *classified;
+        return Outcome::Failed;
+    }
+};
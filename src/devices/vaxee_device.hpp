@@ -1,14 +1,24 @@
 #pragma once
 
 #include "devices/mouse_device.hpp"
-#include "core/hid_device.hpp"
+#include "devices/device_table.hpp"
+#include "core/hid_transport.hpp"
+#include "core/hid_device_index.hpp"
+#include "core/hid_handle_pool.hpp"
+#include "core/hid_input_listener.hpp"
+#include "devices/vaxee_command_queue.hpp"
+#include "core/retry_policy.hpp"
+#include "devices/attribute_schedule.hpp"
 #include "core/logger.hpp"
 #include <string>
-#include <thread>
-#include <chrono>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <memory>
+#include <map>
+#include <optional>
+#include <stdexcept>
 
 using std::string;
 using std::vector;
@@ -17,6 +27,7 @@ using std::wstring;
 class VaxeeDevice : public MouseDevice
 {
 public:
+    static constexpr DeviceFamily FAMILY = DeviceFamily::Vaxee;
     static constexpr USHORT VID = 0x3057;
     static constexpr USHORT USAGE_PAGE = 0xFF05;
     static constexpr USHORT USAGE = 0x01;
@@ -29,6 +40,11 @@ public:
     static constexpr BYTE CMD_CHARGING_STATUS = 0x10;
     static constexpr BYTE CMD_READ = 0x01;
 
+    // Battery-level retries of the fixed read, as {budget, delay ms} for send, get, echo, status
+    // and timeout failures. A stalled handle is left to DeviceManager, which recycles it; a
+    // missing echo is resent at once, the read having already waited 100 ms.
+    static constexpr RetryPolicy FIXED_RETRY{"vaxee_fixed", 2, {1, 50}, {1, 50}, {1, 0}, {}, {}};
+
     virtual ~VaxeeDevice()
     {
         Disconnect();
@@ -37,11 +53,11 @@ public:
     VaxeeDevice(const VaxeeDevice &) = delete;
     VaxeeDevice &operator=(const VaxeeDevice &) = delete;
 
-    bool FindAndConnect() override
+    bool FindAndConnect(const HIDDeviceIndex &index, HIDHandlePool &pool) override
     {
-        for (USHORT pid : GetSupportedPIDs())
+        for (const auto &row : DEVICE_DESCRIPTORS)
         {
-            if (FindAndConnectWithPID(pid))
+            if (row.family == DeviceFamily::Vaxee && row.kind == kind && Connect(index, pool, row))
             {
                 return true;
             }
@@ -51,92 +67,83 @@ public:
 
     void Disconnect() override
     {
-        device.Close();
-        currentPid = 0;
+        if (listener.IsRunning())
+        {
+            device->Cancel();
+        }
+        listener.Stop();
+        // The handle itself stays in the pool for the next connection
+        std::atomic_store(&device, HIDHandlePool::Handle{});
+        descriptor = nullptr;
+        currentPath.clear();
+        lastEcho = 0;
+        cachedCharging.reset();
+        telemetry.clear();
+        schedule.Reset();
     }
 
     bool IsConnected() const override
     {
-        return device.IsOpen();
+        return device && device->IsOpen();
     }
 
-    BatteryStatus ReadBattery() override
+    void Cancel() override
     {
-        if (!IsConnected())
+        // May run on another thread while the engine thread connects or disconnects
+        if (const auto handle = std::atomic_load(&device))
         {
-            LOG_DEBUG(string(GetDeviceType()) + ": Device not connected");
-            return {};
+            handle->Cancel();
         }
+    }
 
-        constexpr int NUM_ATTEMPTS = 2;
-
-        try
+    void StartStatusListener(StatusHandler handler) override
+    {
+        if (!IsConnected())
         {
-            for (int attempt = 0; attempt < NUM_ATTEMPTS; ++attempt)
-            {
-                LOG_DEBUG(string(GetDeviceType()) + ": Attempt " +
-                          std::to_string(attempt + 1) + "/" + std::to_string(NUM_ATTEMPTS));
-
-                // Read battery level (cmd_id 0x0B)
-                if (!SendCommand(CMD_BATTERY_LEVEL, CMD_READ, 0x01))
-                {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Failed to send battery level command");
-                    continue;
-                }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            return;
+        }
 
-                BYTE readBuffer[REPORT_SIZE] = {0};
-                if (!device.GetFeatureReport(REPORT_ID, readBuffer, REPORT_SIZE))
-                {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Failed to get battery feature report");
-                    continue;
-                }
+        listener.Start(*device, [this, handler = std::move(handler)](const BYTE *report, DWORD size)
+                       {
+                           StatusUpdate update = DecodeInputReport(report, size);
+                           if (update.percentage || update.isCharging)
+                           {
+                               handler(update);
+                           } });
+    }
 
-                std::ostringstream oss;
-                oss << GetDeviceType() << ": Response bytes [0-5]: " << std::hex << std::setfill('0')
-                    << std::setw(2) << static_cast<int>(readBuffer[0]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[1]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[2]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[3]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[4]) << " "
-                    << std::setw(2) << static_cast<int>(readBuffer[5]);
-                LOG_DEBUG(oss.str());
-
-                // Validate response - byte[2] should echo cmd_id
-                if (readBuffer[2] == 0)
-                {
-                    LOG_DEBUG(string(GetDeviceType()) + ": Invalid response - no cmd_id echo");
-                    continue;
-                }
+    bool IsStatusListenerRunning() const override
+    {
+        return listener.IsRunning();
+    }
 
-                int batteryLevel = (std::min)(static_cast<int>(readBuffer[5]) * 5, 100);
+    size_t GetTimeoutCount() const override
+    {
+        return device ? device->GetTimeoutCount() : 0;
+    }
 
-                // Read charging status (cmd_id 0x10)
-                bool isCharging = false;
-                if (SendCommand(CMD_CHARGING_STATUS, CMD_READ, 0x01))
-                {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-                    BYTE chargeBuffer[REPORT_SIZE] = {0};
-                    if (device.GetFeatureReport(REPORT_ID, chargeBuffer, REPORT_SIZE))
-                    {
-                        isCharging = chargeBuffer[5] != 0;
-                        LOG_DEBUG(string(GetDeviceType()) + ": Charging status byte: " +
-                                  std::to_string(static_cast<int>(chargeBuffer[5])));
-                    }
-                }
+    BatteryStatus ReadBattery() override
+    {
+        if (!IsConnected())
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Device not connected");
+            return {};
+        }
 
-                BatteryStatus status;
-                status.percentage = batteryLevel;
-                status.isCharging = isCharging;
-                status.isWireless = IsDonglePID(currentPid);
+        try
+        {
+            const auto start = HIDTransport::Clock::now();
+            BatteryStatus status = commandQueue ? ReadBatteryQueued() : ReadBatteryFixed();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                HIDTransport::Clock::now() - start);
 
+            if (status.percentage >= 0)
+            {
                 LOG_DEBUG(string(GetDeviceType()) + ": Success - Battery " +
                           std::to_string(status.percentage) + "%, Charging: " +
-                          (status.isCharging ? "Yes" : "No"));
-                return status;
+                          (status.isCharging ? "Yes" : "No") + " in " + std::to_string(elapsed.count()) + " ms");
             }
+            return status;
         }
         catch (const std::exception &ex)
         {
@@ -146,40 +153,140 @@ public:
         {
             LOG_ERROR(string(GetDeviceType()) + ": Unknown exception");
         }
-
-        LOG_DEBUG(string(GetDeviceType()) + ": All attempts failed");
         return {};
     }
 
-    virtual wstring GetDeviceName() const = 0;
+    // true switches from the fixed-delay sequence (send, wait 100 ms, read) to VaxeeCommandQueue.
+    // Off by default: the queue relies on the response slot behaving as described in
+    // docs/VAXEE.md, which no hardware trace has confirmed yet.
+    static void SetCommandQueue(bool enabled)
+    {
+        commandQueue = enabled;
+    }
+
+    // How long a charging status read by the command queue is reused; plugging or unplugging a
+    // supported device re-reads it earlier. Zero reads it on every poll.
+    static void SetChargingRefresh(std::chrono::seconds refresh)
+    {
+        chargingRefresh = refresh;
+    }
+
+    void Invalidate(InvalidationTrigger trigger) override
+    {
+        if (schedule.Invalidate(trigger) > 0)
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Cached attributes invalidated by device " +
+                      (trigger == InvalidationTrigger::DeviceArrival ? "arrival" : "removal"));
+        }
+    }
+
+    // Extra read-only attribute fetched in the same session as the battery read
+    struct TelemetrySpec
+    {
+        string name;
+        BYTE cmdId;
+        std::chrono::seconds refresh; // re-read once the last value is this old
+    };
+
+    // Only used by the command-queue read; call before the engine starts
+    static void SetTelemetryAttributes(vector<TelemetrySpec> specs)
+    {
+        telemetrySpecs = std::move(specs);
+    }
+
+    // "name:cmd_id:refresh_seconds" entries separated by commas, e.g. "polling_rate:0x20:3600".
+    // Malformed entries are logged and skipped.
+    static vector<TelemetrySpec> ParseTelemetrySpecs(const string &list)
+    {
+        vector<TelemetrySpec> specs;
+        std::istringstream entries(list);
+        string entry;
+        while (std::getline(entries, entry, ','))
+        {
+            entry.erase(0, entry.find_first_not_of(" \t"));
+            entry.erase(entry.find_last_not_of(" \t") + 1);
+            if (entry.empty())
+            {
+                continue;
+            }
+
+            const size_t first = entry.find(':');
+            const size_t second = first == string::npos ? string::npos : entry.find(':', first + 1);
+            try
+            {
+                if (second == string::npos || first == 0)
+                {
+                    throw std::invalid_argument("expected name:cmd_id:refresh_seconds");
+                }
+                const unsigned long cmdId = std::stoul(entry.substr(first + 1, second - first - 1), nullptr, 0);
+                const long refresh = std::stol(entry.substr(second + 1));
+                if (cmdId == 0 || cmdId > 0xFF || refresh < 0)
+                {
+                    throw std::out_of_range("cmd_id or refresh out of range");
+                }
+                specs.push_back({entry.substr(0, first), static_cast<BYTE>(cmdId), std::chrono::seconds(refresh)});
+            }
+            catch (const std::exception &ex)
+            {
+                LOG_ERROR("Ignoring VAXEE telemetry entry '" + entry + "': " + ex.what());
+            }
+        }
+        return specs;
+    }
+
+    vector<Attribute> GetTelemetry() const override
+    {
+        vector<Attribute> attributes;
+        for (const auto &spec : telemetrySpecs)
+        {
+            auto it = telemetry.find(spec.cmdId);
+            if (it != telemetry.end())
+            {
+                attributes.push_back({spec.name, FormatTelemetry(it->second)});
+            }
+        }
+        return attributes;
+    }
+
+    std::wstring_view GetDeviceName() const override
+    {
+        if (descriptor)
+            return descriptor->name;
+        return kind == DeviceKind::Dongle ? L"VAXEE Dongle" : L"VAXEE Mouse";
+    }
+
     virtual const char *GetDeviceType() const = 0;
-    virtual int GetPriority() const = 0;
 
-    wstring GetConnectionMode() const override
+    int GetPriority() const override { return priority; }
+
+    std::wstring_view GetConnectionMode() const override
     {
-        if (currentPid == 0)
+        if (!descriptor)
             return L"Unknown";
-        return IsDonglePID(currentPid) ? L"Wireless" : L"Wired (Charging)";
+        return descriptor->wired ? L"Wired (Charging)" : L"Wireless";
     }
 
-    USHORT GetCurrentPID() const { return currentPid; }
+    USHORT GetCurrentPID() const { return descriptor ? descriptor->pid : 0; }
 
-protected:
-    VaxeeDevice() : currentPid(0) {}
+    const wstring &GetDevicePath() const override { return currentPath; }
 
-    virtual vector<USHORT> GetSupportedPIDs() const = 0;
-    virtual bool IsDonglePID(USHORT pid) const = 0;
+protected:
+    // Serves the VAXEE rows of this kind in the device table
+    explicit VaxeeDevice(DeviceKind kind)
+        : kind(kind), priority(DeviceTable::GroupPriority(FAMILY, kind)) {}
 
-    bool FindAndConnectWithPID(USHORT pid)
+    bool Connect(const HIDDeviceIndex &index, HIDHandlePool &pool, const DeviceDescriptor &row)
     {
-        auto devices = HIDDevice::EnumerateDevices(VID, pid);
-        for (const auto &info : devices)
+        for (const auto &info : index.Find(row.vid, row.pid, row.usagePage, row.usage))
         {
-            if (info.usagePage == USAGE_PAGE && info.usage == USAGE && device.Open(info.path))
+            if (auto handle = pool.Acquire(info))
             {
-                currentPid = pid;
+                std::atomic_store(&device, std::move(handle));
+                descriptor = &row;
+                currentPath = info.path;
+                DefineSchedule();
                 std::ostringstream pidStream;
-                pidStream << std::hex << std::uppercase << pid;
+                pidStream << std::hex << std::uppercase << row.pid;
                 LOG_INFO(string(GetDeviceType()) + " connected (PID: 0x" +
                          pidStream.str() + ")");
                 return true;
@@ -188,6 +295,233 @@ protected:
         return false;
     }
 
+    // Unsolicited reports share the feature-response layout: header, echoed cmd_id, value in byte[5]
+    StatusUpdate DecodeInputReport(const BYTE *report, DWORD size) const
+    {
+        StatusUpdate update;
+        if (size < 6 || report[0] != REPORT_ID || report[1] != HEADER)
+        {
+            return update;
+        }
+
+        if (report[2] == CMD_BATTERY_LEVEL)
+        {
+            update.percentage = LevelPercent(report[descriptor->levelOffset]);
+        }
+        else if (report[2] == CMD_CHARGING_STATUS)
+        {
+            update.isCharging = report[5] != 0;
+        }
+        return update;
+    }
+
+    // Send, wait 100 ms, read, for the battery level and then the charging status. Battery reads
+    // are retried as FIXED_RETRY allows; the charging status is best effort.
+    BatteryStatus ReadBatteryFixed()
+    {
+        RetrySession retry(FIXED_RETRY);
+
+        for (;;)
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Attempt " + std::to_string(retry.Attempt()) + "/" +
+                      std::to_string(FIXED_RETRY.maxAttempts));
+
+            // Read battery level (cmd_id 0x0B)
+            if (!SendCommand(CMD_BATTERY_LEVEL, CMD_READ, 0x01))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Failed to send battery level command (" +
+                          ToString(device->GetLastIoResult()) + ")");
+                if (!BackOff(retry, ClassifyTransfer(TransferStage::Send, device->GetLastIoResult())))
+                {
+                    return {};
+                }
+                continue;
+            }
+
+            if (!device->Delay(100))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+                return {};
+            }
+
+            BYTE readBuffer[REPORT_SIZE] = {0};
+            if (!device->GetFeatureReport(REPORT_ID, readBuffer, REPORT_SIZE))
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Failed to get battery feature report (" +
+                          ToString(device->GetLastIoResult()) + ")");
+                if (!BackOff(retry, ClassifyTransfer(TransferStage::Get, device->GetLastIoResult())))
+                {
+                    return {};
+                }
+                continue;
+            }
+
+            std::ostringstream oss;
+            oss << GetDeviceType() << ": Response bytes [0-5]: " << std::hex << std::setfill('0')
+                << std::setw(2) << static_cast<int>(readBuffer[0]) << " "
+                << std::setw(2) << static_cast<int>(readBuffer[1]) << " "
+                << std::setw(2) << static_cast<int>(readBuffer[2]) << " "
+                << std::setw(2) << static_cast<int>(readBuffer[3]) << " "
+                << std::setw(2) << static_cast<int>(readBuffer[4]) << " "
+                << std::setw(2) << static_cast<int>(readBuffer[5]);
+            LOG_DEBUG(oss.str());
+
+            // Validate response - byte[2] should echo cmd_id
+            if (readBuffer[2] == 0)
+            {
+                LOG_DEBUG(string(GetDeviceType()) + ": Invalid response - no cmd_id echo");
+                if (!BackOff(retry, FailureClass::InvalidEcho))
+                {
+                    return {};
+                }
+                continue;
+            }
+
+            int batteryLevel = LevelPercent(readBuffer[descriptor->levelOffset]);
+
+            // Read charging status (cmd_id 0x10)
+            bool isCharging = false;
+            if (SendCommand(CMD_CHARGING_STATUS, CMD_READ, 0x01))
+            {
+                if (!device->Delay(100))
+                {
+                    LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+                    return {};
+                }
+
+                BYTE chargeBuffer[REPORT_SIZE] = {0};
+                if (device->GetFeatureReport(REPORT_ID, chargeBuffer, REPORT_SIZE))
+                {
+                    isCharging = chargeBuffer[5] != 0;
+                    LOG_DEBUG(string(GetDeviceType()) + ": Charging status byte: " +
+                              std::to_string(static_cast<int>(chargeBuffer[5])));
+                }
+            }
+
+            retry.OnSuccess();
+            BatteryStatus status;
+            status.percentage = batteryLevel;
+            status.isCharging = isCharging;
+            status.isWireless = !descriptor->wired;
+            return status;
+        }
+    }
+
+    // Records the failure and waits before the next attempt; false when the read should end
+    // (budget spent, or cancelled: a cancelled transfer has no failure class)
+    bool BackOff(RetrySession &retry, std::optional<FailureClass> failure) const
+    {
+        if (!failure)
+        {
+            return false;
+        }
+
+        const auto delay = retry.OnFailure(*failure);
+        if (!delay)
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Giving up after " + ToString(*failure) + " failure on attempt " +
+                      std::to_string(retry.Attempt()));
+            return false;
+        }
+        if (!device->Delay(*delay))
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": Read cancelled");
+            return false;
+        }
+        return true;
+    }
+
+    BatteryStatus ReadBatteryQueued()
+    {
+        // The charging command displaces an old battery answer, so a battery-only batch gets a
+        // fresh charging status for free
+        VaxeeCommandQueue queue(*device, GetDeviceType(), lastEcho, CMD_CHARGING_STATUS);
+        queue.Submit(CMD_BATTERY_LEVEL);
+
+        // Only attributes whose cached value has expired or was invalidated go out with the battery command
+        const auto now = HIDTransport::Clock::now();
+        if (!cachedCharging || schedule.IsDue(CMD_CHARGING_STATUS, now))
+        {
+            queue.Submit(CMD_CHARGING_STATUS);
+        }
+        for (const auto &spec : telemetrySpecs)
+        {
+            if (schedule.IsDue(spec.cmdId, now))
+            {
+                queue.Submit(spec.cmdId);
+            }
+        }
+
+        const bool completed = queue.Run();
+        lastEcho = queue.LastEcho();
+
+        if (const auto charging = queue.Value(CMD_CHARGING_STATUS))
+        {
+            cachedCharging = *charging != 0;
+            schedule.MarkRead(CMD_CHARGING_STATUS, now);
+        }
+        for (const auto &spec : telemetrySpecs)
+        {
+            const auto &data = queue.Data(spec.cmdId);
+            if (!data.empty())
+            {
+                telemetry[spec.cmdId] = data;
+                schedule.MarkRead(spec.cmdId, now);
+            }
+        }
+
+        if (queue.Retries() > 0)
+        {
+            LOG_DEBUG(string(GetDeviceType()) + ": " + std::to_string(queue.Retries()) + " command(s) resent");
+        }
+
+        const auto level = queue.Value(CMD_BATTERY_LEVEL);
+        if (!completed || !level)
+        {
+            return {};
+        }
+
+        BatteryStatus status;
+        status.percentage = LevelPercent(*level);
+        status.isCharging = cachedCharging.value_or(false);
+        status.isWireless = !descriptor->wired;
+        return status;
+    }
+
+    void DefineSchedule()
+    {
+        schedule = {};
+        schedule.Define(CMD_CHARGING_STATUS, chargingRefresh,
+                        AttributeSchedule::TriggerBit(InvalidationTrigger::DeviceArrival) |
+                            AttributeSchedule::TriggerBit(InvalidationTrigger::DeviceRemoval));
+        for (const auto &spec : telemetrySpecs)
+        {
+            schedule.Define(spec.cmdId, spec.refresh);
+        }
+    }
+
+    int LevelPercent(BYTE level) const
+    {
+        return (std::min)(static_cast<int>(level) * descriptor->levelScale, 100);
+    }
+
+    // One byte as a decimal number, longer payloads as hex bytes
+    static string FormatTelemetry(const vector<BYTE> &data)
+    {
+        if (data.size() == 1)
+        {
+            return std::to_string(data[0]);
+        }
+
+        std::ostringstream oss;
+        oss << std::hex << std::setfill('0');
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            oss << (i > 0 ? " " : "") << std::setw(2) << static_cast<int>(data[i]);
+        }
+        return oss.str();
+    }
+
     bool SendCommand(BYTE cmdId, BYTE readWrite, BYTE dataLength) const
     {
         BYTE writeBuffer[REPORT_SIZE] = {0};
@@ -196,9 +530,44 @@ protected:
         writeBuffer[2] = cmdId;
         writeBuffer[3] = readWrite;
         writeBuffer[4] = dataLength;
-        return device.SendFeatureReport(writeBuffer, REPORT_SIZE);
+        return device->SendFeatureReport(writeBuffer, REPORT_SIZE);
     }
 
-    HIDDevice device;
-    USHORT currentPid;
+    // Shared with the pool; null while disconnected. Replaced only on the engine thread.
+    HIDHandlePool::Handle device;
+    HIDInputListener listener;
+    const DeviceKind kind;
+    const int priority;
+    // Table row of the connected product; nullptr while disconnected
+    const DeviceDescriptor *descriptor = nullptr;
+    wstring currentPath;
+    // cmd_id of the last response seen on this handle (0 = unknown)
+    BYTE lastEcho = 0;
+
+    // Attribute values kept between reads, due again according to schedule
+    std::optional<bool> cachedCharging;
+    std::map<BYTE, vector<BYTE>> telemetry;
+    AttributeSchedule schedule;
+
+    static inline bool commandQueue = false;
+    static inline std::chrono::seconds chargingRefresh{1800};
+    static inline vector<TelemetrySpec> telemetrySpecs;
 };
+
+// The protocol code frames reports with the class constants and the command queue reads the level
+// from the first payload byte; every VAXEE row has to agree
+constexpr bool VaxeeRowsMatchProtocol()
+{
+    for (const auto &row : DEVICE_DESCRIPTORS)
+    {
+        if (row.family == DeviceFamily::Vaxee &&
+            (row.vid != VaxeeDevice::VID || row.usagePage != VaxeeDevice::USAGE_PAGE ||
+             row.usage != VaxeeDevice::USAGE || row.reportId != VaxeeDevice::REPORT_ID ||
+             row.levelOffset != VaxeeCommandQueue::DATA_OFFSET))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(VaxeeRowsMatchProtocol(), "VAXEE device table rows disagree with the protocol constants");
@@ -30,6 +30,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         }
         return 0;
 
+    case Constants::WM_HID_COMPLETION:
+        app.onHidCompletion();
+        return 0;
+
+    case Constants::WM_STATUS_CHANGED:
+        app.onStatusChanged();
+        return 0;
+
     case WM_COMMAND:
         app.onMenuCommand(LOWORD(wParam));
         return 0;
@@ -38,6 +46,11 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         app.onTimer(wParam);
         return 0;
 
+    case WM_INPUT:
+        app.onRawInput(lParam);
+        // The system cleans up the input data only through DefWindowProc
+        return DefWindowProc(hwnd, msg, wParam, lParam);
+
     case WM_DEVICECHANGE:
         app.onDeviceChange(wParam, lParam);
         return 0;
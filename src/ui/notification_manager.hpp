@@ -2,6 +2,7 @@
 
 #include <string>
 #include <sstream>
+#include <set>
 #include "tray_icon.hpp"
 #include "core/logger.hpp"
 
@@ -28,14 +29,20 @@ public:
         enabled = value;
     }
 
+    // Warns once per device until its battery recovers past the threshold
     void checkLowBattery(int percentage, bool charging, const wstring &deviceName)
     {
+        if (percentage > threshold + 5)
+        {
+            notifiedDevices.erase(deviceName);
+        }
+
         if (!enabled || !trayIcon || percentage > threshold || percentage <= 0 || charging)
         {
             return;
         }
 
-        if (!notificationShown)
+        if (notifiedDevices.insert(deviceName).second)
         {
             wstringstream title;
             title << deviceName << L" - Low Battery";
@@ -44,14 +51,8 @@ public:
             msg << L"Battery at " << percentage << L"%";
 
             trayIcon->showNotification(title.str(), msg.str());
-            notificationShown = true;
             LOG_INFO("Low battery notification shown");
         }
-
-        if (percentage > threshold + 5)
-        {
-            notificationShown = false;
-        }
     }
 
     void triggerTestNotification(int percentage, const wstring &deviceName)
@@ -81,12 +82,12 @@ public:
 
     void reset()
     {
-        notificationShown = false;
+        notifiedDevices.clear();
     }
 
 private:
     TrayIcon *trayIcon = nullptr;
     int threshold = 20;
     bool enabled = true;
-    bool notificationShown = false;
+    std::set<wstring> notifiedDevices;
 };
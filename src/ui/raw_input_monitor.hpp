@@ -0,0 +1,110 @@
+#pragma once
+
+#include <windows.h>
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "core/hid_path.hpp"
+#include "core/logger.hpp"
+#include "devices/device_registry.hpp"
+#include "devices/device_table.hpp"
+
+using std::wstring;
+
+// Raw Input (WM_INPUT) from mice, reduced to "a supported mouse was used". Registered only while
+// it is needed, since every mouse movement is then delivered to the window; the device of each
+// message is matched by the (VID, PID) in its interface path against the device table, once per
+// device handle.
+class RawInputMonitor
+{
+public:
+    RawInputMonitor() = default;
+
+    RawInputMonitor(const RawInputMonitor &) = delete;
+    RawInputMonitor &operator=(const RawInputMonitor &) = delete;
+
+    // Receives mouse input in the background, also while another window has focus
+    bool start(HWND hwnd)
+    {
+        if (registered)
+        {
+            return true;
+        }
+        RAWINPUTDEVICE device = {USAGE_PAGE_GENERIC, USAGE_MOUSE, RIDEV_INPUTSINK, hwnd};
+        if (!RegisterRawInputDevices(&device, 1, sizeof(device)))
+        {
+            LOG_ERROR("RegisterRawInputDevices failed: " + std::to_string(GetLastError()));
+            return false;
+        }
+        registered = true;
+        LOG_DEBUG("Raw input: watching for mouse activity");
+        return true;
+    }
+
+    void stop()
+    {
+        if (!registered)
+        {
+            return;
+        }
+        RAWINPUTDEVICE device = {USAGE_PAGE_GENERIC, USAGE_MOUSE, RIDEV_REMOVE, nullptr};
+        RegisterRawInputDevices(&device, 1, sizeof(device));
+        registered = false;
+        LOG_DEBUG("Raw input: stopped");
+    }
+
+    bool isRunning() const { return registered; }
+
+    // lParam of a WM_INPUT message; true if it came from a supported mouse
+    bool isSupportedDevice(LPARAM lParam)
+    {
+        RAWINPUTHEADER header = {};
+        UINT size = sizeof(header);
+        if (GetRawInputData(reinterpret_cast<HRAWINPUT>(lParam), RID_HEADER, &header, &size,
+                            sizeof(RAWINPUTHEADER)) == static_cast<UINT>(-1) ||
+            !header.hDevice)
+        {
+            return false;
+        }
+
+        auto known = devices.find(header.hDevice);
+        if (known == devices.end())
+        {
+            known = devices.emplace(header.hDevice, matchesProduct(header.hDevice)).first;
+        }
+        return known->second;
+    }
+
+private:
+    // Generic Desktop page, mouse usage (hidusage.h)
+    static constexpr USHORT USAGE_PAGE_GENERIC = 0x01;
+    static constexpr USHORT USAGE_MOUSE = 0x02;
+
+    bool registered = false;
+    // Raw input device handle -> a supported product
+    std::map<HANDLE, bool> devices;
+
+    static bool matchesProduct(HANDLE device)
+    {
+        UINT length = 0;
+        if (GetRawInputDeviceInfoW(device, RIDI_DEVICENAME, nullptr, &length) != 0 || length == 0)
+        {
+            return false;
+        }
+        wstring name(length, L'\0');
+        if (GetRawInputDeviceInfoW(device, RIDI_DEVICENAME, name.data(), &length) == static_cast<UINT>(-1))
+        {
+            return false;
+        }
+
+        const auto parsed = HIDPath::Parse(name.c_str());
+        if (!parsed || !DeviceTable::Find(parsed->vid, parsed->pid))
+        {
+            return false;
+        }
+        // Families left out of the build are not read, so their input must not trigger a read
+        const auto vendors = RegisteredDeviceSet::VendorIds();
+        return std::find(vendors.begin(), vendors.end(), parsed->vid) != vendors.end();
+    }
+};
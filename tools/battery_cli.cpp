@@ -0,0 +1,367 @@
+// Command-line front end for the device core. Runs the same DeviceManager and protocol code as
+// the tray application without any UI, which makes it usable on Linux (hidraw transport) for
+// profiling and load testing.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include "core/device_manager.hpp"
+#include "core/connection_state.hpp"
+#include "core/retry_policy.hpp"
+#include "core/logger.hpp"
+#ifndef _WIN32
+#include "core/evdev_activity.hpp"
+#endif
+
+using std::string;
+using std::vector;
+
+static void PrintUsage()
+{
+    std::cout << "Usage: battery_cli [--watch SECONDS] [--record DIRECTORY] [--listen] [--all] [--telemetry SPEC]\n"
+              << "                   [--retry-stats] [--jitter READS] [--endgame-adaptive] [--vaxee-queue]\n"
+              << "                   [--debug]\n"
+              << "  --watch SECONDS     Keep polling at the given interval; a sleeping mouse is read again\n"
+              << "                      once it is used (evdev, Linux) or after its sleep backoff\n"
+              << "  --record DIRECTORY  Write a HID trace per device session (see battery_replay)\n"
+              << "  --listen            Print status input reports as the device sends them\n"
+              << "  --all               Read every attached supported device, in parallel\n"
+              << "  --telemetry SPEC    Also read VAXEE attributes, as name:cmd_id:refresh_seconds,...;\n"
+              << "                      implies --vaxee-queue\n"
+              << "  --retry-stats       Print attempts-to-success histograms and failure counts after each poll\n"
+              << "  --jitter READS      Read the battery READS times while timing the mouse's input reports\n"
+              << "                      (evdev, Linux); keep moving the mouse meanwhile\n"
+              << "  --endgame-adaptive  Use the adaptive Endgame Gear read cycle (unverified on hardware;\n"
+              << "                      combine with --record to capture traces of it)\n"
+              << "  --vaxee-queue       Use the VAXEE command queue (unverified on hardware; combine with\n"
+              << "                      --record to capture traces of it)\n"
+              << "  --debug             Enable debug logging to the console\n";
+}
+
+static string Narrow(std::wstring_view text)
+{
+    return string(text.begin(), text.end());
+}
+
+#ifndef _WIN32
+// Input-report gaps longer than this are pauses in the motion, not jitter
+static constexpr std::chrono::milliseconds JITTER_MAX_GAP{50};
+// Gaps this close before or after a feature-report transaction form its baseline
+static constexpr std::chrono::milliseconds JITTER_WINDOW{250};
+static constexpr std::chrono::milliseconds JITTER_READ_GAP{1000};
+
+static double Percentile(vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[(std::min)(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+static void PrintGaps(const char *label, const vector<double> &gapsUs)
+{
+    std::cout << std::fixed << std::setprecision(0)
+              << label << " gaps " << gapsUs.size() << "  p50 " << Percentile(gapsUs, 0.50)
+              << " us  p99 " << Percentile(gapsUs, 0.99) << " us  max "
+              << (gapsUs.empty() ? 0.0 : *std::max_element(gapsUs.begin(), gapsUs.end())) << " us" << std::endl;
+}
+
+// Reads the battery `reads` times while a thread records the input-report timestamps of the
+// supported mice, per evdev node, then compares the gaps between consecutive reports of one node
+// that overlap a feature-report transaction with those just before and after one
+static int MeasureJitter(DeviceManager &deviceManager, int reads)
+{
+    using Clock = EvdevActivityMonitor::Clock;
+    EvdevActivityMonitor monitor;
+    if (monitor.Open(RegisteredDeviceSet::VendorIds()) == 0)
+    {
+        std::cout << "No readable input device of a supported mouse in /dev/input" << std::endl;
+        return 1;
+    }
+    if (!deviceManager.IsConnected() && !deviceManager.FindAndConnect())
+    {
+        std::cout << "No supported device found" << std::endl;
+        return 1;
+    }
+
+    // Report timestamps per node; the recorder owns it until it is joined
+    std::map<int, vector<Clock::time_point>> frames;
+    std::atomic<bool> stop{false};
+    std::thread recorder([&]
+                         {
+                             while (!stop && monitor.IsOpen())
+                             {
+                                 monitor.ReadFrames(frames, std::chrono::milliseconds(100));
+                             } });
+
+    std::cout << "Move the mouse continuously during the next " << reads << " s" << std::endl;
+    vector<std::pair<Clock::time_point, Clock::time_point>> transactions;
+    vector<double> readMs;
+    size_t failed = 0;
+    for (int i = 0; i < reads; ++i)
+    {
+        std::this_thread::sleep_for(JITTER_READ_GAP);
+        const auto start = Clock::now();
+        failed += deviceManager.ReadBattery().percentage < 0 ? 1 : 0;
+        const auto end = Clock::now();
+        transactions.emplace_back(start, end);
+        readMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::this_thread::sleep_for(JITTER_WINDOW * 2);
+    stop = true;
+    recorder.join();
+
+    if (monitor.HangUps() > 0)
+    {
+        std::cout << "An input device went away during the measurement; recording stopped, no statistics"
+                  << std::endl;
+        return 1;
+    }
+
+    vector<double> during;
+    vector<double> around;
+    size_t reports = 0;
+    for (auto &[fd, stream] : frames)
+    {
+        reports += stream.size();
+        std::sort(stream.begin(), stream.end());
+        for (size_t i = 1; i < stream.size(); ++i)
+        {
+            const auto from = stream[i - 1];
+            const auto to = stream[i];
+            if (to - from > JITTER_MAX_GAP)
+            {
+                continue;
+            }
+            const double gapUs = std::chrono::duration<double, std::micro>(to - from).count();
+            for (const auto &[start, end] : transactions)
+            {
+                if (from < end && to > start)
+                {
+                    during.push_back(gapUs);
+                    break;
+                }
+                if ((to <= start && from >= start - JITTER_WINDOW) || (from >= end && to <= end + JITTER_WINDOW))
+                {
+                    around.push_back(gapUs);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::cout << Narrow(deviceManager.GetDeviceName()) << ": " << reads << " reads, " << failed
+              << " failed, read p50 " << std::fixed << std::setprecision(1) << Percentile(readMs, 0.50)
+              << " ms, " << reports << " input reports from " << frames.size() << " input nodes" << std::endl;
+    PrintGaps("  around reads ", around);
+    PrintGaps("  during reads ", during);
+    return 0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+    int watchSeconds = 0;
+    bool debug = false;
+    bool listen = false;
+    bool all = false;
+    bool retryStats = false;
+    int jitterReads = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (arg == "--watch" && i + 1 < argc)
+        {
+            watchSeconds = std::stoi(argv[++i]);
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            HIDTraceWriter::SetDirectory(argv[++i]);
+        }
+        else if (arg == "--listen")
+        {
+            listen = true;
+        }
+        else if (arg == "--all")
+        {
+            all = true;
+        }
+#ifndef MBM_NO_VAXEE
+        else if (arg == "--telemetry" && i + 1 < argc)
+        {
+            VaxeeDevice::SetTelemetryAttributes(VaxeeDevice::ParseTelemetrySpecs(argv[++i]));
+            VaxeeDevice::SetCommandQueue(true);
+        }
+        else if (arg == "--vaxee-queue")
+        {
+            VaxeeDevice::SetCommandQueue(true);
+        }
+#endif
+#ifndef MBM_NO_ENDGAME_GEAR
+        else if (arg == "--endgame-adaptive")
+        {
+            EndgameGearDevice::SetAdaptiveRead(true);
+        }
+#endif
+        else if (arg == "--retry-stats")
+        {
+            retryStats = true;
+        }
+        else if (arg == "--jitter" && i + 1 < argc)
+        {
+            jitterReads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--debug")
+        {
+            debug = true;
+        }
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::Instance().SetDebugMode(debug);
+    Logger::Instance().SetLogFile("battery_cli.log");
+
+    DeviceManager deviceManager;
+    if (listen)
+    {
+        deviceManager.SetStatusHandler([](const MouseDevice::StatusUpdate &update)
+                                       {
+                                           std::cout << "Input report:";
+                                           if (update.percentage)
+                                               std::cout << " " << *update.percentage << "%";
+                                           if (update.isCharging)
+                                               std::cout << (*update.isCharging ? " charging" : " not charging");
+                                           std::cout << std::endl; });
+    }
+
+    if (all)
+    {
+        deviceManager.EnableMultiDevice();
+    }
+
+    if (jitterReads > 0)
+    {
+#ifndef _WIN32
+        return MeasureJitter(deviceManager, jitterReads);
+#else
+        std::cout << "--jitter needs the evdev input devices of Linux" << std::endl;
+        return 1;
+#endif
+    }
+
+    ConnectionSupervisor connection(deviceManager);
+    bool hasStatus = false;
+#ifndef _WIN32
+    EvdevActivityMonitor activity;
+#endif
+
+    do
+    {
+        if (all)
+        {
+            deviceManager.ConnectAll();
+            const auto start = std::chrono::steady_clock::now();
+            const auto readings = deviceManager.ReadAll();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+            if (readings.empty())
+            {
+                std::cout << "No supported device found" << std::endl;
+            }
+            for (const auto &reading : readings)
+            {
+                std::cout << Narrow(reading.name) << " (" << Narrow(reading.connectionMode) << "): ";
+                if (reading.status.percentage < 0)
+                {
+                    std::cout << "read failed" << std::endl;
+                    continue;
+                }
+                std::cout << reading.status.percentage << "%" << (reading.status.isCharging ? " charging" : "")
+                          << std::endl;
+            }
+            if (!readings.empty())
+            {
+                std::cout << readings.size() << " devices read in " << elapsed.count() << " ms" << std::endl;
+            }
+        }
+        else
+        {
+            using Outcome = ConnectionSupervisor::Outcome;
+            const auto result = connection.Poll(hasStatus);
+            const auto &status = result.status;
+            if (result.outcome == Outcome::Success)
+            {
+                hasStatus = true;
+                std::cout << Narrow(deviceManager.GetDeviceName()) << " ("
+                          << Narrow(deviceManager.GetConnectionMode()) << "): "
+                          << status.percentage << "%"
+                          << (status.isCharging ? " charging" : "") << std::endl;
+                for (const auto &attribute : deviceManager.GetTelemetry())
+                {
+                    std::cout << "  " << attribute.name << ": " << attribute.value << std::endl;
+                }
+            }
+            else if (result.outcome == Outcome::Disconnected)
+            {
+                hasStatus = false;
+                std::cout << "No supported device found" << std::endl;
+            }
+            else if (result.skipped)
+            {
+                std::cout << Narrow(deviceManager.GetDeviceName()) << ": "
+                          << (result.outcome == Outcome::Sleeping ? "sleeping" : "backing off")
+                          << ", read skipped" << std::endl;
+            }
+            else
+            {
+                std::cout << Narrow(deviceManager.GetDeviceName()) << ": read failed"
+                          << (result.outcome == Outcome::Sleeping ? " (sleeping)" : "") << std::endl;
+            }
+        }
+
+        if (retryStats)
+        {
+            for (const auto &entry : RetryStats::Instance().Snapshot())
+            {
+                std::cout << "Retries " << RetryStats::Format(entry) << std::endl;
+            }
+        }
+
+        if (watchSeconds > 0)
+        {
+            const std::chrono::seconds interval(watchSeconds);
+#ifndef _WIN32
+            // Input from the sleeping mouse ends both this wait and its sleep backoff
+            if (!all && connection.Machine().GetState() == ConnectionStateMachine::State::Sleeping)
+            {
+                if (!activity.IsOpen())
+                {
+                    activity.Open(RegisteredDeviceSet::VendorIds());
+                }
+                if (activity.WaitForActivity(interval) && connection.OnActivity())
+                {
+                    std::cout << "Mouse activity - reading now" << std::endl;
+                }
+                continue;
+            }
+            activity.Close();
+#endif
+            std::this_thread::sleep_for(interval);
+        }
+    } while (watchSeconds > 0);
+
+    return 0;
+}
@@ -0,0 +1,398 @@
+// Replays recorded HID traces (see hid_trace_dir / battery_cli --record) through the unmodified
+// DeviceManager and protocol code, or with --worker through the tray app's DeviceWorker. Built
+// with MBM_HID_REPLAY so HIDTransport is the replay transport; with --speed 0 (the default)
+// thousands of sessions run in seconds. --generate writes synthetic traces to replay.
+
+#define MBM_HID_REPLAY
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <random>
+#include "core/device_manager.hpp"
+#include "core/device_worker.hpp"
+#include "core/hid_trace.hpp"
+#include "core/retry_policy.hpp"
+#include "core/logger.hpp"
+
+using std::string;
+using std::vector;
+using std::wstring;
+namespace fs = std::filesystem;
+
+static void PrintUsage()
+{
+    std::cout << "Usage: battery_replay [--speed FACTOR] [--listen | --worker] [--quiet] [--debug] TRACE|DIRECTORY...\n"
+              << "       battery_replay --generate battery|input|stall DIRECTORY [--sessions N] [--seed N]\n"
+              << "  --vaxee-queue   Sessions use the VAXEE command queue, as recorded with\n"
+              << "                  battery_cli --vaxee-queue (both when generating and replaying)\n"
+              << "  --speed FACTOR  1 = recorded timing, 10 = ten times faster, 0 = no waiting (default)\n"
+              << "  --listen        Run the input-report listener on the recorded input reports\n"
+              << "  --worker        Read through DeviceWorker (engine thread, connection supervisor,\n"
+              << "                  published snapshot) as the tray app does, instead of DeviceManager\n"
+              << "  --generate KIND Write synthetic VAXEE dongle sessions (default 500 battery, 50 input\n"
+              << "                  or 1 stall session) to DIRECTORY instead of replaying\n"
+              << "  --quiet         Only print the summary\n"
+              << "  --debug         Enable debug logging to the console\n";
+}
+
+static string Narrow(std::wstring_view text)
+{
+    return string(text.begin(), text.end());
+}
+
+// Synthetic sessions for --generate, in the layout battery_cli --record writes for a VAXEE
+// dongle: a battery session reads the level and the charging flag, answered after a jittered
+// delay (with the command queue, after reading the still empty response slot); an input session
+// also carries unsolicited level and charging reports (and one the listener ignores) for
+// --listen; in a stall session the first Get hits the 1 s deadline.
+static constexpr USHORT GENERATED_PID = 0x1001;
+static constexpr int GENERATED_BATTERY_SESSIONS = 500;
+static constexpr int GENERATED_INPUT_SESSIONS = 50;
+static constexpr BYTE GENERATED_IGNORED_CMD = 0x33;
+
+struct GeneratedSession
+{
+    std::unique_ptr<HIDTraceWriter> writer;
+    HIDTraceWriter::Clock::time_point at;
+
+    // Appends a record that took `duration` and moves the session clock past it
+    void Append(HIDTraceOp op, HIDIoResult result, std::initializer_list<BYTE> bytes,
+                std::chrono::microseconds duration)
+    {
+        BYTE report[VaxeeDevice::REPORT_SIZE] = {};
+        std::copy(bytes.begin(), bytes.end(), report);
+        writer->Append(op, result, report, sizeof(report), at, at + duration);
+        at += duration;
+    }
+
+    void Command(BYTE cmd, BYTE value, std::chrono::microseconds answer)
+    {
+        using VD = VaxeeDevice;
+        Append(HIDTraceOp::Send, HIDIoResult::Ok, {VD::REPORT_ID, VD::HEADER, cmd, VD::CMD_READ, 0x01},
+               std::chrono::microseconds(1500));
+        Append(HIDTraceOp::Get, HIDIoResult::Ok, {VD::REPORT_ID, VD::HEADER, cmd, VD::CMD_READ, 0x01, value}, answer);
+    }
+
+    // The command queue reads the slot once after connecting, before it sends anything
+    void EmptySlot()
+    {
+        Append(HIDTraceOp::Get, HIDIoResult::Ok, {VaxeeDevice::REPORT_ID}, std::chrono::microseconds(1500));
+    }
+
+    void Input(BYTE cmd, BYTE value)
+    {
+        using VD = VaxeeDevice;
+        Append(HIDTraceOp::Input, HIDIoResult::Ok, {VD::REPORT_ID, VD::HEADER, cmd, 0x00, 0x00, value},
+               std::chrono::microseconds(1000));
+    }
+};
+
+static int Generate(const string &kind, const string &directory, int sessions, uint32_t seed, bool queued)
+{
+    if (kind != "battery" && kind != "input" && kind != "stall")
+    {
+        PrintUsage();
+        return 1;
+    }
+    if (sessions <= 0)
+    {
+        sessions = kind == "battery" ? GENERATED_BATTERY_SESSIONS : kind == "input" ? GENERATED_INPUT_SESSIONS : 1;
+    }
+
+    HIDTraceWriter::SetDirectory(directory);
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> answerMs(20, 140);
+    using VD = VaxeeDevice;
+    for (int n = 0; n < sessions; ++n)
+    {
+        GeneratedSession session{HIDTraceWriter::Create(DeviceInfo{L"generated", VD::VID, GENERATED_PID, VD::USAGE_PAGE, VD::USAGE}),
+                                 HIDTraceWriter::Clock::now()};
+        if (!session.writer)
+        {
+            std::cerr << "Cannot write traces to " << directory << std::endl;
+            return 1;
+        }
+
+        const BYTE level = static_cast<BYTE>(n % 21); // 0-100 % in 5 % steps
+        const BYTE charging = static_cast<BYTE>(n % 2);
+        if (kind == "stall")
+        {
+            if (!queued)
+            {
+                session.Append(HIDTraceOp::Send, HIDIoResult::Ok,
+                               {VD::REPORT_ID, VD::HEADER, VD::CMD_BATTERY_LEVEL, VD::CMD_READ, 0x01},
+                               std::chrono::microseconds(1500));
+            }
+            session.Append(HIDTraceOp::Get, HIDIoResult::Timeout, {VD::REPORT_ID}, std::chrono::milliseconds(1000));
+            continue;
+        }
+        if (kind == "input")
+        {
+            session.Input(VD::CMD_BATTERY_LEVEL, level);
+        }
+        if (queued)
+        {
+            session.EmptySlot();
+        }
+        session.Command(VD::CMD_BATTERY_LEVEL, level, std::chrono::milliseconds(answerMs(random)));
+        if (kind == "input")
+        {
+            session.Input(VD::CMD_CHARGING_STATUS, charging);
+        }
+        session.Command(VD::CMD_CHARGING_STATUS, charging, std::chrono::milliseconds(answerMs(random)));
+        if (kind == "input")
+        {
+            session.Input(GENERATED_IGNORED_CMD, 1);
+        }
+    }
+    std::cout << "Wrote " << sessions << " " << kind << " sessions to " << directory << std::endl;
+    return 0;
+}
+
+static void CollectTraces(const fs::path &path, vector<string> &traces)
+{
+    std::error_code ec;
+    if (fs::is_directory(path, ec))
+    {
+        for (const auto &entry : fs::recursive_directory_iterator(path, ec))
+        {
+            if (entry.is_regular_file() && entry.path().extension() == ".mbmt")
+            {
+                traces.push_back(entry.path().string());
+            }
+        }
+    }
+    else
+    {
+        traces.push_back(path.string());
+    }
+}
+
+// What one replayed session produced
+struct SessionResult
+{
+    bool connected = false;
+    wstring name;
+    MouseDevice::BatteryStatus status;
+    bool timedOut = false;
+    size_t recycled = 0;
+};
+
+static SessionResult ReadThroughManager(bool listen, std::atomic<size_t> &inputUpdates)
+{
+    SessionResult result;
+    DeviceManager deviceManager;
+    if (listen)
+    {
+        deviceManager.SetStatusHandler([&inputUpdates](const MouseDevice::StatusUpdate &)
+                                       { ++inputUpdates; });
+    }
+
+    result.connected = deviceManager.FindAndConnect();
+    if (!result.connected)
+    {
+        return result;
+    }
+    result.status = deviceManager.ReadBattery();
+    result.name = deviceManager.GetDeviceName();
+    result.timedOut = deviceManager.LastReadTimedOut();
+    result.recycled = deviceManager.GetRecycleCount();
+
+    // The listener ends on its own once the trace has no input reports left
+    while (deviceManager.IsStatusListenerRunning())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return result;
+}
+
+// The tray app's path: the device is connected on the engine thread as after an arrival, then
+// read by a query whose status comes back through the published snapshot and a completion on
+// this thread, like BatteryMonitor's
+static SessionResult ReadThroughWorker()
+{
+    SessionResult result;
+    bool done = false;
+    DeviceWorker worker;
+    worker.Start(nullptr, nullptr);
+    worker.Run([&worker, &result, &done](DeviceManager &deviceManager)
+               {
+                   const bool connected = deviceManager.FindAndConnect();
+                   worker.Complete([&result, &done, connected]
+                                   {
+                                       result.connected = connected;
+                                       done = !connected; }); });
+    while (!done && !result.connected)
+    {
+        worker.DrainCompletions();
+        std::this_thread::yield();
+    }
+
+    if (result.connected)
+    {
+        worker.Query(std::chrono::milliseconds(0), [&worker, &result, &done]
+                     {
+                         const auto shown = worker.Snapshot().shown;
+                         result.status.percentage = shown.percentage;
+                         result.status.isCharging = shown.isCharging;
+                         worker.Run([&worker, &result, &done](DeviceManager &deviceManager)
+                                    {
+                                        const wstring name(deviceManager.GetDeviceName());
+                                        const bool timedOut = deviceManager.LastReadTimedOut();
+                                        const size_t recycled = deviceManager.GetRecycleCount();
+                                        worker.Complete([&result, &done, name, timedOut, recycled]
+                                                        {
+                                                            result.name = name;
+                                                            result.timedOut = timedOut;
+                                                            result.recycled = recycled;
+                                                            done = true; }); }); });
+        while (!done)
+        {
+            worker.DrainCompletions();
+            std::this_thread::yield();
+        }
+    }
+    worker.Stop();
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> traces;
+    bool quiet = false;
+    bool listen = false;
+    bool debug = false;
+    bool throughWorker = false;
+    bool queued = false;
+    double speed = 0.0;
+    string generateKind;
+    string generateDirectory;
+    int sessions = 0;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (arg == "--speed" && i + 1 < argc)
+        {
+            speed = std::stod(argv[++i]);
+        }
+        else if (arg == "--listen")
+        {
+            listen = true;
+        }
+        else if (arg == "--worker")
+        {
+            throughWorker = true;
+        }
+        else if (arg == "--vaxee-queue")
+        {
+            queued = true;
+        }
+        else if (arg == "--generate" && i + 2 < argc)
+        {
+            generateKind = argv[++i];
+            generateDirectory = argv[++i];
+        }
+        else if (arg == "--sessions" && i + 1 < argc)
+        {
+            sessions = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--quiet")
+        {
+            quiet = true;
+        }
+        else if (arg == "--debug")
+        {
+            debug = true;
+        }
+        else if (arg == "--help" || arg.compare(0, 2, "--") == 0)
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else
+        {
+            CollectTraces(arg, traces);
+        }
+    }
+
+    if (!generateKind.empty())
+    {
+        return Generate(generateKind, generateDirectory, sessions, seed, queued);
+    }
+    if (traces.empty() || (listen && throughWorker))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::sort(traces.begin(), traces.end());
+    Logger::Instance().SetDebugMode(debug);
+    Logger::Instance().SetLogFile("battery_replay.log");
+    HIDReplayTransport::SetSpeed(speed);
+    VaxeeDevice::SetCommandQueue(queued);
+
+    size_t valid = 0;
+    size_t failed = 0;
+    size_t unmatched = 0;
+    size_t recycled = 0;
+    std::atomic<size_t> inputUpdates{0};
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto &trace : traces)
+    {
+        HIDReplayTransport::SetSources({trace});
+        const SessionResult session = throughWorker ? ReadThroughWorker() : ReadThroughManager(listen, inputUpdates);
+        if (!session.connected)
+        {
+            ++unmatched;
+            if (!quiet)
+                std::cout << trace << ": no supported device in trace" << std::endl;
+            continue;
+        }
+
+        if (session.status.percentage < 0)
+        {
+            ++failed;
+            if (!quiet)
+                std::cout << trace << ": " << Narrow(session.name)
+                          << (session.timedOut ? " read timed out" : " read failed") << std::endl;
+        }
+        else
+        {
+            ++valid;
+            if (!quiet)
+                std::cout << trace << ": " << Narrow(session.name) << " " << session.status.percentage << "%"
+                          << (session.status.isCharging ? " charging" : "") << std::endl;
+        }
+        recycled += session.recycled;
+    }
+
+    const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+
+    std::cout << traces.size() << " sessions: " << valid << " valid, " << failed << " failed, "
+              << unmatched << " unmatched, " << HIDReplayTransport::GetMismatchCount()
+              << " replay mismatches, " << recycled << " handles recycled after timeouts";
+    if (listen)
+    {
+        std::cout << ", " << inputUpdates << " input status updates";
+    }
+    std::cout << " in " << elapsedMs << " ms" << std::endl;
+    for (const auto &entry : RetryStats::Instance().Snapshot())
+    {
+        std::cout << "  retries " << RetryStats::Format(entry) << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,1811 @@
+// Runs the Endgame Gear and VAXEE read cycles against timing models of the devices (see
+// docs/ENDGAME.md, "Timing", and docs/VAXEE.md, "Command queue") and reports read latency and
+// reports sent for the fixed and optimized cycles of each. Built with MBM_HID_SIM so
+// HIDTransport is the simulated transport; protocol delays advance a virtual clock, so thousands
+// of reads take milliseconds of wall time.
+
+#define MBM_HID_SIM
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <cstdint>
+#include "core/device_manager.hpp"
+#include "core/connection_state.hpp"
+#include "core/device_worker.hpp"
+#include "core/poll_scheduler.hpp"
+#include "core/idle_gate.hpp"
+#include "core/settle_tracker.hpp"
+#include "core/retry_policy.hpp"
+#include "core/logger.hpp"
+
+using std::string;
+using std::vector;
+
+static void PrintUsage()
+{
+    std::cout << "Usage: battery_sim [--device endgame|vaxee] [--reads N] [--awake-ratio R] [--seed N]\n"
+              << "                  [--telemetry SPEC] [--bench-dispatch N] [--bench-enumeration N]\n"
+              << "                  [--stress-snapshot N] [--engine N [--call-latency US]]\n"
+              << "                  [--first-read N [--settle MS]] [--input-reports N] [--stall TICKS]\n"
+              << "                  [--poll-curves DAYS [--poll-min S] [--poll-max S]]\n"
+              << "                  [--idle-gate HOURS [--idle-window MS] [--idle-max S]] [--debug]\n"
+              << "  --device NAME    Simulate only this device (default: both)\n"
+              << "  --reads N        Reads per mode (default 2000)\n"
+              << "  --awake-ratio R  Share of reads issued while the device is still awake (default 0.5)\n"
+              << "  --seed N         Random seed for the device model and the read schedule\n"
+              << "  --telemetry SPEC VAXEE attributes read along with the battery (name:cmd_id:refresh_seconds,...)\n"
+              << "  --bench-dispatch N  Time N connects, reads and device calls through DeviceManager's\n"
+              << "                   dispatch instead of simulating reads\n"
+              << "  --bench-enumeration N  Connect in a HID tree with N other interfaces; reports scans,\n"
+              << "                   interface queries and time per connect, before and after the shared index\n"
+              << "  --stress-snapshot N  Load status snapshots from several threads while a device worker\n"
+              << "                   runs N cable toggles and a writer publishes N synthetic snapshots\n"
+              << "  --poll-curves DAYS  Replay synthetic discharge curves for DAYS days with a fixed\n"
+              << "                   poll interval and with adaptive polling (min/max interval in seconds)\n"
+              << "  --idle-gate HOURS  Poll through a synthetic gaming session of HOURS hours with reads\n"
+              << "                   released at once and by the idle gate (idle window in ms, limit in s),\n"
+              << "                   then the wake reads of a mouse asleep after each break of a minute\n"
+              << "  --engine N       Read N times through a device worker while every HID call blocks for\n"
+              << "                   --call-latency US (default 2000); checks that the caller never waits\n"
+              << "  --first-read N   Open each device N times on a model that comes up 5-80 ms after the\n"
+              << "                   open; time to the first valid reading with a fixed settle time of\n"
+              << "                   0 ms and --settle MS (default 100) and with the readiness probe\n"
+              << "  --input-reports N  Inject N status input reports, and malformed ones after some of\n"
+              << "                   them, into a device worker's listener; checks what is published\n"
+              << "  --stall TICKS    Query a device worker every 100 ms for TICKS ticks and wedge its handle\n"
+              << "                   a third of the way in; checks the ticks stay on time\n"
+              << "  --debug          Enable debug logging to the console\n";
+}
+
+struct RunStats
+{
+    vector<double> latenciesMs;
+    size_t failed = 0;
+    size_t wrongLevel = 0;
+    size_t wrongCharging = 0;
+    size_t sends = 0;
+    vector<RetryStats::Entry> retries;
+};
+
+static double Percentile(vector<double> values, double p)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = (std::min)(values.size() - 1, static_cast<size_t>(p * values.size()));
+    return values[index];
+}
+
+static constexpr int PLUG_INTERVAL = 40;
+
+// optimized selects the adaptive Endgame Gear cycle or the VAXEE command queue
+static RunStats RunReads(HIDSimTransport::Device simDevice, bool optimized, int reads, double awakeRatio,
+                         uint32_t seed)
+{
+    if (simDevice == HIDSimTransport::Device::Vaxee)
+    {
+        HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+        VaxeeDevice::SetCommandQueue(optimized);
+    }
+    else
+    {
+        HIDSimTransport::SetModel(HIDSimModel{}, seed);
+        EndgameGearDevice::SetAdaptiveRead(optimized);
+    }
+
+    RetryStats::Instance().Reset();
+    RetryStats::Instance().Seed(seed);
+
+    std::mt19937 schedule(seed);
+    std::bernoulli_distribution awakeGap(awakeRatio);
+    std::uniform_int_distribution<int> shortGapMs(1000, 8000);
+
+    RunStats stats;
+    DeviceManager deviceManager;
+    deviceManager.EnableNotificationTracking();
+    if (!deviceManager.FindAndConnect())
+    {
+        return stats;
+    }
+
+    for (int i = 0; i < reads; ++i)
+    {
+        // A charging cable is plugged in or pulled every PLUG_INTERVAL reads; the supported
+        // interface it brings or takes away reaches DeviceManager like a device notification
+        if (simDevice == HIDSimTransport::Device::Vaxee && i > 0 && i % PLUG_INTERVAL == 0)
+        {
+            const bool plugged = !HIDSimTransport::ExpectedCharging();
+            HIDSimTransport::SetVaxeeCharging(plugged);
+            if (plugged)
+            {
+                deviceManager.OnDeviceArrival(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+            }
+            else
+            {
+                deviceManager.OnDeviceRemoval(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+            }
+        }
+
+        // The level moves by one step on every read, so an old answer cannot pass for the new one
+        if (simDevice == HIDSimTransport::Device::Vaxee)
+        {
+            HIDSimTransport::SetVaxeeLevel(static_cast<BYTE>(20 - i % 21));
+        }
+
+        // Awake reads follow arrivals, retries and manual updates; the rest follow the 300 s poll
+        HIDSimTransport::Advance(std::chrono::milliseconds(awakeGap(schedule) ? shortGapMs(schedule) : 300000));
+
+        const auto start = HIDSimClock::now();
+        const auto status = deviceManager.ReadBattery();
+        const auto elapsed = HIDSimClock::now() - start;
+
+        if (status.percentage < 0)
+        {
+            ++stats.failed;
+            continue;
+        }
+        if (status.percentage != HIDSimTransport::ExpectedBattery())
+        {
+            ++stats.wrongLevel;
+        }
+        if (status.isCharging != HIDSimTransport::ExpectedCharging())
+        {
+            ++stats.wrongCharging;
+        }
+        stats.latenciesMs.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+    }
+    stats.sends = HIDSimTransport::GetSendCount();
+    stats.retries = RetryStats::Instance().Snapshot();
+    return stats;
+}
+
+// Polls the way BatteryMonitor does (priority check, then read) while the VAXEE cable is plugged
+// in and pulled every PLUG_INTERVAL polls, with a burst of plugging and pulling every few seconds
+// in the middle. Counts full enumerations in polls without any presence change, which must be
+// zero, and how often the switch hysteresis held back a switch during the burst.
+static void RunSwitching(int polls, uint32_t seed)
+{
+    HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    VaxeeDevice::SetCommandQueue(true);
+
+    DeviceManager deviceManager;
+    deviceManager.EnableNotificationTracking();
+    if (!deviceManager.FindAndConnect())
+    {
+        return;
+    }
+
+    const int burstStart = polls / 2;
+    const int burstEnd = burstStart + 20;
+    size_t steadyPolls = 0;
+    size_t steadyEnumerations = 0;
+    size_t failed = 0;
+    for (int i = 1; i <= polls; ++i)
+    {
+        const bool burst = i >= burstStart && i < burstEnd;
+        const bool presenceChange = burst || i % PLUG_INTERVAL == 0;
+        if (presenceChange)
+        {
+            const bool plugged = !HIDSimTransport::ExpectedCharging();
+            HIDSimTransport::SetVaxeeCharging(plugged);
+            if (plugged)
+            {
+                deviceManager.OnDeviceArrival(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+            }
+            else
+            {
+                deviceManager.OnDeviceRemoval(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+            }
+        }
+        HIDSimTransport::Advance(std::chrono::milliseconds(burst ? 2000 : 300000));
+
+        const size_t enumerationsBefore = deviceManager.GetEnumerationCount();
+        if (!deviceManager.IsConnected() && !deviceManager.FindAndConnect())
+        {
+            ++failed;
+            continue;
+        }
+        deviceManager.ShouldSwitchDevice();
+        if (deviceManager.ReadBattery().percentage < 0)
+        {
+            ++failed;
+        }
+        if (!presenceChange)
+        {
+            ++steadyPolls;
+            steadyEnumerations += deviceManager.GetEnumerationCount() - enumerationsBefore;
+        }
+    }
+
+    const auto &stats = deviceManager.GetSwitchStats();
+    std::cout << "vaxee switching  polls " << polls << "  steady " << steadyPolls
+              << "  enumerations in steady polls " << steadyEnumerations
+              << "  total " << deviceManager.GetEnumerationCount() << "  probes " << stats.probes
+              << "  switches " << stats.switches << "  deferred " << stats.deferred
+              << "  failed " << failed << std::endl;
+}
+
+// Plugs in and pulls the VAXEE charging cable every five minutes, so the active device moves
+// between the wired mouse interface and the dongle on every change. Times the connect or switch
+// of each poll on the simulated clock (the read excluded), with idle handles kept in the pool
+// and with every switch reopening its handle.
+static void RunToggle(int toggles, bool keepIdle, uint32_t seed)
+{
+    HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    VaxeeDevice::SetCommandQueue(true);
+
+    DeviceManager deviceManager;
+    deviceManager.EnableNotificationTracking();
+    deviceManager.SetKeepIdleHandles(keepIdle);
+    if (!deviceManager.FindAndConnect())
+    {
+        return;
+    }
+    const size_t opensBefore = HIDSimTransport::GetOpenCount();
+
+    vector<double> toWired;
+    vector<double> toWireless;
+    size_t wrongDevice = 0;
+    size_t failed = 0;
+    for (int i = 0; i < toggles; ++i)
+    {
+        HIDSimTransport::Advance(std::chrono::minutes(5));
+        const bool plugged = !HIDSimTransport::ExpectedCharging();
+        HIDSimTransport::SetVaxeeCharging(plugged);
+        if (plugged)
+        {
+            deviceManager.OnDeviceArrival(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+        }
+        else
+        {
+            deviceManager.OnDeviceRemoval(HIDSimTransport::SIM_VAXEE_CABLE_PATH);
+        }
+
+        const auto start = HIDSimClock::now();
+        if (deviceManager.IsConnected())
+        {
+            deviceManager.ShouldSwitchDevice();
+        }
+        else
+        {
+            deviceManager.FindAndConnect();
+        }
+        (plugged ? toWired : toWireless).push_back(std::chrono::duration<double, std::milli>(HIDSimClock::now() - start).count());
+
+        if ((deviceManager.GetConnectionMode() == L"Wired (Charging)") != plugged)
+        {
+            ++wrongDevice;
+        }
+        if (deviceManager.ReadBattery().percentage < 0)
+        {
+            ++failed;
+        }
+    }
+
+    const size_t opens = HIDSimTransport::GetOpenCount() - opensBefore;
+    std::cout << std::left << std::setw(21) << (keepIdle ? "vaxee toggle pooled" : "vaxee toggle reopen")
+              << std::right << std::fixed << std::setprecision(1)
+              << "  to wired p50 " << std::setw(6) << Percentile(toWired, 0.50) << " ms"
+              << "  to wireless p50 " << std::setw(6) << Percentile(toWireless, 0.50) << " ms"
+              << std::setprecision(2) << "  opens/toggle " << (toggles > 0 ? static_cast<double>(opens) / toggles : 0.0)
+              << "  pool hits " << deviceManager.GetHandlePoolStats().hits
+              << "  wrong device " << wrongDevice << "  failed " << failed << std::endl;
+}
+
+static constexpr int MOUSE_OFF_HOURS = 6;
+static constexpr std::chrono::seconds MOUSE_OFF_POLL_INTERVAL{60};
+
+// Poll as BatteryMonitor did before the connection state machine: every failed read without a
+// cached status reconnects
+static bool LegacyPoll(DeviceManager &deviceManager, bool hasCachedStatus)
+{
+    if (!deviceManager.IsConnected())
+    {
+        deviceManager.FindAndConnect();
+    }
+    else
+    {
+        deviceManager.ShouldSwitchDevice();
+    }
+    if (deviceManager.ReadBattery().percentage >= 0)
+    {
+        return true;
+    }
+    if (!deviceManager.LastReadTimedOut() && !(deviceManager.IsConnected() && hasCachedStatus))
+    {
+        deviceManager.Disconnect();
+        deviceManager.FindAndConnect();
+    }
+    return false;
+}
+
+// "Dongle present, mouse off": polls the Endgame Gear dongle every MOUSE_OFF_POLL_INTERVAL for
+// MOUSE_OFF_HOURS with no cached status, then switches the mouse on and measures how long the
+// first good read takes. tracking selects the tray app's notification-driven index (otherwise
+// battery_cli's rescanning one).
+static void RunMouseOff(bool stateMachine, bool tracking, uint32_t seed)
+{
+    HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    HIDSimTransport::SetMouseOn(false);
+
+    DeviceManager deviceManager;
+    if (tracking)
+    {
+        deviceManager.EnableNotificationTracking();
+    }
+    ConnectionSupervisor connection(deviceManager);
+    connection.Machine().Seed(seed);
+
+    auto poll = [&]
+    {
+        return stateMachine ? connection.Poll(false).outcome == ConnectionSupervisor::Outcome::Success
+                            : LegacyPoll(deviceManager, false);
+    };
+
+    const auto offUntil = HIDSimClock::now() + std::chrono::hours(MOUSE_OFF_HOURS);
+    while (HIDSimClock::now() < offUntil)
+    {
+        poll();
+        HIDSimTransport::Advance(MOUSE_OFF_POLL_INTERVAL);
+    }
+    const size_t scans = HIDSimTransport::GetScanCount();
+    const size_t opens = HIDSimTransport::GetOpenCount();
+    const size_t sends = HIDSimTransport::GetSendCount();
+
+    HIDSimTransport::SetMouseOn(true);
+    const auto onAt = HIDSimClock::now();
+    while (!poll() && HIDSimClock::now() - onAt < std::chrono::hours(1))
+    {
+        HIDSimTransport::Advance(MOUSE_OFF_POLL_INTERVAL);
+    }
+    const double recoverySeconds = std::chrono::duration<double>(HIDSimClock::now() - onAt).count();
+
+    const string mode = string(stateMachine ? "mouse off backoff" : "mouse off legacy") + (tracking ? " app" : " cli");
+    std::cout << std::left << std::setw(21) << mode << std::right << std::fixed << std::setprecision(1)
+              << "  rescans/h " << std::setw(5) << static_cast<double>(scans) / MOUSE_OFF_HOURS
+              << "  opens/h " << std::setw(5) << static_cast<double>(opens) / MOUSE_OFF_HOURS
+              << "  sends/h " << std::setw(6) << static_cast<double>(sends) / MOUSE_OFF_HOURS
+              << "  first read " << std::setprecision(0) << recoverySeconds << " s after power-on";
+    if (stateMachine)
+    {
+        const auto &machine = connection.Machine();
+        std::cout << "  backoffs " << machine.GetTransitionCount(ConnectionStateMachine::State::Backoff);
+    }
+    std::cout << std::endl;
+}
+
+enum class SleepMode
+{
+    Every,   // every poll reads, as before the sleep backoff
+    Backoff, // sleep backoff, woken only by its own probes
+    Wake     // sleep backoff, and input activity at power-on ends it
+};
+
+// "Mouse asleep": one good read of the Endgame Gear dongle, then the mouse stops answering for
+// MOUSE_OFF_HOURS while polls run every MOUSE_OFF_POLL_INTERVAL with its status cached. Returns
+// the feature reports sent per idle hour; everyBaseline, the Every run's, gives those avoided.
+static double RunMouseAsleep(SleepMode mode, double everyBaseline, uint32_t seed)
+{
+    HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    HIDSimTransport::SetMouseOn(true);
+
+    DeviceManager deviceManager;
+    deviceManager.EnableNotificationTracking();
+    ConnectionSupervisor connection(deviceManager);
+    connection.Machine().Seed(seed);
+    connection.Machine().SetSleepBackoff(mode != SleepMode::Every);
+    connection.Poll(false);
+
+    HIDSimTransport::SetMouseOn(false);
+    const size_t sendsBefore = HIDSimTransport::GetSendCount();
+    const auto offUntil = HIDSimClock::now() + std::chrono::hours(MOUSE_OFF_HOURS);
+    while (HIDSimClock::now() < offUntil)
+    {
+        connection.Poll(true);
+        HIDSimTransport::Advance(MOUSE_OFF_POLL_INTERVAL);
+    }
+    const double sendsPerHour = static_cast<double>(HIDSimTransport::GetSendCount() - sendsBefore) / MOUSE_OFF_HOURS;
+    const size_t skipped = connection.GetSkippedSleepReads();
+
+    HIDSimTransport::SetMouseOn(true);
+    if (mode == SleepMode::Wake)
+    {
+        connection.OnActivity();
+    }
+    const auto onAt = HIDSimClock::now();
+    while (connection.Poll(true).outcome != ConnectionSupervisor::Outcome::Success &&
+           HIDSimClock::now() - onAt < std::chrono::hours(2))
+    {
+        HIDSimTransport::Advance(MOUSE_OFF_POLL_INTERVAL);
+    }
+    const double wakeSeconds = std::chrono::duration<double>(HIDSimClock::now() - onAt).count();
+
+    const char *name = mode == SleepMode::Every ? "mouse asleep every" : mode == SleepMode::Backoff ? "mouse asleep backoff" : "mouse asleep wake";
+    std::cout << std::left << std::setw(21) << name << std::right << std::fixed << std::setprecision(1)
+              << "  sends/h " << std::setw(6) << sendsPerHour
+              << "  avoided/h " << std::setw(6) << (mode == SleepMode::Every ? 0.0 : everyBaseline - sendsPerHour)
+              << "  reads skipped/h " << std::setw(5) << static_cast<double>(skipped) / MOUSE_OFF_HOURS
+              << "  first read " << std::setprecision(0) << wakeSeconds << " s after wake" << std::endl;
+    return sendsPerHour;
+}
+
+static void PrintStats(const char *mode, const RunStats &stats, int reads)
+{
+    std::cout << std::left << std::setw(16) << mode << std::right << std::fixed << std::setprecision(1)
+              << " p50 " << std::setw(7) << Percentile(stats.latenciesMs, 0.50) << " ms"
+              << "  p99 " << std::setw(7) << Percentile(stats.latenciesMs, 0.99) << " ms"
+              << std::setprecision(2) << "  sends/read " << (reads > 0 ? static_cast<double>(stats.sends) / reads : 0.0)
+              << "  failed " << stats.failed << "  wrong level " << stats.wrongLevel
+              << "  wrong charging " << stats.wrongCharging << std::endl;
+    for (const auto &entry : stats.retries)
+    {
+        std::cout << "  retries " << RetryStats::Format(entry) << std::endl;
+    }
+}
+
+static double NsPerOp(std::chrono::steady_clock::time_point start, int iterations)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (std::max)(1, iterations);
+}
+
+// Wall time of the DeviceManager connect and read paths against the simulated devices, and of
+// a single device call dispatched by registry slot versus through MouseDevice's vtable
+static void BenchDispatch(int iterations)
+{
+    HIDSimTransport::SetModel(HIDSimModel{}, 1);
+    HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, 1);
+
+    DeviceManager deviceManager;
+    deviceManager.EnableNotificationTracking();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        deviceManager.Disconnect();
+        deviceManager.FindAndConnect();
+    }
+    const double connectNs = NsPerOp(start, iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        deviceManager.ReadBattery();
+    }
+    const double readNs = NsPerOp(start, iterations);
+
+    RegisteredDeviceSet registry;
+    // volatile keeps the compiler from resolving the slot or the pointer at compile time
+    volatile size_t slot = RegisteredDeviceSet::ORDER[0];
+    MouseDevice *volatile virtualDevice = registry.Visit(slot, [](auto &device) -> MouseDevice *
+                                                         { return &device; });
+    size_t sink = 0;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        sink += registry.Visit(slot, [](const auto &device)
+                               { return device.GetTimeoutCount(); });
+    }
+    const double staticNs = NsPerOp(start, iterations);
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        sink += virtualDevice->GetTimeoutCount();
+    }
+    const double virtualNs = NsPerOp(start, iterations);
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "connect (DeviceManager)   " << std::setw(10) << connectNs << " ns/op\n"
+              << "read (DeviceManager)      " << std::setw(10) << readNs << " ns/op\n"
+              << "call by registry slot     " << std::setw(10) << staticNs << " ns/op\n"
+              << "call through vtable       " << std::setw(10) << virtualNs << " ns/op"
+              << (sink == SIZE_MAX ? " " : "") << std::endl;
+}
+
+// Enumeration costs for --bench-enumeration: walking one interface and querying one (open,
+// attributes, caps); assumed, not measured
+static constexpr uint32_t BENCH_WALK_US = 60;
+static constexpr uint32_t BENCH_QUERY_US = 900;
+static constexpr int BENCH_ENUMERATION_CONNECTS = 200;
+
+// Connect as the device classes did before the shared index: every supported PID, in priority
+// order, walked the whole HID tree and queried every interface until its own PID answered
+static bool LegacyConnect(HIDSimTransport &transport)
+{
+    vector<const DeviceDescriptor *> order;
+    for (const auto &descriptor : DEVICE_DESCRIPTORS)
+    {
+        order.push_back(&descriptor);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const DeviceDescriptor *a, const DeviceDescriptor *b)
+                     { return a->priority < b->priority; });
+
+    for (const DeviceDescriptor *descriptor : order)
+    {
+        HIDScanStats stats;
+        for (const auto &info : HIDSimTransport::Walk({descriptor->vid}, stats, false))
+        {
+            if (info.pid == descriptor->pid && info.usagePage == descriptor->usagePage &&
+                info.usage == descriptor->usage && transport.Open(info))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Connects to each simulated dongle BENCH_ENUMERATION_CONNECTS times in a HID tree with
+// `interfaces` other interfaces, then tries as often with no supported device attached: per-PID
+// walks as before the shared index, the index rebuilt on a miss (battery_cli) and the index kept
+// current by notifications (tray app). Enumeration and connect times are virtual; wall is the
+// CPU time of the code under test.
+static void BenchEnumeration(int interfaces)
+{
+    HIDSimTransport::SetEnumerationModel({static_cast<size_t>(interfaces), BENCH_WALK_US, BENCH_QUERY_US});
+    for (const char *target : {"endgame", "vaxee", "absent"})
+    {
+        for (const char *mode : {"per-PID walks", "index cli", "index app"})
+        {
+            if (target[0] == 'v')
+            {
+                HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, 1);
+            }
+            else
+            {
+                HIDSimTransport::SetModel(HIDSimModel{}, 1);
+            }
+            HIDSimTransport::SetDevicePresent(target[0] != 'a');
+
+            const bool legacy = mode[0] == 'p';
+            DeviceManager deviceManager;
+            if (mode[6] == 'a')
+            {
+                deviceManager.EnableNotificationTracking();
+            }
+            HIDSimTransport transport;
+            size_t connected = 0;
+            const auto virtualStart = HIDSimClock::now();
+            const auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < BENCH_ENUMERATION_CONNECTS; ++i)
+            {
+                transport.Close();
+                deviceManager.Disconnect();
+                connected += (legacy ? LegacyConnect(transport) : deviceManager.FindAndConnect()) ? 1 : 0;
+            }
+            const double wallUs = NsPerOp(start, BENCH_ENUMERATION_CONNECTS) / 1000.0;
+            const double virtualMs = std::chrono::duration<double, std::milli>(HIDSimClock::now() - virtualStart).count() /
+                                     BENCH_ENUMERATION_CONNECTS;
+            const double scanMs = std::chrono::duration<double, std::milli>(HIDSimTransport::GetEnumerationTime()).count() /
+                                  BENCH_ENUMERATION_CONNECTS;
+
+            std::cout << std::left << std::setw(22) << (string(target) + " " + mode) << std::right << std::fixed
+                      << std::setprecision(2) << "  scans/connect " << std::setw(6)
+                      << static_cast<double>(HIDSimTransport::GetScanCount()) / BENCH_ENUMERATION_CONNECTS
+                      << "  queries/connect " << std::setw(8)
+                      << static_cast<double>(HIDSimTransport::GetQueryCount()) / BENCH_ENUMERATION_CONNECTS
+                      << std::setprecision(1) << "  enumeration " << std::setw(7) << scanMs << " ms"
+                      << "  connect " << std::setw(7) << virtualMs << " ms"
+                      << "  wall " << std::setw(7) << wallUs << " us  connected " << connected << std::endl;
+        }
+    }
+    HIDSimTransport::SetEnumerationModel({});
+    HIDSimTransport::SetDevicePresent(true);
+}
+
+// Overlapping triggers against one DeviceWorker, the way the tray app issues them. Each round
+// holds the engine with a slow task (a read in flight), then queries for a fresh status (timer
+// after an arrival), from "Update Now" and from a test notification, lets the engine go, and
+// queries again from a test notification and a scheduled tick. Without single-flight and the
+// cache each round would read the device five times.
+static void RunQueries(int rounds, uint32_t seed)
+{
+    HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    VaxeeDevice::SetCommandQueue(true);
+
+    DeviceWorker worker;
+    worker.EnableNotificationTracking();
+    worker.Start(nullptr, nullptr);
+
+    using std::chrono::seconds;
+    size_t requests = 0;
+    size_t answered = 0;
+    size_t sendsBefore = HIDSimTransport::GetSendCount();
+    auto onAnswer = [&answered]
+    { ++answered; };
+    for (int i = 0; i < rounds; ++i)
+    {
+        std::atomic<bool> release{false};
+        worker.Run([&release](DeviceManager &)
+                   {
+                       while (!release)
+                       {
+                           std::this_thread::yield();
+                       } });
+        worker.Query(std::chrono::milliseconds(0), onAnswer);
+        worker.Query(seconds(2), onAnswer);
+        worker.Query(seconds(300), onAnswer);
+        release = true;
+        requests += 3;
+        while (answered < requests)
+        {
+            worker.DrainCompletions();
+            std::this_thread::yield();
+        }
+
+        worker.Query(seconds(300), onAnswer);
+        worker.Query(seconds(150), onAnswer);
+        requests += 2;
+        while (answered < requests)
+        {
+            worker.DrainCompletions();
+            std::this_thread::yield();
+        }
+    }
+    const auto stats = worker.GetQueryStats();
+    const size_t sends = HIDSimTransport::GetSendCount() - sendsBefore;
+
+    // A scheduled read may skip, so a query for a fresh status (an arrival retry) issued while one
+    // is queued reads on its own
+    std::atomic<bool> release{false};
+    worker.Run([&release](DeviceManager &)
+               {
+                   while (!release)
+                   {
+                       std::this_thread::yield();
+                   } });
+    worker.ScheduledQuery(std::chrono::milliseconds(0));
+    std::atomic<bool> updated{false};
+    worker.Query(std::chrono::milliseconds(0), [&updated]
+                 { updated = true; });
+    release = true;
+    while (!updated)
+    {
+        worker.DrainCompletions();
+        std::this_thread::yield();
+    }
+    worker.Stop();
+    const size_t behindScheduled = worker.GetQueryStats().reads - stats.reads;
+
+    std::cout << "vaxee queries  rounds " << rounds << "  requests " << requests << "  reads " << stats.reads
+              << "  joined " << stats.joined << "  cache hits " << stats.cacheHits << std::fixed << std::setprecision(2)
+              << "  reads/request " << (requests > 0 ? static_cast<double>(stats.reads) / requests : 0.0)
+              << "  sends/request " << (requests > 0 ? static_cast<double>(sends) / requests : 0.0)
+              << "  reads behind a scheduled one " << behindScheduled << std::endl;
+}
+
+// Owner thread of a DeviceWorker whose HID calls really block for callLatency each, the way a
+// slow receiver does: every read is a query from the owner, whose completion comes back through
+// the notify callback and DrainCompletions. Times how long Query takes the caller and the longest
+// the owner loop went without running (it waits up to ENGINE_OWNER_TICK for a notification, like
+// a message loop with a timer); neither may grow with the latency.
+static constexpr std::chrono::milliseconds ENGINE_OWNER_TICK{1};
+
+static void RunEngine(HIDSimTransport::Device simDevice, int reads, int latencyUs, uint32_t seed)
+{
+    using Device = HIDSimTransport::Device;
+    using std::chrono::steady_clock;
+    if (simDevice == Device::Vaxee)
+    {
+        HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+        VaxeeDevice::SetCommandQueue(true);
+    }
+    else
+    {
+        HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    }
+    HIDSimTransport::SetCallLatency(std::chrono::microseconds(latencyUs));
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool notified = false;
+    DeviceWorker worker;
+    worker.Start([&]
+                 {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     notified = true;
+                     wake.notify_one(); },
+                 nullptr);
+
+    vector<double> submitUs;
+    vector<double> readMs;
+    size_t answered = 0;
+    size_t wrong = 0;
+    size_t ownerTicks = 0;
+    double longestGapMs = 0.0;
+    const size_t callsBefore = HIDSimTransport::GetSendCount();
+    for (int i = 0; i < reads; ++i)
+    {
+        const auto start = steady_clock::now();
+        worker.Query(std::chrono::milliseconds(0), [&answered]
+                     { ++answered; });
+        auto last = steady_clock::now();
+        submitUs.push_back(std::chrono::duration<double, std::micro>(last - start).count());
+
+        while (answered < static_cast<size_t>(i) + 1)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait_for(lock, ENGINE_OWNER_TICK, [&notified]
+                              { return notified; });
+                notified = false;
+            }
+            worker.DrainCompletions();
+            const auto now = steady_clock::now();
+            longestGapMs = (std::max)(longestGapMs, std::chrono::duration<double, std::milli>(now - last).count());
+            last = now;
+            ++ownerTicks;
+        }
+        readMs.push_back(std::chrono::duration<double, std::milli>(last - start).count());
+        wrong += worker.Snapshot().shown.percentage != HIDSimTransport::ExpectedBattery() ? 1 : 0;
+    }
+    worker.Stop();
+    const size_t sends = HIDSimTransport::GetSendCount() - callsBefore;
+    HIDSimTransport::SetCallLatency({});
+
+    std::cout << std::left << std::setw(16) << (simDevice == Device::Vaxee ? "vaxee engine" : "endgame engine")
+              << std::right << "  latency " << latencyUs << " us  reads " << reads << "  completed " << answered
+              << "  wrong " << wrong << std::fixed << std::setprecision(1) << "  query p50 "
+              << Percentile(submitUs, 0.5) << " us  p99 " << Percentile(submitUs, 0.99) << " us  max "
+              << Percentile(submitUs, 1.0) << " us  read p50 " << Percentile(readMs, 0.5) << " ms  sends/read "
+              << (reads > 0 ? static_cast<double>(sends) / reads : 0.0) << "  owner wakeups/read "
+              << (reads > 0 ? static_cast<double>(ownerTicks) / reads : 0.0) << "  longest owner gap "
+              << longestGapMs << " ms" << std::endl;
+}
+
+// Open model for --first-read: how long after CreateFileW the device answers its first feature
+// report. An assumption; the class driver's cached caps say nothing about it.
+static constexpr uint32_t FIRST_READ_ANSWER_MIN_MS = 5;
+static constexpr uint32_t FIRST_READ_ANSWER_MAX_MS = 80;
+static constexpr int FIRST_READ_MAX_ATTEMPTS = 10;
+
+// Opens the simulated device `opens` times on a fresh DeviceManager (no pooled handle) and times
+// Open to the first valid reading, reading again after a failed read
+static void RunFirstRead(HIDSimTransport::Device simDevice, int opens, bool probe, uint32_t settleMs, uint32_t seed)
+{
+    using Device = HIDSimTransport::Device;
+    if (simDevice == Device::Vaxee)
+    {
+        HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    }
+    else
+    {
+        HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    }
+    HIDSimTransport::SetOpenModel({FIRST_READ_ANSWER_MIN_MS, FIRST_READ_ANSWER_MAX_MS, probe, settleMs});
+
+    vector<double> firstMs;
+    size_t failedReads = 0;
+    size_t neverRead = 0;
+    for (int i = 0; i < opens; ++i)
+    {
+        // Far enough apart that every open finds the mouse awake
+        HIDSimTransport::Advance(std::chrono::milliseconds(2000));
+        DeviceManager deviceManager;
+        const auto start = HIDSimClock::now();
+        bool valid = false;
+        if (deviceManager.FindAndConnect())
+        {
+            for (int attempt = 0; attempt < FIRST_READ_MAX_ATTEMPTS && !valid; ++attempt)
+            {
+                valid = deviceManager.ReadBattery().percentage == HIDSimTransport::ExpectedBattery();
+                failedReads += valid ? 0 : 1;
+            }
+        }
+        if (!valid)
+        {
+            ++neverRead;
+            continue;
+        }
+        firstMs.push_back(std::chrono::duration<double, std::milli>(HIDSimClock::now() - start).count());
+    }
+    HIDSimTransport::SetOpenModel({});
+
+    const string mode = probe ? "probe" : "settle " + std::to_string(settleMs) + " ms";
+    std::cout << std::left << std::setw(32)
+              << string(simDevice == Device::Vaxee ? "vaxee" : "endgame") + " first read " + mode << std::right
+              << std::fixed << std::setprecision(1) << "  p50 " << std::setw(6) << Percentile(firstMs, 0.5)
+              << " ms  p99 " << std::setw(6) << Percentile(firstMs, 0.99) << " ms  failed reads " << failedReads
+              << "  never read " << neverRead << std::endl;
+}
+
+// --input-reports: a status report is waited for in the published snapshot up to this long
+static constexpr std::chrono::milliseconds INPUT_REPORT_DEADLINE{1000};
+// One in this many status reports is preceded by a malformed copy carrying another level
+static constexpr int INPUT_NOISE_EVERY = 3;
+
+// Status input report of the simulated device: a level in device units (Endgame Gear: percent at
+// byte 16 after a valid status byte; VAXEE: 5 % steps at byte 5), or the VAXEE charging flag
+static vector<BYTE> StatusInputReport(HIDSimTransport::Device simDevice, bool charging, BYTE value)
+{
+    vector<BYTE> report(64, 0);
+    if (simDevice == HIDSimTransport::Device::EndgameGear)
+    {
+        report[0] = EndgameGearDevice::REPORT_ID;
+        report[1] = 0x01;
+        report[16] = value;
+        return report;
+    }
+    report[0] = VaxeeDevice::REPORT_ID;
+    report[1] = VaxeeDevice::HEADER;
+    report[2] = charging ? VaxeeDevice::CMD_CHARGING_STATUS : VaxeeDevice::CMD_BATTERY_LEVEL;
+    report[5] = value;
+    return report;
+}
+
+// Malformed variants of a level report the decoder must drop: foreign report ID, invalid status
+// byte or header, another command (VAXEE), cut short before the level
+static vector<BYTE> MalformedInputReport(HIDSimTransport::Device simDevice, vector<BYTE> report, int variant)
+{
+    switch (variant % 4)
+    {
+    case 0:
+        report[0] ^= 0xFF;
+        break;
+    case 1:
+        report[1] = 0x00;
+        break;
+    case 2:
+        if (simDevice == HIDSimTransport::Device::Vaxee)
+        {
+            report[2] = 0x33;
+            break;
+        }
+        report[1] = 0x02;
+        break;
+    default:
+        report.resize(simDevice == HIDSimTransport::Device::Vaxee ? 5 : 16);
+        break;
+    }
+    return report;
+}
+
+// Injects status input reports into the simulated transport while a DeviceWorker with input
+// reports enabled runs on it: HIDInputListener reads them, the device class decodes them and
+// the worker publishes them. Every report changes the status, so each must publish exactly one
+// snapshot showing it; a malformed report injected before some of them must publish nothing.
+static void RunInputReports(HIDSimTransport::Device simDevice, int reports, uint32_t seed)
+{
+    using Device = HIDSimTransport::Device;
+    using std::chrono::steady_clock;
+    const bool vaxee = simDevice == Device::Vaxee;
+    if (vaxee)
+    {
+        HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    }
+    else
+    {
+        HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    }
+    HIDSimTransport::EnableInputInjection(true);
+
+    std::atomic<size_t> changes{0};
+    DeviceWorker worker;
+    worker.EnableInputReports(std::chrono::seconds(300));
+    worker.Start(nullptr, [&changes](const StatusSnapshot &)
+                 { ++changes; });
+    std::atomic<bool> read{false};
+    worker.Query(std::chrono::milliseconds(0), [&read]
+                 { read = true; });
+    while (!read)
+    {
+        worker.DrainCompletions();
+        std::this_thread::yield();
+    }
+
+    std::mt19937 random(seed);
+    StatusSnapshot::Device expected = worker.Snapshot().shown;
+    size_t applied = 0;
+    size_t missed = 0;
+    size_t extraPublishes = 0;
+    size_t malformed = 0;
+    vector<double> latencyUs;
+    for (int i = 0; i < reports; ++i)
+    {
+        // A level other than the shown one (or the VAXEE charging flag flipped)
+        const bool charging = vaxee && i % 2 == 1;
+        const int steps = vaxee ? 21 : 101;
+        const int scale = vaxee ? 5 : 1;
+        auto otherLevel = [&](int avoid1, int avoid2)
+        {
+            int level;
+            do
+            {
+                level = std::uniform_int_distribution<int>(0, steps - 1)(random);
+            } while (level * scale == avoid1 || level * scale == avoid2);
+            return level;
+        };
+        const int level = charging ? 0 : otherLevel(expected.percentage, -1);
+        const vector<BYTE> report =
+            StatusInputReport(simDevice, charging, static_cast<BYTE>(charging ? !expected.isCharging : level));
+
+        const size_t changesBefore = changes;
+        if (i % INPUT_NOISE_EVERY == 0)
+        {
+            const int noiseLevel = otherLevel(expected.percentage, level * scale);
+            HIDSimTransport::InjectInputReport(MalformedInputReport(
+                simDevice, StatusInputReport(simDevice, false, static_cast<BYTE>(noiseLevel)), i / INPUT_NOISE_EVERY));
+            ++malformed;
+        }
+        if (charging)
+        {
+            expected.isCharging = !expected.isCharging;
+        }
+        else
+        {
+            expected.percentage = level * scale;
+        }
+
+        const auto start = steady_clock::now();
+        HIDSimTransport::InjectInputReport(report);
+        // The change handler runs just after the snapshot is stored
+        StatusSnapshot::Device shown;
+        auto arrived = [&]
+        {
+            shown = worker.Snapshot().shown;
+            return shown.percentage == expected.percentage && shown.isCharging == expected.isCharging &&
+                   changes > changesBefore;
+        };
+        while (!arrived() && steady_clock::now() - start < INPUT_REPORT_DEADLINE)
+        {
+            std::this_thread::yield();
+        }
+
+        if (!arrived())
+        {
+            ++missed;
+            expected = shown;
+            continue;
+        }
+        ++applied;
+        latencyUs.push_back(std::chrono::duration<double, std::micro>(steady_clock::now() - start).count());
+        extraPublishes += changes - changesBefore - 1;
+    }
+    worker.Stop();
+    HIDSimTransport::EnableInputInjection(false);
+
+    std::cout << std::left << std::setw(16) << (vaxee ? "vaxee input" : "endgame input") << std::right
+              << "  reports " << reports << "  applied " << applied << "  missed " << missed << "  malformed "
+              << malformed << "  published by malformed " << extraPublishes << std::fixed << std::setprecision(1)
+              << "  latency p50 " << Percentile(latencyUs, 0.5) << " us  p99 " << Percentile(latencyUs, 0.99)
+              << " us" << std::endl;
+}
+
+// --stall: the tray app's scheduled tick, scaled down, and HIDDevice's feature-call deadline
+static constexpr std::chrono::milliseconds STALL_TICK{100};
+static constexpr std::chrono::milliseconds STALL_DEADLINE{1000};
+// How late a tick may fire; one that waited for the stuck read would be late by up to the deadline
+static constexpr std::chrono::milliseconds STALL_LATE_LIMIT{STALL_TICK};
+
+// Owner loop of a DeviceWorker that queries on a fixed tick, the way the tray app's timer does,
+// while the open handle is wedged a third of the way in: the stalled read blocks the engine
+// thread until the deadline, then DeviceManager recycles the handle. Reports how late any tick
+// fired, how queries were answered and what the stall cost; returns false unless every tick fired
+// within STALL_LATE_LIMIT, every query was answered and the handle was recycled.
+static bool RunStall(HIDSimTransport::Device simDevice, int ticks, uint32_t seed)
+{
+    using Device = HIDSimTransport::Device;
+    using std::chrono::steady_clock;
+    const bool vaxee = simDevice == Device::Vaxee;
+    if (vaxee)
+    {
+        HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, seed);
+    }
+    else
+    {
+        HIDSimTransport::SetModel(HIDSimModel{}, seed);
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool notified = false;
+    DeviceWorker worker;
+    worker.Start([&]
+                 {
+                     std::lock_guard<std::mutex> lock(mutex);
+                     notified = true;
+                     wake.notify_one(); },
+                 nullptr);
+
+    size_t queries = 0;
+    size_t answered = 0;
+    size_t answeredWithStatus = 0;
+    auto drainUntil = [&](steady_clock::time_point until)
+    {
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait_until(lock, until, [&notified]
+                                { return notified; });
+                notified = false;
+            }
+            worker.DrainCompletions();
+            if (steady_clock::now() >= until)
+            {
+                return;
+            }
+        }
+    };
+    auto query = [&]
+    {
+        ++queries;
+        worker.Query(STALL_TICK / 2, [&]
+                     {
+                         ++answered;
+                         answeredWithStatus += worker.Snapshot().HasStatus() ? 1 : 0; });
+    };
+
+    query();
+    auto next = steady_clock::now() + STALL_TICK;
+    double latestTickMs = 0.0;
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        drainUntil(next);
+        latestTickMs = (std::max)(latestTickMs, std::chrono::duration<double, std::milli>(steady_clock::now() - next).count());
+        next += STALL_TICK;
+        if (tick == ticks / 3)
+        {
+            HIDSimTransport::StallOpenHandles(STALL_DEADLINE);
+        }
+        query();
+    }
+    drainUntil(steady_clock::now() + STALL_DEADLINE + STALL_TICK);
+
+    size_t recycled = 0;
+    bool done = false;
+    worker.Run([&worker, &recycled, &done](DeviceManager &deviceManager)
+               {
+                   const size_t count = deviceManager.GetRecycleCount();
+                   worker.Complete([&recycled, &done, count]
+                                   {
+                                       recycled = count;
+                                       done = true; }); });
+    while (!done)
+    {
+        drainUntil(steady_clock::now() + STALL_TICK);
+    }
+    const auto stats = worker.GetQueryStats();
+    const bool statusAfter = worker.Snapshot().HasStatus() && !worker.Snapshot().shown.asleep;
+    worker.Stop();
+
+    std::cout << std::left << std::setw(16) << (vaxee ? "vaxee stall" : "endgame stall") << std::right
+              << "  ticks " << ticks << std::fixed << std::setprecision(1) << "  latest tick " << latestTickMs
+              << " ms  queries " << queries << "  answered " << answered << " (" << answeredWithStatus
+              << " with status)  reads " << stats.reads << "  joined " << stats.joined << "  cache hits "
+              << stats.cacheHits << "  handles recycled " << recycled << "  status after "
+              << (statusAfter ? "yes" : "no") << std::endl;
+
+    const bool passed = latestTickMs <= STALL_LATE_LIMIT.count() && answered == queries && recycled > 0;
+    if (!passed)
+    {
+        std::cout << (vaxee ? "vaxee" : "endgame") << " stall: failed (ticks may fire at most "
+                  << STALL_LATE_LIMIT.count() << " ms late, every query must be answered and a handle recycled)"
+                  << std::endl;
+    }
+    return passed;
+}
+
+// A synthetic mouse: drains while in use, barely while asleep, and is charged from
+// RECHARGE_AT back to full whenever it runs that low
+struct DischargeCurve
+{
+    const char *name;
+    double drainPerHour;  // while in use
+    int activeHoursPerDay; // in use, starting at 09:00; asleep otherwise
+};
+
+static constexpr DischargeCurve DISCHARGE_CURVES[] = {
+    {"always on 2%/h", 2.0, 24},
+    {"office 1%/h", 1.0, 9},
+    {"gaming 5%/h", 5.0, 6},
+};
+static constexpr double SLEEP_DRAIN_PER_HOUR = 0.05;
+static constexpr double CHARGE_PER_HOUR = 40.0;
+static constexpr int RECHARGE_AT = 5;
+static constexpr int POLL_BASE_SECONDS = 300;
+static constexpr int POLL_THRESHOLD = 20;
+
+// Runs one curve minute by minute for the given days. Each poll sees the true level (or nothing
+// while the mouse sleeps); reports polls per day and how long after the level fell to the
+// low-battery threshold a poll first saw it.
+static void RunPollCurve(const DischargeCurve &curve, int days, bool adaptive, PollScheduler::Settings settings)
+{
+    using std::chrono::minutes;
+    PollScheduler scheduler(settings);
+    const auto origin = PollScheduler::Clock::time_point{} + std::chrono::hours(24 * 365);
+
+    double level = 100.0;
+    bool charging = false;
+    int lastRead = -1;
+    long nextPoll = 0;
+    size_t polls = 0;
+    // Armed by each charge; crossedAt is set when the level falls to the threshold and cleared
+    // when a poll sees it
+    bool armed = true;
+    long crossedAt = -1;
+    size_t missed = 0;
+    vector<double> detectMinutes;
+    for (long minute = 0; minute < days * 24L * 60L; ++minute)
+    {
+        const int hourOfDay = static_cast<int>(minute / 60 % 24);
+        const bool asleep = !charging && (hourOfDay < 9 || hourOfDay >= 9 + curve.activeHoursPerDay);
+        if (charging)
+        {
+            level = (std::min)(100.0, level + CHARGE_PER_HOUR / 60.0);
+            charging = level < 100.0;
+        }
+        else
+        {
+            level -= (asleep ? SLEEP_DRAIN_PER_HOUR : curve.drainPerHour) / 60.0;
+            charging = level <= RECHARGE_AT;
+            if (charging)
+            {
+                // Plugged in before any poll saw the low level
+                missed += crossedAt >= 0 ? 1 : 0;
+                crossedAt = -1;
+                armed = true;
+            }
+        }
+        if (armed && !charging && level <= POLL_THRESHOLD)
+        {
+            crossedAt = minute;
+            armed = false;
+        }
+
+        if (minute < nextPoll)
+        {
+            continue;
+        }
+        ++polls;
+        const int reading = static_cast<int>(level);
+        if (!asleep)
+        {
+            lastRead = reading;
+            if (crossedAt >= 0 && reading <= POLL_THRESHOLD)
+            {
+                detectMinutes.push_back(static_cast<double>(minute - crossedAt));
+                crossedAt = -1;
+            }
+        }
+        scheduler.OnStatus(lastRead, charging, asleep && lastRead >= 0, origin + minutes(minute));
+        const auto interval = adaptive ? scheduler.NextInterval() : settings.base;
+        nextPoll = minute + (std::max)(1L, static_cast<long>(interval.count() / 60));
+    }
+
+    std::cout << std::left << std::setw(16) << curve.name << std::setw(9) << (adaptive ? "adaptive" : "fixed")
+              << std::right << std::fixed << std::setprecision(1)
+              << "  polls/day " << std::setw(6) << static_cast<double>(polls) / days
+              << "  threshold seen after p50 " << std::setw(5) << Percentile(detectMinutes, 0.50) << " min"
+              << "  max " << std::setw(5) << Percentile(detectMinutes, 1.0) << " min"
+              << "  crossings " << detectMinutes.size() << "  missed " << missed << std::endl;
+}
+
+static void RunPollCurves(int days, int minSeconds, int maxSeconds)
+{
+    PollScheduler::Settings settings;
+    settings.base = std::chrono::seconds(POLL_BASE_SECONDS);
+    settings.min = std::chrono::seconds(minSeconds);
+    settings.max = std::chrono::seconds(maxSeconds);
+    settings.lowThreshold = POLL_THRESHOLD;
+    for (const auto &curve : DISCHARGE_CURVES)
+    {
+        RunPollCurve(curve, days, false, settings);
+        RunPollCurve(curve, days, true, settings);
+    }
+}
+
+// Gaming session model for --idle-gate: stretches of play (motion bursts with short pauses,
+// now and then a long unbroken stretch of motion) alternate with breaks without input
+static constexpr int IDLE_GATE_POLL_SECONDS = 300;
+// Duration of one battery read through a VAXEE 4K dongle (queued cycle, p99)
+static constexpr int IDLE_GATE_READ_MS = 250;
+// A break at least this long lets the mouse fall asleep; the next burst asks for a wake read
+static constexpr int64_t IDLE_GATE_SLEEP_MS = 60000;
+
+struct MotionTimeline
+{
+    // Sorted, non-overlapping [start, end) motion intervals in milliseconds
+    vector<std::pair<int64_t, int64_t>> motion;
+
+    // Time since the last motion at t; 0 while moving
+    int64_t IdleFor(int64_t t) const
+    {
+        auto next = std::upper_bound(motion.begin(), motion.end(), std::make_pair(t, INT64_MAX));
+        if (next == motion.begin())
+        {
+            return INT64_MAX;
+        }
+        const auto &last = *std::prev(next);
+        return t < last.second ? 0 : t - last.second;
+    }
+
+    bool Overlaps(int64_t from, int64_t to) const
+    {
+        auto next = std::upper_bound(motion.begin(), motion.end(), std::make_pair(to, INT64_MIN));
+        return next != motion.begin() && std::prev(next)->second > from;
+    }
+};
+
+static MotionTimeline GamingSession(int hours, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    auto uniform = [&random](int64_t low, int64_t high)
+    { return std::uniform_int_distribution<int64_t>(low, high)(random); };
+
+    MotionTimeline timeline;
+    const int64_t end = hours * 3600000LL;
+    int64_t t = 0;
+    while (t < end)
+    {
+        const int64_t playUntil = t + uniform(15, 45) * 60000;
+        while (t < playUntil)
+        {
+            // One burst in 200 is a long tracking stretch without a pause
+            const int64_t burst = uniform(0, 199) == 0 ? uniform(20000, 90000) : uniform(100, 2000);
+            timeline.motion.emplace_back(t, t + burst);
+            t += burst + uniform(50, 3000);
+        }
+        t += uniform(2, 15) * 60000;
+    }
+    return timeline;
+}
+
+// Reads requested at the given times, released at once or by an idle gate; counts the reads whose
+// transaction overlapped motion
+static void RunGatedReads(const MotionTimeline &timeline, const vector<int64_t> &requests, const string &mode,
+                          std::optional<IdleGate::Settings> settings)
+{
+    const auto origin = IdleGate::Clock::time_point{} + std::chrono::hours(24);
+    std::optional<IdleGate> gate;
+    if (settings)
+    {
+        gate.emplace(*settings);
+    }
+
+    size_t reads = 0;
+    size_t inMotion = 0;
+    vector<double> waits;
+    for (int64_t due : requests)
+    {
+        int64_t at = due;
+        while (gate)
+        {
+            const auto wait = gate->Check(std::chrono::milliseconds((std::min)(timeline.IdleFor(at), int64_t{86400000})),
+                                          origin + std::chrono::milliseconds(at));
+            if (wait.count() == 0)
+            {
+                break;
+            }
+            at += wait.count();
+        }
+        ++reads;
+        inMotion += timeline.Overlaps(at, at + IDLE_GATE_READ_MS) ? 1 : 0;
+        waits.push_back(static_cast<double>(at - due));
+    }
+
+    std::cout << std::left << std::setw(18) << mode << std::right << std::fixed << std::setprecision(1)
+              << "  reads " << reads << "  during motion " << inMotion << " ("
+              << (reads > 0 ? 100.0 * inMotion / reads : 0.0) << "%)"
+              << "  deferred " << (gate ? gate->GetStats().deferred : 0)
+              << "  at limit " << (gate ? gate->GetStats().forced : 0) << std::setprecision(0)
+              << "  delay p50 " << Percentile(waits, 0.50) << " ms  max " << Percentile(waits, 1.0) << " ms" << std::endl;
+}
+
+// Scheduled reads every IDLE_GATE_POLL_SECONDS through the session, then the wake reads of a
+// mouse that fell asleep in each break, requested by the first input of the next burst
+static void RunIdleGate(const MotionTimeline &timeline, int hours, std::optional<IdleGate::Settings> settings)
+{
+    const string gate = settings ? std::to_string(settings->idleWindow.count()) + " ms" : "off";
+
+    vector<int64_t> scheduled;
+    for (int64_t due = 0; due < hours * 3600000LL; due += IDLE_GATE_POLL_SECONDS * 1000LL)
+    {
+        scheduled.push_back(due);
+    }
+    RunGatedReads(timeline, scheduled, "idle gate " + gate, settings);
+
+    vector<int64_t> wakes;
+    for (size_t i = 1; i < timeline.motion.size(); ++i)
+    {
+        if (timeline.motion[i].first - timeline.motion[i - 1].second >= IDLE_GATE_SLEEP_MS)
+        {
+            wakes.push_back(timeline.motion[i].first);
+        }
+    }
+    RunGatedReads(timeline, wakes, "wake gate " + gate, settings);
+}
+
+static void RunIdleGates(int hours, int windowMs, int maxDeferralSeconds, uint32_t seed)
+{
+    const MotionTimeline timeline = GamingSession(hours, seed);
+    RunIdleGate(timeline, hours, std::nullopt);
+    IdleGate::Settings settings;
+    settings.maxDeferral = std::chrono::seconds(maxDeferralSeconds);
+    for (int window : {windowMs / 2, windowMs, windowMs * 2})
+    {
+        settings.idleWindow = std::chrono::milliseconds(window);
+        RunIdleGate(timeline, hours, settings);
+    }
+}
+
+static constexpr int STRESS_READERS = 3;
+
+// Same field values and the same string storage; a torn copy of a view (pointer of one string,
+// length of another) compares unequal here without being dereferenced
+static bool Identical(const StatusSnapshot::Device &a, const StatusSnapshot::Device &b)
+{
+    return a.percentage == b.percentage && a.isCharging == b.isCharging && a.asleep == b.asleep &&
+           a.name.data() == b.name.data() && a.name.size() == b.name.size() &&
+           a.connectionMode.data() == b.connectionMode.data() && a.connectionMode.size() == b.connectionMode.size();
+}
+
+static bool Identical(const StatusSnapshot &a, const StatusSnapshot &b)
+{
+    if (!Identical(a.shown, b.shown) || a.deviceCount != b.deviceCount)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.deviceCount && i < StatusSnapshot::MAX_DEVICES; ++i)
+    {
+        if (!Identical(a.devices[i], b.devices[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Load timings shared by the reader threads of one stress run
+struct LoadStats
+{
+    std::atomic<int> started{0};
+    std::atomic<size_t> loads{0};
+    std::mutex mutex;
+    vector<double> sampledNs;
+    double slowestNs = 0.0;
+};
+
+// Every this many loads of a reader is timed
+static constexpr size_t LOAD_SAMPLE_INTERVAL = 16;
+
+// Loads snapshots until stop is set and returns every snapshot that differed from the one loaded
+// before it
+template <typename Load>
+static vector<StatusSnapshot> HammerLoads(Load load, const std::atomic<bool> &stop, LoadStats &stats)
+{
+    vector<StatusSnapshot> seen;
+    vector<double> sampledNs;
+    StatusSnapshot last;
+    size_t count = 0;
+    ++stats.started;
+    while (!stop.load(std::memory_order_relaxed))
+    {
+        const bool timed = count++ % LOAD_SAMPLE_INTERVAL == 0;
+        const auto start = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+        const StatusSnapshot snapshot = load();
+        if (timed)
+        {
+            sampledNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+        }
+        if (!Identical(snapshot, last))
+        {
+            seen.push_back(snapshot);
+            last = snapshot;
+        }
+    }
+
+    stats.loads += count;
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    for (double ns : sampledNs)
+    {
+        stats.slowestNs = (std::max)(stats.slowestNs, ns);
+    }
+    stats.sampledNs.insert(stats.sampledNs.end(), sampledNs.begin(), sampledNs.end());
+    return seen;
+}
+
+static void WaitForReaders(const LoadStats &stats)
+{
+    while (stats.started < STRESS_READERS)
+    {
+        std::this_thread::yield();
+    }
+}
+
+// The slowest load includes time slices lost to preemption, so p99 is the figure to compare
+static void PrintStress(const char *mode, size_t publishes, const LoadStats &stats, size_t torn,
+                        std::chrono::steady_clock::time_point start)
+{
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t loads = stats.loads;
+    std::cout << std::left << std::setw(18) << mode << std::right << std::fixed << std::setprecision(1)
+              << "  publishes " << publishes << "  loads " << loads
+              << "  loads/s " << (seconds > 0 ? loads / seconds / 1e6 : 0.0) << "M"
+              << "  load p99 " << Percentile(stats.sampledNs, 0.99) << " ns"
+              << "  slowest " << stats.slowestNs / 1000.0 << " us"
+              << "  torn " << torn << std::endl;
+}
+
+// Reader threads load snapshots as fast as they can while a writer publishes. First a
+// DeviceWorker toggles the VAXEE cable of the simulated mouse (every snapshot a reader saw must be
+// one the worker published), then a plain writer publishes synthetic snapshots whose fields are
+// all derived from one counter (every field a reader saw must agree with the others). Returns
+// the number of torn loads of both runs.
+static size_t StressSnapshot(int iterations)
+{
+    HIDSimTransport::SetVaxeeModel(HIDSimVaxeeModel{}, 1);
+    VaxeeDevice::SetCommandQueue(true);
+
+    size_t tornTotal = 0;
+    {
+        DeviceWorker worker;
+        worker.EnableNotificationTracking();
+        worker.EnableMultiDevice();
+        vector<StatusSnapshot> published;
+        worker.Start(nullptr, [&published](const StatusSnapshot &snapshot)
+                     { published.push_back(snapshot); });
+
+        std::atomic<bool> done{false};
+        LoadStats stats;
+        vector<vector<StatusSnapshot>> seen(STRESS_READERS);
+        vector<std::thread> readers;
+        const auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < STRESS_READERS; ++r)
+        {
+            readers.emplace_back([&, r]
+                                 { seen[r] = HammerLoads([&worker]
+                                                         { return worker.Snapshot(); },
+                                                         done, stats); });
+        }
+
+        WaitForReaders(stats);
+        worker.Query(std::chrono::milliseconds(0));
+        for (int i = 0; i < iterations; ++i)
+        {
+            const bool plugged = i % 2 == 0;
+            worker.Run([plugged](DeviceManager &)
+                       {
+                           HIDSimTransport::Advance(std::chrono::minutes(5));
+                           HIDSimTransport::SetVaxeeCharging(plugged); });
+            if (plugged)
+            {
+                worker.OnDevicesArrived({HIDSimTransport::SIM_VAXEE_CABLE_PATH});
+            }
+            else
+            {
+                worker.OnDevicesRemoved({HIDSimTransport::SIM_VAXEE_CABLE_PATH});
+            }
+        }
+        worker.Run([&done](DeviceManager &)
+                   { done = true; });
+        for (auto &reader : readers)
+        {
+            reader.join();
+        }
+        worker.Stop();
+
+        // The cable toggles cycle through a handful of distinct snapshots
+        vector<StatusSnapshot> distinct{StatusSnapshot{}};
+        for (const auto &snapshot : published)
+        {
+            if (std::none_of(distinct.begin(), distinct.end(), [&snapshot](const StatusSnapshot &d)
+                             { return Identical(d, snapshot); }))
+            {
+                distinct.push_back(snapshot);
+            }
+        }
+
+        size_t torn = 0;
+        for (const auto &snapshots : seen)
+        {
+            for (const auto &snapshot : snapshots)
+            {
+                const bool known = std::any_of(distinct.begin(), distinct.end(), [&snapshot](const StatusSnapshot &d)
+                                               { return Identical(d, snapshot); });
+                torn += known ? 0 : 1;
+            }
+        }
+        PrintStress("snapshot worker", published.size(), stats, torn, start);
+        tornTotal += torn;
+    }
+
+    static const std::wstring_view NAMES[] = {L"Alpha", L"Bravo Wireless", L"C"};
+    auto synthetic = [](size_t k)
+    {
+        StatusSnapshot snapshot;
+        snapshot.deviceCount = k % (StatusSnapshot::MAX_DEVICES + 1);
+        for (size_t i = 0; i < snapshot.deviceCount; ++i)
+        {
+            snapshot.devices[i] = {static_cast<int>((k + i) % 101), (k + i) % 2 == 0, NAMES[(k + i) % 3], NAMES[(k + i + 1) % 3]};
+        }
+        snapshot.shown = {static_cast<int>(k % 101), k % 2 == 0, NAMES[k % 3], NAMES[(k + 1) % 3]};
+        return snapshot;
+    };
+
+    SeqlockSlot<StatusSnapshot> slot;
+    std::atomic<bool> done{false};
+    LoadStats stats;
+    vector<vector<StatusSnapshot>> seen(STRESS_READERS);
+    vector<std::thread> readers;
+    const auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < STRESS_READERS; ++r)
+    {
+        readers.emplace_back([&, r]
+                             { seen[r] = HammerLoads([&slot]
+                                                     { return slot.Load(); },
+                                                     done, stats); });
+    }
+    WaitForReaders(stats);
+    for (int i = 1; i <= iterations; ++i)
+    {
+        slot.Store(synthetic(static_cast<size_t>(i)));
+    }
+    done = true;
+    for (auto &reader : readers)
+    {
+        reader.join();
+    }
+
+    size_t torn = 0;
+    for (const auto &snapshots : seen)
+    {
+        for (const auto &snapshot : snapshots)
+        {
+            // Only the default snapshot has no status; any other has shown.percentage == k % 101,
+            // and k % 101 together with the device count pins down every other field
+            bool consistent = Identical(snapshot, StatusSnapshot{});
+            for (size_t k = snapshot.shown.percentage; !consistent && snapshot.shown.percentage >= 0 &&
+                                                       k < 101 * (StatusSnapshot::MAX_DEVICES + 1) * 6;
+                 k += 101)
+            {
+                consistent = Identical(snapshot, synthetic(k));
+            }
+            torn += consistent ? 0 : 1;
+        }
+    }
+    PrintStress("snapshot synthetic", slot.Stores() - 1, stats, torn, start);
+    return tornTotal + torn;
+}
+
+int main(int argc, char **argv)
+{
+    int reads = 2000;
+    double awakeRatio = 0.5;
+    uint32_t seed = 1;
+    bool debug = false;
+    int benchIterations = 0;
+    int benchInterfaces = -1;
+    int stressIterations = 0;
+    int pollDays = 0;
+    int pollMinSeconds = 60;
+    int pollMaxSeconds = 3600;
+    int idleGateHours = 0;
+    int idleWindowMs = 500;
+    int idleMaxSeconds = 60;
+    int engineReads = 0;
+    int callLatencyUs = 2000;
+    int firstReadOpens = 0;
+    uint32_t settleMs = SettleTracker::DEFAULT_SETTLE_MS;
+    int inputReports = 0;
+    int stallTicks = 0;
+    string only;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (arg == "--device" && i + 1 < argc)
+        {
+            only = argv[++i];
+        }
+        else if (arg == "--reads" && i + 1 < argc)
+        {
+            reads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--awake-ratio" && i + 1 < argc)
+        {
+            awakeRatio = std::stod(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--telemetry" && i + 1 < argc)
+        {
+            VaxeeDevice::SetTelemetryAttributes(VaxeeDevice::ParseTelemetrySpecs(argv[++i]));
+        }
+        else if (arg == "--bench-dispatch" && i + 1 < argc)
+        {
+            benchIterations = std::stoi(argv[++i]);
+        }
+        else if (arg == "--bench-enumeration" && i + 1 < argc)
+        {
+            benchInterfaces = std::stoi(argv[++i]);
+        }
+        else if (arg == "--stress-snapshot" && i + 1 < argc)
+        {
+            stressIterations = std::stoi(argv[++i]);
+        }
+        else if (arg == "--poll-curves" && i + 1 < argc)
+        {
+            pollDays = std::stoi(argv[++i]);
+        }
+        else if (arg == "--poll-min" && i + 1 < argc)
+        {
+            pollMinSeconds = std::stoi(argv[++i]);
+        }
+        else if (arg == "--poll-max" && i + 1 < argc)
+        {
+            pollMaxSeconds = std::stoi(argv[++i]);
+        }
+        else if (arg == "--idle-gate" && i + 1 < argc)
+        {
+            idleGateHours = std::stoi(argv[++i]);
+        }
+        else if (arg == "--idle-window" && i + 1 < argc)
+        {
+            idleWindowMs = std::stoi(argv[++i]);
+        }
+        else if (arg == "--idle-max" && i + 1 < argc)
+        {
+            idleMaxSeconds = std::stoi(argv[++i]);
+        }
+        else if (arg == "--engine" && i + 1 < argc)
+        {
+            engineReads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--call-latency" && i + 1 < argc)
+        {
+            callLatencyUs = std::stoi(argv[++i]);
+        }
+        else if (arg == "--first-read" && i + 1 < argc)
+        {
+            firstReadOpens = std::stoi(argv[++i]);
+        }
+        else if (arg == "--settle" && i + 1 < argc)
+        {
+            settleMs = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--input-reports" && i + 1 < argc)
+        {
+            inputReports = std::stoi(argv[++i]);
+        }
+        else if (arg == "--stall" && i + 1 < argc)
+        {
+            stallTicks = std::stoi(argv[++i]);
+        }
+        else if (arg == "--debug")
+        {
+            debug = true;
+        }
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::Instance().SetDebugMode(debug);
+    Logger::Instance().SetLogFile("battery_sim.log");
+
+    if (!only.empty() && only != "endgame" && only != "vaxee")
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if (benchIterations > 0)
+    {
+        BenchDispatch(benchIterations);
+        return 0;
+    }
+    if (benchInterfaces >= 0)
+    {
+        BenchEnumeration(benchInterfaces);
+        return 0;
+    }
+    if (stressIterations > 0)
+    {
+        return StressSnapshot(stressIterations) == 0 ? 0 : 1;
+    }
+    if (pollDays > 0)
+    {
+        RunPollCurves(pollDays, pollMinSeconds, pollMaxSeconds);
+        return 0;
+    }
+    if (idleGateHours > 0)
+    {
+        RunIdleGates(idleGateHours, idleWindowMs, idleMaxSeconds, seed);
+        return 0;
+    }
+
+    using Device = HIDSimTransport::Device;
+    if (engineReads > 0)
+    {
+        if (only.empty() || only == "endgame")
+        {
+            RunEngine(Device::EndgameGear, engineReads, callLatencyUs, seed);
+        }
+        if (only.empty() || only == "vaxee")
+        {
+            RunEngine(Device::Vaxee, engineReads, callLatencyUs, seed);
+        }
+        return 0;
+    }
+    if (stallTicks > 0)
+    {
+        bool passed = true;
+        if (only.empty() || only == "endgame")
+        {
+            passed = RunStall(Device::EndgameGear, stallTicks, seed) && passed;
+        }
+        if (only.empty() || only == "vaxee")
+        {
+            passed = RunStall(Device::Vaxee, stallTicks, seed) && passed;
+        }
+        return passed ? 0 : 1;
+    }
+    if (inputReports > 0)
+    {
+        if (only.empty() || only == "endgame")
+        {
+            RunInputReports(Device::EndgameGear, inputReports, seed);
+        }
+        if (only.empty() || only == "vaxee")
+        {
+            RunInputReports(Device::Vaxee, inputReports, seed);
+        }
+        return 0;
+    }
+    if (firstReadOpens > 0)
+    {
+        for (Device simDevice : {Device::EndgameGear, Device::Vaxee})
+        {
+            if (!only.empty() && only != (simDevice == Device::Vaxee ? "vaxee" : "endgame"))
+            {
+                continue;
+            }
+            RunFirstRead(simDevice, firstReadOpens, false, 0, seed);
+            RunFirstRead(simDevice, firstReadOpens, false, settleMs, seed);
+            RunFirstRead(simDevice, firstReadOpens, true, settleMs, seed);
+        }
+        return 0;
+    }
+    if (only.empty() || only == "endgame")
+    {
+        PrintStats("endgame fixed", RunReads(Device::EndgameGear, false, reads, awakeRatio, seed), reads);
+        PrintStats("endgame adaptive", RunReads(Device::EndgameGear, true, reads, awakeRatio, seed), reads);
+        for (bool tracking : {true, false})
+        {
+            RunMouseOff(false, tracking, seed);
+            RunMouseOff(true, tracking, seed);
+        }
+    }
+    if (only.empty() || only == "vaxee")
+    {
+        PrintStats("vaxee fixed", RunReads(Device::Vaxee, false, reads, awakeRatio, seed), reads);
+        PrintStats("vaxee queued", RunReads(Device::Vaxee, true, reads, awakeRatio, seed), reads);
+        RunSwitching(reads, seed);
+        RunToggle(reads, true, seed);
+        RunToggle(reads, false, seed);
+        RunQueries(reads, seed);
+    }
+    if (only.empty() || only == "endgame")
+    {
+        const double every = RunMouseAsleep(SleepMode::Every, 0.0, seed);
+        RunMouseAsleep(SleepMode::Backoff, every, seed);
+        RunMouseAsleep(SleepMode::Wake, every, seed);
+    }
+    return 0;
+}
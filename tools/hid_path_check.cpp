@@ -0,0 +1,102 @@
+// Checks HIDPath::Parse against a corpus of interface paths (tools/fixtures/hid_paths.txt): each
+// line gives the VID, PID, MI and COL the parser must recover, or "-" for all four when the path
+// has to be rejected. Runs on any platform and exits non-zero if any path parses differently.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <optional>
+#include "core/hid_path.hpp"
+
+using std::string;
+
+static constexpr const char *DEFAULT_CORPUS = "tools/fixtures/hid_paths.txt";
+
+// "-" is -1 (absent); everything else is hex
+static std::optional<int> ParseField(const string &field)
+{
+    if (field == "-")
+    {
+        return -1;
+    }
+    try
+    {
+        size_t used = 0;
+        const int value = std::stoi(field, &used, 16);
+        return used == field.size() ? std::optional<int>(value) : std::nullopt;
+    }
+    catch (const std::exception &)
+    {
+        return std::nullopt;
+    }
+}
+
+static string Describe(const std::optional<HIDPathInfo> &info)
+{
+    if (!info)
+    {
+        return "unparseable";
+    }
+    std::ostringstream text;
+    text << std::hex << "vid " << info->vid << " pid " << info->pid << std::dec << " mi " << info->interfaceNumber
+         << " col " << info->collection;
+    return text.str();
+}
+
+int main(int argc, char **argv)
+{
+    const string corpus = argc > 1 ? argv[1] : DEFAULT_CORPUS;
+    std::ifstream file(corpus);
+    if (!file)
+    {
+        std::cerr << "Cannot open " << corpus << std::endl;
+        return 1;
+    }
+
+    size_t checked = 0;
+    size_t failed = 0;
+    string line;
+    for (size_t number = 1; std::getline(file, line); ++number)
+    {
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        string vid, pid, mi, col, path;
+        fields >> vid >> pid >> mi >> col >> path;
+        const auto expectVid = ParseField(vid), expectPid = ParseField(pid);
+        const auto expectMi = ParseField(mi), expectCol = ParseField(col);
+        if (path.empty() || !expectVid || !expectPid || !expectMi || !expectCol)
+        {
+            std::cerr << corpus << ":" << number << ": malformed line" << std::endl;
+            return 1;
+        }
+
+        std::optional<HIDPathInfo> expected;
+        if (*expectVid >= 0)
+        {
+            expected = HIDPathInfo{static_cast<uint16_t>(*expectVid), static_cast<uint16_t>(*expectPid), *expectMi,
+                                   *expectCol};
+        }
+        // The corpus is ASCII, which widens byte for byte
+        const auto parsed = HIDPath::Parse(std::wstring(path.begin(), path.end()));
+
+        ++checked;
+        const bool match = parsed.has_value() == expected.has_value() &&
+                           (!parsed || (parsed->vid == expected->vid && parsed->pid == expected->pid &&
+                                        parsed->interfaceNumber == expected->interfaceNumber &&
+                                        parsed->collection == expected->collection));
+        if (!match)
+        {
+            ++failed;
+            std::cout << corpus << ":" << number << ": expected " << Describe(expected) << ", parsed "
+                      << Describe(parsed) << "\n  " << path << std::endl;
+        }
+    }
+
+    std::cout << checked << " paths: " << checked - failed << " passed, " << failed << " failed" << std::endl;
+    return failed == 0 && checked > 0 ? 0 : 1;
+}